@@ -20,6 +20,26 @@ public:
 
 bool DocReader::open()
 {
-    NullCache cache;
-    return open(cache);
+    static NullCache cache;
+    return open(cache, nullptr);
+}
+
+bool DocReader::open(DocReaderCache &cache)
+{
+    return open(cache, nullptr);
+}
+
+std::shared_ptr<ResourceLoader> DocReader::create_resource_loader() const
+{
+    return nullptr;
+}
+
+std::vector<char> DocReader::load_resource_prefix(const std::filesystem::path &path, uint32_t max_bytes) const
+{
+    std::vector<char> data = load_resource(path);
+    if (data.size() > max_bytes)
+    {
+        data.resize(max_bytes);
+    }
+    return data;
 }
@@ -4,6 +4,7 @@
 #include "./token_iter.h"
 
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -21,6 +22,14 @@ struct TocPosition
     uint32_t progress_percent;
 };
 
+// Book level info, readable without a full open
+struct DocMetadata
+{
+    std::string id;      // same as DocReader::get_id
+    std::string title;   // may be empty
+    std::string author;  // may be empty
+};
+
 // Allow readers to cache arbitrary data
 class DocReaderCache
 {
@@ -29,6 +38,22 @@ public:
     virtual void write(const std::string &book_id, const std::string &key, const std::string &value) = 0;
 };
 
+// Reads a document's resources independently of its reader, with a file handle
+// of its own, so they can be loaded on worker threads. Safe to use from any
+// thread, calls are serialized.
+class ResourceLoader
+{
+public:
+    virtual ~ResourceLoader() = default;
+
+    // Empty if the resource can't be read
+    virtual std::vector<char> load_resource(const std::filesystem::path &path) = 0;
+};
+
+// Receives (steps done, total steps) during a long running open.
+// Return false to abort the open.
+using OpenProgressCallback = std::function<bool(uint32_t, uint32_t)>;
+
 // Interface for interacting with a particular document format.
 class DocReader
 {
@@ -36,11 +61,19 @@ public:
     virtual ~DocReader() = default;
 
     bool open();
-    virtual bool open(DocReaderCache &cache) = 0;
+    bool open(DocReaderCache &cache);
+    // Safe to call from a background thread. Progress may be null.
+    // Readers may finish writing to the cache in the background after open
+    // returns, so the cache must outlive the reader and allow writes from any thread.
+    virtual bool open(DocReaderCache &cache, const OpenProgressCallback &on_progress) = 0;
     virtual bool is_open() const = 0;
 
     virtual std::string get_id() const = 0;
 
+    // Hint that the reader will be read once front to back, e.g. for search.
+    // Readers may then drop content once passed, to bound memory use.
+    virtual void set_sequential_access() {}
+
     virtual const std::vector<TocItem> &get_table_of_contents() const = 0;
     virtual TocPosition get_toc_position(const DocAddr &address) const = 0;
     virtual DocAddr get_toc_item_address(uint32_t toc_item_index) const = 0;
@@ -50,6 +83,10 @@ public:
     virtual std::shared_ptr<TokenIter> get_iter(DocAddr address = 0) const = 0;
 
     virtual std::vector<char> load_resource(const std::filesystem::path &path) const = 0;
+    // Up to max_bytes from the start of a resource, e.g. to read a file header
+    virtual std::vector<char> load_resource_prefix(const std::filesystem::path &path, uint32_t max_bytes) const;
+    // Null if resources can only be loaded through the reader
+    virtual std::shared_ptr<ResourceLoader> create_resource_loader() const;
 };
 
 #endif
@@ -20,6 +20,7 @@ struct DocToken
     DocAddr address;
 
     DocToken(TokenType type, DocAddr address);
+    virtual ~DocToken() = default;
     virtual bool operator==(const DocToken &other) const;
     virtual std::string to_string() const = 0;
 
@@ -0,0 +1,680 @@
+#include "./search_index.h"
+#include "./substring_finder.h"
+#include "./token_addressing.h"
+#include "util/utf8.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+
+constexpr const char *INDEX_MAGIC = "SIDX";
+constexpr uint32_t INDEX_VERSION = 2;  // 2: non-ascii case folding
+
+// Guard against reading garbage as a huge allocation
+constexpr uint64_t MAX_TERM_LENGTH = 1024;
+
+/////////////////////////////////////
+// Word splitting
+
+inline char ascii_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+void append_utf8(std::string &out, uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        out.push_back(static_cast<char>(cp));
+    }
+    else if (cp < 0x800)
+    {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+/////////////////////////////////////
+// Serialization
+
+void append_varint(std::vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Decode a varint from data, advancing pos. Returns false if truncated.
+bool read_varint(const uint8_t *data, uint32_t size, uint32_t &pos, uint64_t &value_out)
+{
+    value_out = 0;
+    for (uint32_t shift = 0; shift < 64 && pos < size; shift += 7)
+    {
+        uint8_t byte = data[pos++];
+        value_out |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void write_varint(std::ostream &os, uint64_t value)
+{
+    std::vector<uint8_t> bytes;
+    append_varint(bytes, value);
+    os.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+// Bytes from the read position to the end of the stream, 0 if it can't seek
+uint64_t bytes_remaining(std::istream &is)
+{
+    auto pos = is.tellg();
+    if (pos < 0 || !is.seekg(0, std::ios::end))
+    {
+        is.clear();
+        return 0;
+    }
+    auto end = is.tellg();
+    is.seekg(pos);
+    return (end > pos) ? static_cast<uint64_t>(end - pos) : 0;
+}
+
+bool read_varint(std::istream &is, uint64_t &value_out)
+{
+    value_out = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7)
+    {
+        int byte = is.get();
+        if (byte == std::char_traits<char>::eof())
+        {
+            return false;
+        }
+        value_out |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool is_search_word_char(uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        return (cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z') || (cp >= '0' && cp <= '9');
+    }
+    if (cp >= 0x00A0 && cp <= 0x00BF)  // latin-1 punctuation, nbsp
+    {
+        return false;
+    }
+    if (cp == 0x00D7 || cp == 0x00F7)  // multiplication, division signs
+    {
+        return false;
+    }
+    if (cp >= 0x2000 && cp <= 0x206F)  // general punctuation: dashes, quotes, ellipsis
+    {
+        return false;
+    }
+    if (cp >= 0x3000 && cp <= 0x303F)  // cjk punctuation
+    {
+        return false;
+    }
+    return true;
+}
+
+uint32_t fold_search_case(uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        return (cp >= 'A' && cp <= 'Z') ? cp - 'A' + 'a' : cp;
+    }
+    if (cp >= 0x00C0 && cp <= 0x00DE && cp != 0x00D7)  // latin-1
+    {
+        return cp + 0x20;
+    }
+    if (cp >= 0x0100 && cp <= 0x017F)  // latin extended-a, mostly upper/lower pairs
+    {
+        if (cp == 0x0130 || cp == 0x0131 || cp == 0x0138 || cp == 0x0149 || cp == 0x017F)
+        {
+            return cp;  // dotted I, dotless i, kra, 'n, long s
+        }
+        if (cp == 0x0178)
+        {
+            return 0x00FF;
+        }
+        bool upper_is_odd = (cp >= 0x0139 && cp <= 0x0148) || (cp >= 0x0179 && cp <= 0x017E);
+        return ((cp & 1) == upper_is_odd) ? cp + 1 : cp;
+    }
+    if (cp >= 0x0386 && cp <= 0x03AB)  // greek capitals
+    {
+        if (cp == 0x0386)
+        {
+            return 0x03AC;
+        }
+        if (cp >= 0x0388 && cp <= 0x038A)
+        {
+            return cp + 0x25;
+        }
+        if (cp == 0x038C)
+        {
+            return 0x03CC;
+        }
+        if (cp == 0x038E || cp == 0x038F)
+        {
+            return cp + 0x3F;
+        }
+        if (cp >= 0x0391 && cp != 0x03A2)
+        {
+            return cp + 0x20;
+        }
+        return cp;
+    }
+    if (cp == 0x03C2)  // final sigma
+    {
+        return 0x03C3;
+    }
+    if (cp >= 0x0400 && cp <= 0x040F)  // cyrillic
+    {
+        return cp + 0x50;
+    }
+    if (cp >= 0x0410 && cp <= 0x042F)
+    {
+        return cp + 0x20;
+    }
+    return cp;
+}
+
+const std::string *get_searchable_text(const DocToken &token)
+{
+    switch (token.type)
+    {
+        case TokenType::Text:
+            return &static_cast<const TextDocToken &>(token).text;
+        case TokenType::Header:
+            return &static_cast<const HeaderDocToken &>(token).text;
+        case TokenType::ListItem:
+            return &static_cast<const ListItemDocToken &>(token).text;
+        case TokenType::Image:
+            break;
+    }
+    return nullptr;
+}
+
+void for_each_search_word(const std::string &text, const std::function<void(const std::string &, uint32_t)> &callback)
+{
+    const char *begin = text.data();
+    const char *end = begin + text.size();
+    const char *s = begin;
+
+    std::string word;
+    uint32_t word_start = 0;
+
+    while (s < end)
+    {
+        uint32_t num_bytes;
+        uint32_t cp = utf8_decode(s, end, num_bytes);
+
+        if (is_search_word_char(cp))
+        {
+            if (word.empty())
+            {
+                word_start = s - begin;
+            }
+            if (num_bytes == 1)
+            {
+                word.push_back(ascii_lower(*s));
+            }
+            else
+            {
+                uint32_t folded = fold_search_case(cp);
+                if (folded == cp)
+                {
+                    word.append(s, num_bytes);
+                }
+                else
+                {
+                    append_utf8(word, folded);
+                }
+            }
+        }
+        else if (!word.empty())
+        {
+            callback(word, word_start);
+            word.clear();
+        }
+
+        s += num_bytes;
+    }
+
+    if (!word.empty())
+    {
+        callback(word, word_start);
+    }
+}
+
+/////////////////////////////////////
+// SearchIndex
+
+uint32_t SearchIndex::num_terms() const
+{
+    return terms.size();
+}
+
+void SearchIndex::append_postings(uint32_t term_index, std::vector<DocAddr> &out) const
+{
+    uint32_t pos = postings_start[term_index];
+    uint32_t end = postings_start[term_index + 1];
+    DocAddr address = 0;
+    uint64_t delta;
+    while (pos < end && read_varint(postings.data(), end, pos, delta))
+    {
+        address += delta;
+        out.push_back(address);
+    }
+}
+
+std::vector<DocAddr> SearchIndex::find_term(const std::string &term, bool is_prefix) const
+{
+    std::vector<DocAddr> addresses;
+
+    auto it = std::lower_bound(terms.begin(), terms.end(), term);
+    if (!is_prefix)
+    {
+        if (it != terms.end() && *it == term)
+        {
+            append_postings(it - terms.begin(), addresses);
+        }
+        return addresses;
+    }
+
+    uint32_t num_matching_terms = 0;
+    for (; it != terms.end() && it->compare(0, term.size(), term) == 0; ++it)
+    {
+        append_postings(it - terms.begin(), addresses);
+        ++num_matching_terms;
+    }
+
+    // Each term's postings are ascending, but not across terms
+    if (num_matching_terms > 1)
+    {
+        std::sort(addresses.begin(), addresses.end());
+    }
+    return addresses;
+}
+
+std::vector<DocAddr> SearchIndex::find(const std::string &query, uint32_t max_results) const
+{
+    std::vector<std::string> words;
+    for_each_search_word(query, [&words](const std::string &word, uint32_t) {
+        words.push_back(word);
+    });
+
+    if (words.empty() || max_results == 0)
+    {
+        return {};
+    }
+
+    // Candidate matches as (first word address, latest matched word address)
+    std::vector<std::pair<DocAddr, DocAddr>> candidates;
+    for (DocAddr address : find_term(words[0], words.size() == 1))
+    {
+        candidates.emplace_back(address, address);
+    }
+
+    for (uint32_t i = 1; i < words.size() && !candidates.empty(); ++i)
+    {
+        std::vector<DocAddr> next_addresses = find_term(words[i], i + 1 == words.size());
+        uint32_t prev_width = get_address_width(words[i - 1]);
+
+        // Both lists are ascending, so the search for each candidate's
+        // follower can pick up where the previous one left off
+        std::vector<std::pair<DocAddr, DocAddr>> extended;
+        auto next_it = next_addresses.begin();
+        for (const auto &[start, last] : candidates)
+        {
+            DocAddr prev_end = last + prev_width;
+            next_it = std::lower_bound(next_it, next_addresses.end(), prev_end);
+            if (next_it != next_addresses.end() && *next_it - prev_end <= MAX_WORD_GAP)
+            {
+                extended.emplace_back(start, *next_it);
+            }
+        }
+        candidates.swap(extended);
+    }
+
+    std::vector<DocAddr> results;
+    for (const auto &candidate : candidates)
+    {
+        if (results.size() >= max_results)
+        {
+            break;
+        }
+        results.push_back(candidate.first);
+    }
+    return results;
+}
+
+void SearchIndex::write(std::ostream &os) const
+{
+    os.write(INDEX_MAGIC, strlen(INDEX_MAGIC));
+    write_varint(os, INDEX_VERSION);
+    write_varint(os, terms.size());
+
+    for (uint32_t i = 0; i < terms.size(); ++i)
+    {
+        write_varint(os, terms[i].size());
+        os.write(terms[i].data(), terms[i].size());
+        write_varint(os, postings_start[i + 1] - postings_start[i]);
+    }
+
+    os.write(reinterpret_cast<const char *>(postings.data()), postings.size());
+}
+
+std::optional<SearchIndex> SearchIndex::read(std::istream &is)
+{
+    char magic[4];
+    if (!is.read(magic, sizeof(magic)) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0)
+    {
+        return std::nullopt;
+    }
+
+    uint64_t version, num_terms;
+    if (!read_varint(is, version) || version != INDEX_VERSION || !read_varint(is, num_terms))
+    {
+        return std::nullopt;
+    }
+
+    // Postings follow the terms, so can't be longer than what's left. Checked
+    // up front so corrupt lengths can't wrap offsets or allocate garbage.
+    const uint64_t max_postings_size = std::min<uint64_t>(bytes_remaining(is), UINT32_MAX);
+
+    SearchIndex index;
+    index.postings_start.push_back(0);
+
+    for (uint64_t i = 0; i < num_terms; ++i)
+    {
+        uint64_t term_len, postings_len;
+        if (!read_varint(is, term_len) || term_len > MAX_TERM_LENGTH)
+        {
+            return std::nullopt;
+        }
+        std::string term(term_len, '\0');
+        if (!is.read(term.data(), term_len) || !read_varint(is, postings_len))
+        {
+            return std::nullopt;
+        }
+
+        // Terms must be sorted and unique for lookups, and offsets ascending
+        uint64_t postings_end = index.postings_start.back() + postings_len;
+        if ((!index.terms.empty() && !(index.terms.back() < term)) ||
+            postings_len > max_postings_size || postings_end > max_postings_size)
+        {
+            return std::nullopt;
+        }
+
+        index.terms.push_back(std::move(term));
+        index.postings_start.push_back(static_cast<uint32_t>(postings_end));
+    }
+
+    index.postings.resize(index.postings_start.back());
+    if (!is.read(reinterpret_cast<char *>(index.postings.data()), index.postings.size()))
+    {
+        return std::nullopt;
+    }
+
+    return index;
+}
+
+bool SearchIndex::save(const std::filesystem::path &path) const
+{
+    // Write to the side so a partial write never replaces a good index
+    std::filesystem::path tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream fp(tmp_path, std::ios::binary);
+        write(fp);
+        if (!fp)
+        {
+            std::cerr << "Failed to write search index " << tmp_path << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        std::cerr << "Failed to save search index " << path << ": " << ec.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::optional<SearchIndex> SearchIndex::load(const std::filesystem::path &path)
+{
+    std::ifstream fp(path, std::ios::binary);
+    if (!fp)
+    {
+        return std::nullopt;
+    }
+    return read(fp);
+}
+
+/////////////////////////////////////
+// SearchPhraseMatcher
+
+SearchPhraseMatcher::SearchPhraseMatcher(const std::string &query)
+{
+    for_each_search_word(query, [this](const std::string &word, uint32_t) {
+        words.push_back(word);
+        word_widths.push_back(get_address_width(word));
+    });
+
+    // Text can only start a match if it contains the ascii start of the first
+    // word at the start of a word, which is quick to rule out
+    if (!words.empty())
+    {
+        const std::string &first = words[0];
+        uint32_t ascii_len = 0;
+        while (ascii_len < first.size() && !(first[ascii_len] & 0x80))
+        {
+            ++ascii_len;
+        }
+        if (ascii_len)
+        {
+            prefilter = std::make_unique<SubstringFinder>(first.substr(0, ascii_len));
+        }
+    }
+}
+
+SearchPhraseMatcher::~SearchPhraseMatcher()
+{
+}
+
+bool SearchPhraseMatcher::empty() const
+{
+    return words.empty();
+}
+
+bool SearchPhraseMatcher::word_matches(const std::string &word, uint32_t word_index) const
+{
+    // The last word may be a prefix
+    const std::string &query_word = words[word_index];
+    if (word_index + 1 == words.size())
+    {
+        return word.compare(0, query_word.size(), query_word) == 0;
+    }
+    return word == query_word;
+}
+
+bool SearchPhraseMatcher::add_word(const std::string &word, DocAddr address, const std::function<bool(DocAddr)> &on_match)
+{
+    bool keep_going = true;
+
+    // As in SearchIndex::find, each partial match continues with the first
+    // occurrence of its next word from the end of the previous, if close enough
+    uint32_t num_kept = 0;
+    for (Candidate candidate : candidates)
+    {
+        if (address > candidate.prev_end + SearchIndex::MAX_WORD_GAP)
+        {
+            continue;
+        }
+
+        if (address >= candidate.prev_end && word_matches(word, candidate.next_word))
+        {
+            candidate.prev_end = address + word_widths[candidate.next_word];
+            if (++candidate.next_word == words.size())
+            {
+                keep_going = keep_going && on_match(candidate.start);
+                continue;
+            }
+        }
+        candidates[num_kept++] = candidate;
+    }
+    candidates.resize(num_kept);
+
+    if (keep_going && word_matches(word, 0))
+    {
+        if (words.size() == 1)
+        {
+            keep_going = on_match(address);
+        }
+        else
+        {
+            candidates.push_back({address, address + word_widths[0], 1});
+        }
+    }
+
+    return keep_going;
+}
+
+void SearchPhraseMatcher::add_text(DocAddr address, const std::string &text, const std::function<bool(DocAddr)> &on_match)
+{
+    if (words.empty())
+    {
+        return;
+    }
+
+    if (candidates.empty() && prefilter)
+    {
+        bool found = false;
+        prefilter->find_all(text, [&found](uint32_t) {
+            found = true;
+            return false;
+        });
+        if (!found)
+        {
+            return;
+        }
+    }
+
+    // Words are visited in order, so widths accumulate from the previous word
+    uint32_t measured_offset = 0;
+    DocAddr word_address = address;
+    bool keep_going = true;
+
+    for_each_search_word(text, [&](const std::string &word, uint32_t offset) {
+        if (!keep_going)
+        {
+            return;
+        }
+        word_address += get_address_width(text.c_str() + measured_offset, offset - measured_offset);
+        measured_offset = offset;
+
+        keep_going = add_word(word, word_address, on_match);
+    });
+}
+
+/////////////////////////////////////
+// SearchIndexBuilder
+
+void SearchIndexBuilder::add_token(const DocToken &token)
+{
+    if (const std::string *text = get_searchable_text(token))
+    {
+        add_text(token.address, *text);
+    }
+}
+
+void SearchIndexBuilder::add_text(DocAddr address, const std::string &text)
+{
+    // Words are visited in order, so widths accumulate from the previous word
+    uint32_t measured_offset = 0;
+    DocAddr word_address = address;
+
+    for_each_search_word(text, [&](const std::string &word, uint32_t offset) {
+        word_address += get_address_width(text.c_str() + measured_offset, offset - measured_offset);
+        measured_offset = offset;
+
+        auto &addresses = term_addresses[word];
+        if (addresses.empty() || addresses.back() != word_address)
+        {
+            addresses.push_back(word_address);
+        }
+    });
+}
+
+SearchIndex SearchIndexBuilder::build()
+{
+    std::vector<std::pair<std::string, std::vector<DocAddr>>> sorted_terms(
+        std::make_move_iterator(term_addresses.begin()),
+        std::make_move_iterator(term_addresses.end())
+    );
+    term_addresses.clear();
+
+    std::sort(sorted_terms.begin(), sorted_terms.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+
+    SearchIndex index;
+    index.terms.reserve(sorted_terms.size());
+    index.postings_start.reserve(sorted_terms.size() + 1);
+    index.postings_start.push_back(0);
+
+    for (auto &[term, addresses] : sorted_terms)
+    {
+        // Already ascending when tokens were added in reading order
+        if (!std::is_sorted(addresses.begin(), addresses.end()))
+        {
+            std::sort(addresses.begin(), addresses.end());
+            addresses.erase(std::unique(addresses.begin(), addresses.end()), addresses.end());
+        }
+
+        DocAddr prev = 0;
+        for (DocAddr address : addresses)
+        {
+            append_varint(index.postings, address - prev);
+            prev = address;
+        }
+        index.terms.push_back(std::move(term));
+        index.postings_start.push_back(index.postings.size());
+    }
+
+    return index;
+}
@@ -0,0 +1,113 @@
+#ifndef SEARCH_INDEX_H_
+#define SEARCH_INDEX_H_
+
+#include "./doc_addr.h"
+#include "./doc_token.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class SubstringFinder;
+
+// Whether a unicode code point is part of a word, rather than punctuation
+// or whitespace.
+bool is_search_word_char(uint32_t code_point);
+
+// Lowercase form of a code point for matching. Covers ascii, latin-1, latin
+// extended-a, greek and cyrillic. Never maps between ascii and non-ascii.
+uint32_t fold_search_case(uint32_t code_point);
+
+// Text of tokens with searchable text, otherwise null
+const std::string *get_searchable_text(const DocToken &token);
+
+// Split text into case folded search words. Receives (word, byte offset in text).
+// Words are runs of ascii letters/digits and non-ascii chars, apart from
+// common unicode punctuation.
+void for_each_search_word(const std::string &text, const std::function<void(const std::string &, uint32_t)> &callback);
+
+// Inverted index from words to the addresses where they start.
+class SearchIndex
+{
+    std::vector<std::string> terms;        // sorted
+    std::vector<uint32_t> postings_start;  // per term offset into postings, plus end offset
+    std::vector<uint8_t> postings;         // per term ascending addresses, delta varint encoded
+
+    friend class SearchIndexBuilder;
+
+    void append_postings(uint32_t term_index, std::vector<DocAddr> &out) const;
+    // Addresses of words starting with prefix (or only exactly matching), ascending
+    std::vector<DocAddr> find_term(const std::string &term, bool is_prefix) const;
+
+public:
+    // Max address width of punctuation between consecutive words of a query.
+    // Loose enough for quotes and dashes, at the cost of letting through the
+    // odd one or two letter word.
+    static constexpr uint32_t MAX_WORD_GAP = 2;
+
+    uint32_t num_terms() const;
+
+    // Addresses of matches in reading order. Query words must appear as a
+    // phrase, ignoring case and punctuation. The last word may be a prefix,
+    // for searching while typing.
+    std::vector<DocAddr> find(const std::string &query, uint32_t max_results) const;
+
+    void write(std::ostream &os) const;
+    static std::optional<SearchIndex> read(std::istream &is);
+
+    bool save(const std::filesystem::path &path) const;
+    static std::optional<SearchIndex> load(const std::filesystem::path &path);
+};
+
+// Matches a query by the same rules as SearchIndex::find, against text fed in
+// reading order, for searching before the index is built. Matches may span
+// texts.
+class SearchPhraseMatcher
+{
+    struct Candidate
+    {
+        DocAddr start;
+        DocAddr prev_end;  // end of the last word matched
+        uint32_t next_word;
+    };
+
+    std::vector<std::string> words;
+    std::vector<uint32_t> word_widths;
+    std::vector<Candidate> candidates;           // partial matches, by start
+    std::unique_ptr<SubstringFinder> prefilter;  // skips text that can't start a match
+
+    bool word_matches(const std::string &word, uint32_t word_index) const;
+    bool add_word(const std::string &word, DocAddr address, const std::function<bool(DocAddr)> &on_match);
+
+public:
+    SearchPhraseMatcher(const std::string &query);
+    SearchPhraseMatcher(const SearchPhraseMatcher &) = delete;
+    SearchPhraseMatcher &operator=(const SearchPhraseMatcher &) = delete;
+    ~SearchPhraseMatcher();
+
+    bool empty() const;
+
+    // Receives the address of each match completed within text, in order.
+    // Return false from the callback to stop early.
+    void add_text(DocAddr address, const std::string &text, const std::function<bool(DocAddr)> &on_match);
+};
+
+// Accumulates tokens in reading order to build a SearchIndex.
+class SearchIndexBuilder
+{
+    std::unordered_map<std::string, std::vector<DocAddr>> term_addresses;
+
+public:
+    void add_token(const DocToken &token);
+    void add_text(DocAddr address, const std::string &text);
+
+    SearchIndex build();
+};
+
+#endif
@@ -0,0 +1,243 @@
+#include "./substring_finder.h"
+#include "./search_index.h"
+#include "util/str_utils.h"
+#include "util/utf8.h"
+
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define FINDER_NEON 1
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+    #define FINDER_SSE2 1
+#endif
+
+namespace
+{
+
+inline char fold_case(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+inline bool is_ascii_lower(char c)
+{
+    return c >= 'a' && c <= 'z';
+}
+
+// Whether the char ending just before offset is part of a word
+bool follows_word_char(const char *text, uint32_t offset)
+{
+    if (offset == 0)
+    {
+        return false;
+    }
+
+    uint32_t start = offset - 1;
+    while (start > 0 && offset - start < 4 && (text[start] & 0xC0) == 0x80)
+    {
+        --start;
+    }
+
+    uint32_t num_bytes;
+    return is_search_word_char(utf8_decode(text + start, text + offset, num_bytes));
+}
+
+#if FINDER_NEON || FINDER_SSE2
+
+// Candidate match positions are found 16 at a time by comparing the first and
+// last needle bytes against the text, as in Muła's "SIMD-friendly algorithms
+// for substring searching". Ascii letters are compared with the case bit set,
+// which only lets through the other case of the same letter.
+
+#if FINDER_NEON
+
+using block_t = uint8x16_t;
+constexpr uint32_t LANE_BITS = 4;
+
+inline block_t load_block(const char *p)
+{
+    return vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+}
+
+inline block_t splat(char c)
+{
+    return vdupq_n_u8(static_cast<uint8_t>(c));
+}
+
+inline block_t eq_folded(block_t v, block_t c, bool fold)
+{
+    return vceqq_u8(fold ? vorrq_u8(v, vdupq_n_u8(0x20)) : v, c);
+}
+
+inline uint64_t candidate_mask(block_t first_eq, block_t last_eq)
+{
+    // No movemask on NEON, narrow each 0x00/0xFF byte to a nibble instead
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(vandq_u8(first_eq, last_eq)), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x1111111111111111ull;
+}
+
+#else
+
+using block_t = __m128i;
+constexpr uint32_t LANE_BITS = 1;
+
+inline block_t load_block(const char *p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+inline block_t splat(char c)
+{
+    return _mm_set1_epi8(c);
+}
+
+inline block_t eq_folded(block_t v, block_t c, bool fold)
+{
+    return _mm_cmpeq_epi8(fold ? _mm_or_si128(v, _mm_set1_epi8(0x20)) : v, c);
+}
+
+inline uint64_t candidate_mask(block_t first_eq, block_t last_eq)
+{
+    return static_cast<uint64_t>(_mm_movemask_epi8(_mm_and_si128(first_eq, last_eq)));
+}
+
+#endif
+
+#endif
+
+} // namespace
+
+SubstringFinder::SubstringFinder(const std::string &query)
+{
+    bool last_was_whitespace = true;  // trims leading whitespace
+    for (char c : query)
+    {
+        if (is_whitespace(c))
+        {
+            if (!last_was_whitespace)
+            {
+                needle.push_back(' ');
+            }
+            last_was_whitespace = true;
+        }
+        else
+        {
+            needle.push_back(fold_case(c));
+            last_was_whitespace = false;
+        }
+    }
+    if (!needle.empty() && needle.back() == ' ')
+    {
+        needle.pop_back();
+    }
+
+    uint32_t num_bytes;
+    needle_starts_word = !needle.empty() && is_search_word_char(
+        utf8_decode(needle.data(), needle.data() + needle.size(), num_bytes)
+    );
+}
+
+bool SubstringFinder::empty() const
+{
+    return needle.empty();
+}
+
+bool SubstringFinder::is_match_at(const char *text, uint32_t text_len, uint32_t offset) const
+{
+    if (offset + needle.size() > text_len)
+    {
+        return false;
+    }
+
+    const char *s = text + offset;
+    for (uint32_t i = 0; i < needle.size(); ++i)
+    {
+        if (fold_case(s[i]) != needle[i])
+        {
+            return false;
+        }
+    }
+
+    // Matching the needle's first byte means offset is on a char boundary
+    return !needle_starts_word || !follows_word_char(text, offset);
+}
+
+void SubstringFinder::find_all(const char *text, uint32_t len, const std::function<bool(uint32_t)> &callback) const
+{
+    uint32_t needle_len = needle.size();
+    if (needle_len == 0 || needle_len > len)
+    {
+        return;
+    }
+
+    uint32_t offset = 0;
+    uint32_t last_offset = len - needle_len;
+
+#if FINDER_NEON || FINDER_SSE2
+    {
+        char first = needle.front();
+        char last = needle.back();
+        bool fold_first = is_ascii_lower(first);
+        bool fold_last = is_ascii_lower(last);
+        block_t first_block = splat(first);
+        block_t last_block = splat(last);
+
+        // Each block checks the 16 positions from offset, which all must be able to hold the needle
+        while (offset + 15 <= last_offset)
+        {
+            uint64_t mask = candidate_mask(
+                eq_folded(load_block(text + offset), first_block, fold_first),
+                eq_folded(load_block(text + offset + needle_len - 1), last_block, fold_last)
+            );
+
+            uint32_t block_end = offset + 16;
+            while (mask)
+            {
+                uint32_t candidate = offset + __builtin_ctzll(mask) / LANE_BITS;
+                mask &= mask - 1;
+
+                if (is_match_at(text, len, candidate))
+                {
+                    if (!callback(candidate))
+                    {
+                        return;
+                    }
+
+                    // Skip overlapping candidates, which may run past this block
+                    uint32_t next = candidate + needle_len;
+                    if (next >= block_end)
+                    {
+                        block_end = next;
+                        break;
+                    }
+                    mask &= ~0ull << ((next - offset) * LANE_BITS);
+                }
+            }
+            offset = block_end;
+        }
+    }
+#endif
+
+    while (offset <= last_offset)
+    {
+        if (is_match_at(text, len, offset))
+        {
+            if (!callback(offset))
+            {
+                return;
+            }
+            offset += needle_len;
+        }
+        else
+        {
+            ++offset;
+        }
+    }
+}
+
+void SubstringFinder::find_all(const std::string &text, const std::function<bool(uint32_t)> &callback) const
+{
+    find_all(text.data(), text.size(), callback);
+}
@@ -0,0 +1,30 @@
+#ifndef SUBSTRING_FINDER_H_
+#define SUBSTRING_FINDER_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Finds a query in utf-8 text without an index. Matching ignores ascii case
+// and treats whitespace runs as a single space. Matches must begin at the
+// start of a word, like the words of an indexed search. Being byte based, it
+// suits prefiltering text for SearchPhraseMatcher by an ascii query.
+class SubstringFinder
+{
+    std::string needle;  // lowercased, whitespace compacted
+    bool needle_starts_word;
+
+    bool is_match_at(const char *text, uint32_t text_len, uint32_t offset) const;
+
+public:
+    SubstringFinder(const std::string &query);
+
+    bool empty() const;
+
+    // Receives the byte offset of each non-overlapping match in text, in order.
+    // Return false from the callback to stop early.
+    void find_all(const char *text, uint32_t len, const std::function<bool(uint32_t)> &callback) const;
+    void find_all(const std::string &text, const std::function<bool(uint32_t)> &callback) const;
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "../search_index.h"
+#include "../token_addressing.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+namespace
+{
+
+std::vector<std::pair<std::string, uint32_t>> split_words(const std::string &text)
+{
+    std::vector<std::pair<std::string, uint32_t>> words;
+    for_each_search_word(text, [&words](const std::string &word, uint32_t offset) {
+        words.emplace_back(word, offset);
+    });
+    return words;
+}
+
+DocAddr make_address(uint32_t chapter, uint32_t offset)
+{
+    return (static_cast<DocAddr>(chapter) << 32) | offset;
+}
+
+SearchIndex build_index(const std::vector<std::unique_ptr<DocToken>> &tokens)
+{
+    SearchIndexBuilder builder;
+    for (const auto &token : tokens)
+    {
+        builder.add_token(*token);
+    }
+    return builder.build();
+}
+
+std::vector<DocAddr> find_unindexed(const std::vector<std::unique_ptr<DocToken>> &tokens, const std::string &query, uint32_t max_results)
+{
+    std::vector<DocAddr> results;
+    SearchPhraseMatcher matcher(query);
+    for (const auto &token : tokens)
+    {
+        const std::string *text = get_searchable_text(*token);
+        if (text && results.size() < max_results)
+        {
+            matcher.add_text(token->address, *text, [&](DocAddr address) {
+                results.push_back(address);
+                return results.size() < max_results;
+            });
+        }
+    }
+    return results;
+}
+
+std::vector<std::unique_ptr<DocToken>> sample_tokens()
+{
+    std::vector<std::unique_ptr<DocToken>> tokens;
+    tokens.push_back(std::make_unique<HeaderDocToken>(make_address(0, 0), "Chapter One"));
+    tokens.push_back(std::make_unique<TextDocToken>(make_address(0, 10), "The quick brown fox, jumps over the lazy dog."));
+    tokens.push_back(std::make_unique<ImageDocToken>(make_address(0, 46), "fox.png"));
+    tokens.push_back(std::make_unique<ListItemDocToken>(make_address(0, 47), "A quick list", 0));
+    tokens.push_back(std::make_unique<HeaderDocToken>(make_address(1, 0), "Chapter Two"));
+    tokens.push_back(std::make_unique<TextDocToken>(make_address(1, 10), "Quickly, the fox—λάμδα—ran."));
+    return tokens;
+}
+
+} // namespace
+
+TEST(SEARCH_INDEX, split_words)
+{
+    using Words = std::vector<std::pair<std::string, uint32_t>>;
+
+    EXPECT_EQ(split_words(""), Words{});
+    EXPECT_EQ(split_words("  ,. "), Words{});
+    EXPECT_EQ(split_words("Hello, World"), (Words{{"hello", 0}, {"world", 7}}));
+    EXPECT_EQ(split_words("it's 42nd"), (Words{{"it", 0}, {"s", 3}, {"42nd", 5}}));
+    EXPECT_EQ(split_words("“quoted”—dash…"), (Words{{"quoted", 3}, {"dash", 15}}));
+    EXPECT_EQ(split_words("λ漢字 café"), (Words{{"λ漢字", 0}, {"café", 9}}));
+    EXPECT_EQ(split_words("a\xC2\xA0" "b"), (Words{{"a", 0}, {"b", 3}}));
+
+    // Non-ascii case folds too, but never to ascii
+    EXPECT_EQ(split_words("ÉCLAIR Ÿ ŁÓDŹ ΆΣΣΟΣ ЁЖ"), (Words{{"éclair", 0}, {"ÿ", 8}, {"łódź", 11}, {"άσσοσ", 19}, {"ёж", 30}}));
+    EXPECT_EQ(split_words("İı ſ"), (Words{{"İı", 0}, {"ſ", 5}}));
+}
+
+TEST(SEARCH_INDEX, word_addresses)
+{
+    auto tokens = sample_tokens();
+    auto index = build_index(tokens);
+
+    // Word addresses count the address width of the text before them
+    EXPECT_EQ(index.find("chapter", 10), (std::vector<DocAddr>{make_address(0, 0), make_address(1, 0)}));
+    EXPECT_EQ(index.find("quick", 10), (std::vector<DocAddr>{make_address(0, 13), make_address(0, 48), make_address(1, 10)}));
+    EXPECT_EQ(index.find("lazy", 10), (std::vector<DocAddr>{make_address(0, 10 + get_address_width("The quick brown fox, jumps over the "))}));
+    EXPECT_EQ(index.find("λάμδα", 10), (std::vector<DocAddr>{make_address(1, 10 + get_address_width("Quickly, the fox—"))}));
+
+    // Images aren't searchable
+    EXPECT_EQ(index.find("png", 10), std::vector<DocAddr>{});
+}
+
+TEST(SEARCH_INDEX, find)
+{
+    auto tokens = sample_tokens();
+    auto index = build_index(tokens);
+
+    // Case insensitive
+    EXPECT_EQ(index.find("FOX", 10).size(), 2);
+
+    // The last word matches as a prefix
+    EXPECT_EQ(index.find("quic", 10).size(), 3);
+    EXPECT_EQ(index.find("quick", 10).size(), 3);
+    EXPECT_EQ(index.find("quickly", 10).size(), 1);
+    EXPECT_EQ(index.find("quick brown", 10).size(), 1);
+
+    // Earlier words must match exactly and in order
+    EXPECT_EQ(index.find("qui brown", 10).size(), 0);
+    EXPECT_EQ(index.find("brown quick", 10).size(), 0);
+    EXPECT_EQ(index.find("the fox", 10), (std::vector<DocAddr>{make_address(1, 10 + get_address_width("Quickly, "))}));
+    EXPECT_EQ(index.find("  lazy,  DOG! ", 10).size(), 1);
+
+    // Punctuation between words is skipped, other words aren't
+    EXPECT_EQ(index.find("fox jumps", 10).size(), 1);
+    EXPECT_EQ(index.find("fox λάμδα ran", 10).size(), 1);
+    EXPECT_EQ(index.find("jumps the", 10).size(), 0);
+    EXPECT_EQ(index.find("chapter dog", 10).size(), 0);
+    EXPECT_EQ(index.find("list chapter", 10).size(), 0);
+
+    EXPECT_EQ(index.find("", 10).size(), 0);
+    EXPECT_EQ(index.find("...", 10).size(), 0);
+    EXPECT_EQ(index.find("missing", 10).size(), 0);
+    EXPECT_EQ(index.find("quic", 2), (std::vector<DocAddr>{make_address(0, 13), make_address(0, 48)}));
+}
+
+TEST(SEARCH_INDEX, unindexed_matches_index)
+{
+    auto tokens = sample_tokens();
+    tokens.push_back(std::make_unique<TextDocToken>(make_address(1, 40), "ÉCOLE d'été, École… «Ελλάδα» ΣΟΦΊΑ"));
+    tokens.push_back(std::make_unique<TextDocToken>(make_address(1, 80), "Fox fox the fox"));
+    tokens.push_back(std::make_unique<TextDocToken>(make_address(1, 92), "jumps! the end"));
+    tokens.push_back(std::make_unique<TextDocToken>(make_address(2, 0), "the the the"));
+    auto index = build_index(tokens);
+
+    const char *queries[] = {
+        "fox", "FOX", "quic", "quick brown", "qui brown", "the fox", "fox jumps", "fox λάμδα ran",
+        "lazy, dog!", "jumps the", "list chapter", "école", "ÉCOLE D", "d été école", "ελλάδα σοφία",
+        "σοφ", "fox the", "fox fox", "fox jumps the", "the the", "the", "...", "", "missing",
+    };
+    for (const char *query : queries)
+    {
+        for (uint32_t max_results : {1, 2, 100})
+        {
+            EXPECT_EQ(find_unindexed(tokens, query, max_results), index.find(query, max_results))
+                << "query: \"" << query << "\", max results " << max_results;
+        }
+    }
+
+    EXPECT_EQ(index.find("École", 10), (std::vector<DocAddr>{make_address(1, 40), make_address(1, 40 + get_address_width("ÉCOLE d'été, "))}));
+    EXPECT_EQ(index.find("ελλάδα σοφία", 10).size(), 1);
+    EXPECT_EQ(index.find("fox jumps the", 10), (std::vector<DocAddr>{make_address(1, 80 + get_address_width("Fox fox the "))}));
+}
+
+TEST(SEARCH_INDEX, out_of_order_tokens)
+{
+    SearchIndexBuilder builder;
+    builder.add_text(make_address(2, 0), "word");
+    builder.add_text(make_address(0, 0), "word word");
+    builder.add_text(make_address(0, 0), "word");
+    auto index = builder.build();
+
+    EXPECT_EQ(index.find("word", 10), (std::vector<DocAddr>{make_address(0, 0), make_address(0, 4), make_address(2, 0)}));
+}
+
+TEST(SEARCH_INDEX, serialization)
+{
+    auto tokens = sample_tokens();
+    auto index = build_index(tokens);
+
+    std::stringstream ss;
+    index.write(ss);
+    std::string data = ss.str();
+
+    std::stringstream in(data);
+    auto loaded = SearchIndex::read(in);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->num_terms(), index.num_terms());
+
+    for (const char *query : {"chapter", "quick", "the fox", "λάμδα", "dog"})
+    {
+        EXPECT_EQ(loaded->find(query, 10), index.find(query, 10)) << query;
+    }
+
+    // Truncated or corrupt data is rejected
+    for (uint32_t len = 0; len < data.size(); ++len)
+    {
+        std::stringstream truncated(data.substr(0, len));
+        EXPECT_FALSE(SearchIndex::read(truncated).has_value()) << len;
+    }
+
+    std::string bad_magic = data;
+    bad_magic[0] = 'X';
+    std::stringstream bad(bad_magic);
+    EXPECT_FALSE(SearchIndex::read(bad).has_value());
+}
+
+TEST(SEARCH_INDEX, read_corrupt)
+{
+    auto write_index = [](const std::vector<std::pair<std::string, uint64_t>> &terms, const std::string &postings) {
+        std::string data = "SIDX";
+        auto append_varint = [&data](uint64_t value) {
+            while (value >= 0x80)
+            {
+                data += static_cast<char>((value & 0x7F) | 0x80);
+                value >>= 7;
+            }
+            data += static_cast<char>(value);
+        };
+
+        append_varint(2);  // version
+        append_varint(terms.size());
+        for (const auto &[term, postings_len] : terms)
+        {
+            append_varint(term.size());
+            data += term;
+            append_varint(postings_len);
+        }
+        return data + postings;
+    };
+
+    auto read_index = [](const std::string &data) {
+        std::stringstream ss(data);
+        return SearchIndex::read(ss);
+    };
+
+    // Sanity check the hand written format
+    auto valid = read_index(write_index({{"a", 1}, {"b", 2}}, std::string("\x01\x02\x03", 3)));
+    ASSERT_TRUE(valid.has_value());
+    EXPECT_EQ(valid->find("a", 10), (std::vector<DocAddr>{1}));
+    EXPECT_EQ(valid->find("b", 10), (std::vector<DocAddr>{2, 5}));
+
+    // Offsets that wrap around to the start
+    EXPECT_FALSE(read_index(write_index({{"a", 0xFFFFFFFFull}, {"b", 2}}, std::string("\x01\x02\x03", 3))).has_value());
+    EXPECT_FALSE(read_index(write_index({{"a", 1ull << 32}, {"b", 1}}, std::string("\x01", 1))).has_value());
+
+    // Postings longer than the data left
+    EXPECT_FALSE(read_index(write_index({{"a", 1000}}, std::string(10, '\x01'))).has_value());
+
+    // Unsorted or duplicate terms
+    EXPECT_FALSE(read_index(write_index({{"b", 1}, {"a", 1}}, std::string("\x01\x01", 2))).has_value());
+    EXPECT_FALSE(read_index(write_index({{"a", 1}, {"a", 1}}, std::string("\x01\x01", 2))).has_value());
+}
@@ -0,0 +1,152 @@
+#include "../substring_finder.h"
+#include "../search_index.h"
+#include "util/utf8.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace
+{
+
+std::vector<uint32_t> find_all(const std::string &query, const std::string &text)
+{
+    std::vector<uint32_t> offsets;
+    SubstringFinder(query).find_all(text, [&offsets](uint32_t offset) {
+        offsets.push_back(offset);
+        return true;
+    });
+    return offsets;
+}
+
+char lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+// Straightforward implementation of the same rules, for comparison
+std::vector<uint32_t> reference_find_all(const std::string &needle, const std::string &text)
+{
+    std::vector<uint32_t> offsets;
+    if (needle.empty())
+    {
+        return offsets;
+    }
+
+    uint32_t num_bytes;
+    bool needle_starts_word = is_search_word_char(utf8_decode(needle.data(), needle.data() + needle.size(), num_bytes));
+
+    uint32_t offset = 0;
+    while (offset + needle.size() <= text.size())
+    {
+        bool matches = true;
+        for (uint32_t i = 0; i < needle.size() && matches; ++i)
+        {
+            matches = lower(text[offset + i]) == needle[i];
+        }
+
+        if (matches && needle_starts_word && offset > 0)
+        {
+            // Decode the char before offset
+            uint32_t start = offset - 1;
+            while (start > 0 && (text[start] & 0xC0) == 0x80 && offset - start < 4)
+            {
+                --start;
+            }
+            matches = !is_search_word_char(utf8_decode(text.data() + start, text.data() + offset, num_bytes));
+        }
+
+        if (matches)
+        {
+            offsets.push_back(offset);
+            offset += needle.size();
+        }
+        else
+        {
+            ++offset;
+        }
+    }
+    return offsets;
+}
+
+} // namespace
+
+TEST(SUBSTRING_FINDER, query_normalization)
+{
+    EXPECT_TRUE(SubstringFinder("").empty());
+    EXPECT_TRUE(SubstringFinder(" \t\n").empty());
+    EXPECT_FALSE(SubstringFinder(" a ").empty());
+
+    EXPECT_EQ(find_all("  Quick \n  Brown ", "The quick brown fox"), std::vector<uint32_t>{4});
+}
+
+TEST(SUBSTRING_FINDER, find_all)
+{
+    using Offsets = std::vector<uint32_t>;
+
+    EXPECT_EQ(find_all("fox", ""), Offsets{});
+    EXPECT_EQ(find_all("fox", "fo"), Offsets{});
+    EXPECT_EQ(find_all("fox", "fox"), Offsets{0});
+    EXPECT_EQ(find_all("FOX", "The Fox and the fOX"), (Offsets{4, 16}));
+
+    // Matches start at words, but may end mid word
+    EXPECT_EQ(find_all("he", "the hen"), Offsets{4});
+    EXPECT_EQ(find_all("fox", "foxes, outfox"), Offsets{0});
+    EXPECT_EQ(find_all("fox", "“fox”—fox"), (Offsets{3, 12}));
+    EXPECT_EQ(find_all("fox", "λfox"), Offsets{});
+
+    // Queries starting with punctuation can match anywhere
+    EXPECT_EQ(find_all("'s", "fox's"), Offsets{3});
+
+    // Non-overlapping
+    EXPECT_EQ(find_all("aa", "aaaaa"), Offsets{0});
+    EXPECT_EQ(find_all("a a", "a a a a"), (Offsets{0, 4}));
+
+    // Non-ascii isn't case folded
+    EXPECT_EQ(find_all("λάμδα", "ΛΆΜΔΑ λάμδα"), Offsets{11});
+}
+
+TEST(SUBSTRING_FINDER, stops_early)
+{
+    std::string text(1000, ' ');
+    for (uint32_t i = 0; i < text.size(); i += 10)
+    {
+        text[i] = 'x';
+    }
+
+    uint32_t calls = 0;
+    SubstringFinder("x").find_all(text, [&calls](uint32_t) {
+        return ++calls < 3;
+    });
+    EXPECT_EQ(calls, 3);
+}
+
+TEST(SUBSTRING_FINDER, matches_reference_random_text)
+{
+    const std::vector<std::string> fragments = {
+        "a", "b", "A", "B", "ab", "AB", " ", "  ", "\n", ",", "'", "-", "x",
+        "λ", "—", "“", "é", "漢", "\xC2\xA0", "\x80", "\xE2",
+    };
+    const std::vector<std::string> needles = {
+        "a", "b", "ab", "ba", "aba", "a b", "ab ab", "'a", "-", "λa", "aλ", "a—b",
+        "é", "abababababababababab", "a a a a a a a a a", "b,",
+    };
+
+    std::mt19937 rng(42);
+    auto pick = [&rng](uint32_t n) {
+        return std::uniform_int_distribution<uint32_t>(0, n - 1)(rng);
+    };
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        std::string text;
+        uint32_t num_fragments = pick(120);
+        for (uint32_t f = 0; f < num_fragments; ++f)
+        {
+            text += fragments[pick(fragments.size())];
+        }
+
+        const std::string &needle = needles[pick(needles.size())];
+        ASSERT_EQ(find_all(needle, text), reference_find_all(needle, text)) << needle << " in " << text;
+    }
+}
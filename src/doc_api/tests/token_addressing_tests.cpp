@@ -2,6 +2,10 @@
 
 #include <gtest/gtest.h>
 
+#include <cstring>
+#include <functional>
+#include <random>
+
 TEST(TOKEN_ADDRESSING, get_address_width)
 {
     EXPECT_EQ(get_address_width(""), 0);
@@ -9,3 +13,117 @@ TEST(TOKEN_ADDRESSING, get_address_width)
     EXPECT_EQ(get_address_width("asdf"), 4);
     EXPECT_EQ(get_address_width("\tasdf λv\n\r"), 6);
 }
+
+TEST(TOKEN_ADDRESSING, get_address_width_len)
+{
+    const char *str = "\tasdf λv\n\r";
+    EXPECT_EQ(get_address_width(str, 0), 0);
+    EXPECT_EQ(get_address_width(str, 3), 2);
+    EXPECT_EQ(get_address_width(str, strlen(str)), get_address_width(str));
+}
+
+// Original char by char implementation, which addresses must stay compatible with
+static uint32_t reference_address_width(const char *str)
+{
+    uint32_t count = 0;
+    char c;
+    while ((c = *str))
+    {
+        if (!(c == ' ' || c == '\t' || c == '\r' || c == '\n'))
+        {
+            ++count;
+        }
+        while ((*++str & 0xC0) == 0x80);
+    }
+    return count;
+}
+
+TEST(TOKEN_ADDRESSING, get_address_width_matches_reference_short_strings)
+{
+    // Every string up to 4 bytes over bytes from each class that matters
+    const std::vector<char> alphabet = {
+        'a', ' ', '\t', '\r', '\n', '\x01', '\x7F',
+        '\x80', '\xBF', '\xC3', '\xE2', '\xF0', '\xFF'
+    };
+
+    char buf[5] = {};
+    std::function<void(int)> check = [&](int depth) {
+        ASSERT_EQ(get_address_width(buf), reference_address_width(buf)) << buf;
+        ASSERT_EQ(get_address_width(buf, depth), reference_address_width(buf)) << buf;
+        if (depth == 4)
+        {
+            return;
+        }
+        for (char c : alphabet)
+        {
+            buf[depth] = c;
+            check(depth + 1);
+        }
+        buf[depth] = 0;
+    };
+    check(0);
+}
+
+TEST(TOKEN_ADDRESSING, get_address_width_matches_reference_every_byte_position)
+{
+    // Each byte value at each position of strings spanning several vector blocks
+    for (int len = 1; len <= 70; ++len)
+    {
+        for (int pos = 0; pos < len; ++pos)
+        {
+            for (int b = 1; b < 256; ++b)
+            {
+                std::string s(len, 'x');
+                s[pos] = static_cast<char>(b);
+                ASSERT_EQ(get_address_width(s.c_str()), reference_address_width(s.c_str())) << len << " " << pos << " " << b;
+            }
+        }
+    }
+}
+
+TEST(TOKEN_ADDRESSING, get_address_width_matches_reference_random_text)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte_dist(1, 255);
+    std::uniform_int_distribution<int> kind_dist(0, 3);
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        // Mix of random bytes, whitespace and valid multi-byte chars, unaligned starts and lengths up to several kB
+        std::string s;
+        uint32_t len = rng() % (i < 1000 ? 64 : 8192);
+        while (s.size() < len)
+        {
+            switch (kind_dist(rng))
+            {
+                case 0:
+                    s.push_back(static_cast<char>(byte_dist(rng)));
+                    break;
+                case 1:
+                    s += " \t\r\n"[rng() % 4];
+                    break;
+                case 2:
+                    s += "λ漢😀";
+                    break;
+                default:
+                    s += "word";
+                    break;
+            }
+        }
+
+        uint32_t offset = s.empty() ? 0 : rng() % s.size();
+        const char *str = s.c_str() + offset;
+        ASSERT_EQ(get_address_width(str), reference_address_width(str));
+        ASSERT_EQ(get_address_width(std::string(str)), reference_address_width(str));
+    }
+}
+
+TEST(TOKEN_ADDRESSING, get_address_width_len_stops_at_len)
+{
+    std::string s = "λv word   more\xC3\xA9text";
+    for (uint32_t len = 0; len <= s.size(); ++len)
+    {
+        std::string prefix = s.substr(0, len);
+        ASSERT_EQ(get_address_width(s.c_str(), len), reference_address_width(prefix.c_str())) << len;
+    }
+}
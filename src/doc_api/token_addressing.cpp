@@ -1,6 +1,15 @@
 #include "./token_addressing.h"
 #include "util/str_utils.h"
-#include "util/utf8.h"
+
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define ADDRESSING_NEON 1
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+    #define ADDRESSING_SSE2 1
+#endif
 
 namespace {
 
@@ -13,6 +22,103 @@ inline bool char_has_width(char c)
     return !is_whitespace(c);
 }
 
+inline bool is_utf8_continuation(char c)
+{
+    return (c & 0xC0) == 0x80;
+}
+
+// Stepping through a string char by char visits the first byte and every
+// later byte that isn't a utf-8 continuation. So apart from the first byte,
+// the width is a count of bytes that are neither continuations nor whitespace,
+// which can be done in bulk.
+uint32_t count_width_bytes_scalar(const char *s, uint32_t len)
+{
+    uint32_t count = 0;
+    for (const char *end = s + len; s < end; ++s)
+    {
+        if (!is_utf8_continuation(*s) && char_has_width(*s))
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+#if ADDRESSING_NEON
+
+uint32_t count_width_bytes(const char *s, uint32_t len)
+{
+    const uint8x16_t cont_mask = vdupq_n_u8(0xC0);
+    const uint8x16_t cont_bits = vdupq_n_u8(0x80);
+    const uint8x16_t space = vdupq_n_u8(' ');
+    const uint8x16_t tab = vdupq_n_u8('\t');
+    const uint8x16_t cr = vdupq_n_u8('\r');
+    const uint8x16_t lf = vdupq_n_u8('\n');
+
+    uint32_t count = 0;
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(s);
+
+    while (len >= 16)
+    {
+        // Per lane counters overflow after 255 blocks
+        uint32_t num_blocks = len / 16 < 255 ? len / 16 : 255;
+        uint8x16_t acc = vdupq_n_u8(0);
+
+        for (uint32_t i = 0; i < num_blocks; ++i, p += 16)
+        {
+            uint8x16_t v = vld1q_u8(p);
+            uint8x16_t skip = vceqq_u8(vandq_u8(v, cont_mask), cont_bits);
+            skip = vorrq_u8(skip, vceqq_u8(v, space));
+            skip = vorrq_u8(skip, vceqq_u8(v, tab));
+            skip = vorrq_u8(skip, vceqq_u8(v, cr));
+            skip = vorrq_u8(skip, vceqq_u8(v, lf));
+            // counted lanes are 0 in skip, add 1 for each
+            acc = vaddq_u8(acc, vaddq_u8(skip, vdupq_n_u8(1)));
+        }
+
+        uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(acc)));
+        count += vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1);
+        len -= num_blocks * 16;
+    }
+
+    return count + count_width_bytes_scalar(reinterpret_cast<const char *>(p), len);
+}
+
+#elif ADDRESSING_SSE2
+
+uint32_t count_width_bytes(const char *s, uint32_t len)
+{
+    const __m128i cont_mask = _mm_set1_epi8(static_cast<char>(0xC0));
+    const __m128i cont_bits = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    uint32_t count = 0;
+    for (; len >= 16; s += 16, len -= 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+        __m128i skip = _mm_cmpeq_epi8(_mm_and_si128(v, cont_mask), cont_bits);
+        skip = _mm_or_si128(skip, _mm_cmpeq_epi8(v, space));
+        skip = _mm_or_si128(skip, _mm_cmpeq_epi8(v, tab));
+        skip = _mm_or_si128(skip, _mm_cmpeq_epi8(v, cr));
+        skip = _mm_or_si128(skip, _mm_cmpeq_epi8(v, lf));
+        count += 16 - __builtin_popcount(_mm_movemask_epi8(skip));
+    }
+
+    return count + count_width_bytes_scalar(s, len);
+}
+
+#else
+
+uint32_t count_width_bytes(const char *s, uint32_t len)
+{
+    return count_width_bytes_scalar(s, len);
+}
+
+#endif
+
 } // namespace
 
 uint32_t get_address_width(const char *str)
@@ -21,18 +127,18 @@ uint32_t get_address_width(const char *str)
     {
         return 0;
     }
+    return get_address_width(str, strlen(str));
+}
 
-    uint32_t count = 0;
-    char c;
-    while ((c = *str))
+uint32_t get_address_width(const char *str, uint32_t len)
+{
+    if (!str || len == 0)
     {
-        if (char_has_width(c))
-        {
-            ++count;
-        }
-        str = utf8_step(str);
+        return 0;
     }
-    return count;
+
+    // The first byte counts even if it's a stray continuation byte
+    return (char_has_width(str[0]) ? 1 : 0) + count_width_bytes(str + 1, len - 1);
 }
 
 uint32_t get_address_width(const std::string &str)
@@ -5,6 +5,7 @@
 #include <cstdint>
 
 uint32_t get_address_width(const char *str);
+uint32_t get_address_width(const char *str, uint32_t len);
 uint32_t get_address_width(const std::string &str);
 uint32_t get_address_width(const DocToken &token);
 
@@ -5,10 +5,67 @@
 #include "doc_api/token_addressing.h"
 #include "util/zip_utils.h"
 
+#include <libxml/parser.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 #define DEBUG 0
 
+// Typical ratio of address width to xhtml size, used until some documents are measured
+#define DEFAULT_WIDTH_PER_BYTE 0.5
+
+struct BackgroundMeasure
+{
+    std::thread thread;
+    std::atomic<bool> stop = false;
+
+    std::mutex mutex;
+    std::vector<std::pair<uint32_t, uint32_t>> measured;  // (spine index, width) not yet synced
+};
+
+namespace
+{
+
+uint32_t tokens_address_width(const std::vector<std::unique_ptr<DocToken>> &tokens, uint32_t spine_index)
+{
+    if (tokens.empty())
+    {
+        return 0;
+    }
+
+    const auto &last_token = tokens[tokens.size() - 1];
+    return last_token->address + get_address_width(*last_token) - make_address(spine_index);
+}
+
+// Measure a document without caching its tokens. Safe to call concurrently with a zip handle and parser per thread.
+uint32_t scan_address_width(zip_t *zip, XhtmlParser &parser, const std::filesystem::path &zip_path, uint32_t spine_index)
+{
+    auto bytes = read_zip_file_str(zip, zip_path);
+    if (bytes.empty())
+    {
+        std::cerr << "Unable to read item " << zip_path << std::endl;
+        return 0;
+    }
+
+    if (auto width = parser.scan_address_width(bytes.data()))
+    {
+        return *width;
+    }
+
+    std::vector<std::unique_ptr<DocToken>> tokens;
+    std::unordered_map<std::string, DocAddr> id_to_addr;
+    parser.parse_tokens(bytes.data(), zip_path, spine_index, tokens, id_to_addr);
+
+    return tokens_address_width(tokens, spine_index);
+}
+
+} // namespace
+
 Document::Document() : cache_is_valid(true) {}
 
 Document::Document(std::filesystem::path zip_path)
@@ -39,7 +96,7 @@ const std::vector<std::unique_ptr<DocToken>> &EpubDocIndex::ensure_cached(uint32
             return empty_tokens;
         }
 
-        parse_xhtml_tokens(
+        parser->parse_tokens(
             bytes.data(),
             document.zip_path,
             spine_index,
@@ -47,13 +104,50 @@ const std::vector<std::unique_ptr<DocToken>> &EpubDocIndex::ensure_cached(uint32
             document.id_to_addr_cache
         );
         document.cache_is_valid = true;
+
+        if (!doc_widths_cache[spine_index])
+        {
+            set_address_width(spine_index, tokens_address_width(document.tokens_cache, spine_index));
+        }
+
+        if (max_cached_documents)
+        {
+            cached_order.push_back(spine_index);
+            evict_cached_documents(spine_index);
+        }
     }
 
     return document.tokens_cache;
 }
 
+void EpubDocIndex::evict_cached_documents(uint32_t keep_spine_index) const
+{
+    while (cached_order.size() > max_cached_documents)
+    {
+        auto it = cached_order.begin();
+        if (*it == keep_spine_index)
+        {
+            ++it;
+        }
+
+        auto &document = spine_entries[*it];
+        document.tokens_cache.clear();
+        document.tokens_cache.shrink_to_fit();
+        document.id_to_addr_cache.clear();
+        document.cache_is_valid = false;
+
+        cached_order.erase(it);
+    }
+}
+
+void EpubDocIndex::set_address_width(uint32_t spine_index, uint32_t width) const
+{
+    doc_widths_cache[spine_index] = width;
+    ++doc_widths_version;
+}
+
 EpubDocIndex::EpubDocIndex(const PackageContents &package, zip_t *zip, std::vector<uint32_t> _doc_widths_cache)
-    : zip(zip), doc_widths_cache(package.spine_ids.size())
+    : zip(zip), doc_widths_cache(package.spine_ids.size()), parser(std::make_unique<XhtmlParser>())
 {
     uint32_t num_spine_entries = package.spine_ids.size();
     bool cache_is_valid = num_spine_entries == _doc_widths_cache.size();
@@ -79,6 +173,36 @@ EpubDocIndex::EpubDocIndex(const PackageContents &package, zip_t *zip, std::vect
     }
 }
 
+EpubDocIndex::~EpubDocIndex()
+{
+    if (background_measure)
+    {
+        background_measure->stop = true;
+        background_measure->thread.join();
+    }
+}
+
+void EpubDocIndex::set_max_cached_documents(uint32_t max_documents)
+{
+    max_cached_documents = max_documents;
+    cached_order.clear();
+    if (!max_documents)
+    {
+        return;
+    }
+
+    // Documents loaded so far are treated as oldest
+    for (uint32_t spine_index = 0; spine_index < spine_entries.size(); ++spine_index)
+    {
+        const auto &document = spine_entries[spine_index];
+        if (document.cache_is_valid && !document.zip_path.empty())
+        {
+            cached_order.push_back(spine_index);
+        }
+    }
+    evict_cached_documents(spine_entries.size());
+}
+
 uint32_t EpubDocIndex::spine_size() const
 {
     return spine_entries.size();
@@ -109,16 +233,261 @@ uint32_t EpubDocIndex::address_width(uint32_t spine_index) const
         }
         else
         {
-            const auto &_tokens = ensure_cached(spine_index);
-            if (_tokens.size())
+            width = tokens_address_width(ensure_cached(spine_index), spine_index);
+            set_address_width(spine_index, width);
+        }
+    }
+    return width;
+}
+
+bool EpubDocIndex::precompute_address_widths(
+    const std::filesystem::path &epub_path,
+    const std::function<bool(uint32_t, uint32_t)> &on_progress,
+    uint32_t max_threads
+)
+{
+    // Documents that need parsing. Others are cached or have no content.
+    std::vector<uint32_t> pending;
+    for (uint32_t spine_index = 0; spine_index < spine_size(); ++spine_index)
+    {
+        if (!doc_widths_cache[spine_index] && !spine_entries[spine_index].cache_is_valid)
+        {
+            pending.push_back(spine_index);
+        }
+    }
+
+    const uint32_t total = pending.size();
+    std::vector<uint32_t> widths(total, 0);
+
+    std::atomic<uint32_t> next_job = 0;
+    std::atomic<bool> abort = false;
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    uint32_t num_done = 0;
+
+    auto run_job = [&](zip_t *job_zip, XhtmlParser &job_parser) {
+        uint32_t job = next_job++;
+        if (job >= total)
+        {
+            return false;
+        }
+
+        uint32_t spine_index = pending[job];
+        widths[job] = scan_address_width(job_zip, job_parser, spine_entries[spine_index].zip_path, spine_index);
+
+        {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            ++num_done;
+        }
+        done_cv.notify_one();
+        return true;
+    };
+
+    auto report_progress = [&]() {
+        uint32_t done;
+        {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            done = num_done;
+        }
+        return !on_progress || on_progress(done, total);
+    };
+
+    // Must be initialized before parsing on multiple threads
+    xmlInitParser();
+
+    // This thread takes part too, using the existing handle
+    uint32_t num_threads = max_threads ? max_threads : std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min(num_threads, std::max(1u, total));
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < num_threads; ++i)
+    {
+        workers.emplace_back([&]() {
+            int err = 0;
+            zip_t *worker_zip = zip_open(epub_path.c_str(), ZIP_RDONLY, &err);
+            if (worker_zip == nullptr)
             {
-                const auto &last_token = _tokens[_tokens.size() - 1];
-                width = last_token->address + get_address_width(*last_token) - make_address(spine_index);
+                std::cerr << "Worker failed to open " << epub_path << " code: " << err << std::endl;
+                return;
             }
-            doc_widths_cache[spine_index] = width;
+
+            XhtmlParser worker_parser;
+            while (!abort && run_job(worker_zip, worker_parser))
+            {
+            }
+
+            zip_close(worker_zip);
+        });
+    }
+
+    while (!abort)
+    {
+        if (!report_progress())
+        {
+            abort = true;
+        }
+        else if (!run_job(zip, *parser))
+        {
+            break;
         }
     }
-    return width;
+
+    // Wait for the remaining jobs on other workers
+    {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        while (!abort && num_done < total)
+        {
+            done_cv.wait(lock);
+
+            lock.unlock();
+            if (!report_progress())
+            {
+                abort = true;
+            }
+            lock.lock();
+        }
+    }
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    if (abort)
+    {
+        return false;
+    }
+
+    for (uint32_t job = 0; job < total; ++job)
+    {
+        set_address_width(pending[job], widths[job]);
+    }
+
+    return true;
+}
+
+void EpubDocIndex::start_background_measure(
+    const std::filesystem::path &epub_path,
+    std::function<void(const std::vector<uint32_t> &)> on_complete
+)
+{
+    if (background_measure)
+    {
+        return;
+    }
+
+    // Only documents that need parsing are left to the background thread
+    std::vector<std::optional<uint32_t>> widths;
+    std::vector<std::filesystem::path> doc_paths;
+    for (uint32_t spine_index = 0; spine_index < spine_size(); ++spine_index)
+    {
+        if (spine_entries[spine_index].cache_is_valid)
+        {
+            address_width(spine_index);
+        }
+        widths.push_back(doc_widths_cache[spine_index]);
+        doc_paths.push_back(spine_entries[spine_index].zip_path);
+    }
+
+    // Must be initialized before parsing on another thread
+    xmlInitParser();
+
+    background_measure = std::make_unique<BackgroundMeasure>();
+    BackgroundMeasure *measure = background_measure.get();
+
+    measure->thread = std::thread([measure, epub_path, doc_paths, widths, on_complete]() mutable {
+        int err = 0;
+        zip_t *worker_zip = zip_open(epub_path.c_str(), ZIP_RDONLY, &err);
+        if (worker_zip == nullptr)
+        {
+            std::cerr << "Background measure failed to open " << epub_path << " code: " << err << std::endl;
+            return;
+        }
+
+        XhtmlParser worker_parser;
+        for (uint32_t spine_index = 0; spine_index < widths.size() && !measure->stop; ++spine_index)
+        {
+            if (widths[spine_index])
+            {
+                continue;
+            }
+
+            uint32_t width = scan_address_width(worker_zip, worker_parser, doc_paths[spine_index], spine_index);
+            widths[spine_index] = width;
+
+            std::lock_guard<std::mutex> lock(measure->mutex);
+            measure->measured.emplace_back(spine_index, width);
+        }
+
+        zip_close(worker_zip);
+
+        if (measure->stop || !on_complete)
+        {
+            return;
+        }
+
+        std::vector<uint32_t> all_widths;
+        all_widths.reserve(widths.size());
+        for (const auto &width : widths)
+        {
+            all_widths.push_back(width.value_or(0));
+        }
+        on_complete(all_widths);
+    });
+}
+
+uint32_t EpubDocIndex::sync_address_widths() const
+{
+    if (background_measure)
+    {
+        std::lock_guard<std::mutex> lock(background_measure->mutex);
+        for (const auto &[spine_index, width] : background_measure->measured)
+        {
+            if (!doc_widths_cache[spine_index])
+            {
+                set_address_width(spine_index, width);
+            }
+        }
+        background_measure->measured.clear();
+    }
+
+    return doc_widths_version;
+}
+
+std::vector<uint32_t> EpubDocIndex::estimated_address_widths() const
+{
+    if (doc_sizes_cache.empty())
+    {
+        for (const auto &document : spine_entries)
+        {
+            doc_sizes_cache.push_back(
+                document.zip_path.empty() ? 0 : zip_file_size(zip, document.zip_path)
+            );
+        }
+    }
+
+    // Scale sizes by the text density of the documents measured so far
+    uint64_t known_width = 0;
+    uint64_t known_size = 0;
+    for (uint32_t spine_index = 0; spine_index < spine_size(); ++spine_index)
+    {
+        if (doc_widths_cache[spine_index] && doc_sizes_cache[spine_index])
+        {
+            known_width += *doc_widths_cache[spine_index];
+            known_size += doc_sizes_cache[spine_index];
+        }
+    }
+    double width_per_byte = known_size ? static_cast<double>(known_width) / known_size : DEFAULT_WIDTH_PER_BYTE;
+
+    std::vector<uint32_t> widths;
+    widths.reserve(spine_size());
+    for (uint32_t spine_index = 0; spine_index < spine_size(); ++spine_index)
+    {
+        widths.push_back(
+            doc_widths_cache[spine_index].value_or(doc_sizes_cache[spine_index] * width_per_byte)
+        );
+    }
+    return widths;
 }
 
 const std::vector<std::unique_ptr<DocToken>> &EpubDocIndex::tokens(uint32_t spine_index) const
@@ -7,6 +7,7 @@
 #include <zip.h>
 
 #include <filesystem>
+#include <functional>
 #include <unordered_map>
 #include <optional>
 #include <vector>
@@ -23,6 +24,9 @@ struct Document
     Document(std::filesystem::path zip_path);
 };
 
+struct BackgroundMeasure;
+class XhtmlParser;
+
 // Provide access to documents listed in the spine.
 // Documents are addressed by spine index. Lazy load from zip.
 class EpubDocIndex
@@ -30,13 +34,29 @@ class EpubDocIndex
     zip_t *zip;
     mutable std::vector<Document> spine_entries;
     mutable std::vector<std::optional<uint32_t>> doc_widths_cache;
+    mutable uint32_t doc_widths_version = 0;
+    mutable std::vector<uint64_t> doc_sizes_cache;
+
+    // Spine indices with parsed tokens, oldest first. Only tracked when bounded.
+    uint32_t max_cached_documents = 0;
+    mutable std::vector<uint32_t> cached_order;
+
+    std::unique_ptr<XhtmlParser> parser;  // for this thread, workers have their own
+    std::unique_ptr<BackgroundMeasure> background_measure;
 
     const std::vector<std::unique_ptr<DocToken>> &ensure_cached(uint32_t spine_index) const;
+    void set_address_width(uint32_t spine_index, uint32_t width) const;
+    void evict_cached_documents(uint32_t keep_spine_index) const;
 
 public:
     EpubDocIndex(const PackageContents &package, zip_t *zip, std::vector<uint32_t> doc_widths_cache);
     EpubDocIndex(const EpubDocIndex &) = delete;
     EpubDocIndex &operator=(const EpubDocIndex &) = delete;
+    ~EpubDocIndex();
+
+    // Keep at most max_documents parsed at once, dropping the least recently
+    // loaded. Tokens from a dropped document are invalidated. 0 for no limit.
+    void set_max_cached_documents(uint32_t max_documents);
 
     // Number of spine entries
     uint32_t spine_size() const;
@@ -49,6 +69,31 @@ public:
     // Address space consumed by spine entry
     uint32_t address_width(uint32_t spine_index) const;
 
+    // Compute all uncached address widths up front, parsing documents on up to
+    // max_threads threads (0 for one per core), including the calling thread.
+    // Extra workers each open their own handle to epub_path.
+    // on_progress(done, total) may return false to abort, returns false if aborted.
+    bool precompute_address_widths(
+        const std::filesystem::path &epub_path,
+        const std::function<bool(uint32_t, uint32_t)> &on_progress,
+        uint32_t max_threads = 0
+    );
+
+    // Measure uncached address widths on a background thread, which opens its own
+    // handle to epub_path. Once all are known, on_complete receives every width
+    // on that thread. Measurements become visible through sync_address_widths().
+    void start_background_measure(
+        const std::filesystem::path &epub_path,
+        std::function<void(const std::vector<uint32_t> &)> on_complete
+    );
+
+    // Take in background measurements. Returns a counter that changes whenever
+    // the set of known address widths changes.
+    uint32_t sync_address_widths() const;
+
+    // Known address widths, with the rest estimated from their size in the zip.
+    std::vector<uint32_t> estimated_address_widths() const;
+
     const std::vector<std::unique_ptr<DocToken>> &tokens(uint32_t spine_index) const;
     const std::unordered_map<std::string, DocAddr> &elem_id_to_address(uint32_t spine_index) const;
 };
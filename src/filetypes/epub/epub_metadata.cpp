@@ -415,3 +415,37 @@ bool epub_parse_nav(const std::string &nav_file_path, const char *nav_xml, std::
 
     return found_nav;
 }
+
+bool epub_parse_package_metadata(const char *package_xml, PackageMetadata &out_metadata)
+{
+    xmlDocPtr package_doc = xmlReadMemory(package_xml, strlen(package_xml), nullptr, nullptr, 0);
+    if (package_doc == nullptr)
+    {
+        std::cerr << "Unable to parse package doc" << std::endl;
+        return false;
+    }
+
+    // Element names are matched without their dc: prefix
+    xmlNodePtr node = xmlDocGetRootElement(package_doc);
+    node = elem_first_child(elem_first_by_name(node, BAD_CAST "package"));
+    node = elem_first_by_name(node, BAD_CAST "metadata");
+
+    bool found_metadata = node != nullptr;
+    node = elem_first_child(node);
+
+    xmlNodePtr title_node = elem_first_by_name(node, BAD_CAST "title");
+    if (title_node)
+    {
+        out_metadata.title = parse_nav::collect_text(elem_first_child(title_node));
+    }
+
+    xmlNodePtr creator_node = elem_first_by_name(node, BAD_CAST "creator");
+    if (creator_node)
+    {
+        out_metadata.author = parse_nav::collect_text(elem_first_child(creator_node));
+    }
+
+    xmlFreeDoc(package_doc);
+
+    return found_metadata;
+}
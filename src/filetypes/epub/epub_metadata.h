@@ -40,8 +40,16 @@ struct PackageContents
     std::string toc_id;
 };
 
+// Dublin Core fields of rootfile <metadata>
+struct PackageMetadata
+{
+    std::string title;
+    std::string author;  // first dc:creator
+};
+
 std::string epub_parse_rootfile_path(const char *container_xml);
 bool epub_parse_package_contents(const std::string &rootfile_path, const char *package_xml, PackageContents &out_package);
+bool epub_parse_package_metadata(const char *package_xml, PackageMetadata &out_metadata);
 bool epub_parse_ncx(const std::string &ncx_file_path, const char *ncx_xml, std::vector<NavPoint> &out_navmap);
 bool epub_parse_nav(const std::string &nav_file_path, const char *nav_xml, std::vector<NavPoint> &out_navmap);
 
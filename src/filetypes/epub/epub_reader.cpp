@@ -10,15 +10,111 @@
 #include "extern/hash-library/md5.h"
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <mutex>
 #include <zip.h>
 
 #define DEBUG 0
-#define DOC_WIDTHS_CACHE_KEY "doc_widths"
+#define DOC_WIDTHS_CACHE_KEY "doc_widths_b64"
+#define LEGACY_DOC_WIDTHS_CACHE_KEY "doc_widths"
+
+// Parsed documents kept in memory when reading sequentially
+#define SEQUENTIAL_CACHED_DOCUMENTS 2
 
 namespace
 {
 
+// Opens the epub again on first use, as zip handles can't be shared between threads
+class EpubResourceLoader: public ResourceLoader
+{
+    std::filesystem::path epub_path;
+    std::mutex mutex;
+    zip_t *zip = nullptr;
+    bool open_failed = false;
+
+public:
+    EpubResourceLoader(std::filesystem::path epub_path)
+        : epub_path(std::move(epub_path))
+    {
+    }
+
+    ~EpubResourceLoader()
+    {
+        if (zip)
+        {
+            zip_close(zip);
+        }
+    }
+
+    std::vector<char> load_resource(const std::filesystem::path &path) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!zip && !open_failed)
+        {
+            int err = 0;
+            zip = zip_open(epub_path.c_str(), ZIP_RDONLY, &err);
+            if (!zip)
+            {
+                std::cerr << "Failed to open " << epub_path << " for resources, code: " << err << std::endl;
+                open_failed = true;
+            }
+        }
+        if (!zip)
+        {
+            return {};
+        }
+        return read_zip_file_str(zip, path);
+    }
+};
+
+// Load doc widths from cache, accepting the older decimal text encoding as a fallback.
+bool read_doc_widths_cache(DocReaderCache &cache, const std::string &book_id, std::vector<uint32_t> &doc_widths_out)
+{
+    auto cache_opt = cache.read(book_id, DOC_WIDTHS_CACHE_KEY);
+    if (cache_opt)
+    {
+        return try_decode_uint_vector_base64(*cache_opt, doc_widths_out);
+    }
+
+    auto legacy_cache_opt = cache.read(book_id, LEGACY_DOC_WIDTHS_CACHE_KEY);
+    if (legacy_cache_opt && try_decode_uint_vector(*legacy_cache_opt, doc_widths_out))
+    {
+        // Migrate to the compact encoding
+        cache.write(book_id, DOC_WIDTHS_CACHE_KEY, encode_uint_vector_base64(doc_widths_out));
+        return true;
+    }
+
+    return false;
+}
+
+// Locate the rootfile through container.xml and read it
+bool read_package_document(zip_t *zip, std::string &rootfile_path_out, std::vector<char> &package_xml_out)
+{
+    auto container_xml = read_zip_file_str(zip, EPUB_CONTAINER_PATH);
+    if (container_xml.empty())
+    {
+        std::cerr << "Failed to read epub container" << std::endl;
+        return false;
+    }
+
+    rootfile_path_out = epub_parse_rootfile_path(container_xml.data());
+    if (rootfile_path_out.empty())
+    {
+        std::cerr << "Unable to get docroot path" << std::endl;
+        return false;
+    }
+
+    package_xml_out = read_zip_file_str(zip, rootfile_path_out);
+    if (package_xml_out.empty())
+    {
+        std::cerr << "Failed to open " << rootfile_path_out << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
 uint32_t fraction_to_progress_percent( std::pair<uint32_t, uint32_t> fraction)
 {
     auto [pos, size] = fraction;
@@ -44,37 +140,51 @@ uint32_t fraction_to_progress_percent( std::pair<uint32_t, uint32_t> fraction)
 struct EpubReaderState
 {
     std::filesystem::path path;
+    DocWidthsMode doc_widths_mode;
     zip_t *zip = nullptr;
 
     std::string package_md5;
+    bool sequential_access = false;
+    uint32_t max_measure_threads = 0;
+    EpubOpenTimings open_timings;
 
     std::unique_ptr<EpubDocIndex> doc_index;
     std::unique_ptr<EpubTocIndex> toc_index;
     std::vector<TocItem> user_toc;
 
-    EpubReaderState(std::string path) : path(std::move(path)) {}
+    EpubReaderState(std::string path, DocWidthsMode doc_widths_mode)
+        : path(std::move(path)), doc_widths_mode(doc_widths_mode) {}
 };
 
-EPubReader::EPubReader(std::filesystem::path path)
-    : state(std::make_unique<EpubReaderState>(std::move(path)))
+EPubReader::EPubReader(std::filesystem::path path, DocWidthsMode doc_widths_mode)
+    : state(std::make_unique<EpubReaderState>(std::move(path), doc_widths_mode))
 {
 }
 
 EPubReader::~EPubReader()
 {
-    if (!state->zip)
+    if (state->zip)
     {
         zip_close(state->zip);
     }
 }
 
-bool EPubReader::open(DocReaderCache &cache)
+bool EPubReader::open(DocReaderCache &cache, const OpenProgressCallback &on_progress)
 {
     if (state->zip)
     {
         return true;
     }
 
+    state->open_timings = {};
+    auto lap_start = std::chrono::steady_clock::now();
+    auto lap_us = [&lap_start]() {
+        auto now = std::chrono::steady_clock::now();
+        uint32_t us = std::chrono::duration_cast<std::chrono::microseconds>(now - lap_start).count();
+        lap_start = now;
+        return us;
+    };
+
     // open zip
     {
         int err = 0;
@@ -87,32 +197,15 @@ bool EPubReader::open(DocReaderCache &cache)
             return false;
         }
     }
-
-    // read container.xml
-    std::string rootfile_path;
-    {
-        auto container_xml = read_zip_file_str(state->zip, EPUB_CONTAINER_PATH);
-        if (container_xml.empty())
-        {
-            std::cerr << "Failed to read epub container" << std::endl;
-            return false;
-        }
-
-        rootfile_path = epub_parse_rootfile_path(container_xml.data());
-        if (rootfile_path.empty())
-        {
-            std::cerr << "Unable to get docroot path" << std::endl;
-            return false;
-        }
-    }
+    state->open_timings.zip_open_us = lap_us();
 
     // read package document
+    std::string rootfile_path;
     PackageContents package;
     {
-        auto package_xml = read_zip_file_str(state->zip, rootfile_path);
-        if (package_xml.empty())
+        std::vector<char> package_xml;
+        if (!read_package_document(state->zip, rootfile_path, package_xml))
         {
-            std::cerr << "Failed to open " << rootfile_path << std::endl;
             return false;
         }
 
@@ -124,6 +217,7 @@ bool EPubReader::open(DocReaderCache &cache)
             return false;
         }
     }
+    state->open_timings.package_us = lap_us();
 
     std::vector<NavPoint> navmap;
 
@@ -162,15 +256,14 @@ bool EPubReader::open(DocReaderCache &cache)
             epub_parse_nav(nav_path, nav_xml.data(), navmap);
         }
     }
+    state->open_timings.toc_parse_us = lap_us();
 
     // Construct index helpers
     {
         std::vector<uint32_t> doc_widths_cache;
 
-        auto cache_opt = cache.read(state->package_md5, DOC_WIDTHS_CACHE_KEY);
         bool cache_is_valid = (
-            cache_opt &&
-            try_decode_uint_vector(*cache_opt, doc_widths_cache) &&
+            read_doc_widths_cache(cache, state->package_md5, doc_widths_cache) &&
             doc_widths_cache.size()
         );
         if (!cache_is_valid)
@@ -179,10 +272,31 @@ bool EPubReader::open(DocReaderCache &cache)
         }
 
         state->doc_index = std::make_unique<EpubDocIndex>(package, state->zip, doc_widths_cache);
-        state->toc_index = std::make_unique<EpubTocIndex>(package, navmap, *state->doc_index.get());
+        if (state->sequential_access)
+        {
+            state->doc_index->set_max_cached_documents(SEQUENTIAL_CACHED_DOCUMENTS);
+        }
 
-        if (!cache_is_valid)
+        state->open_timings.index_us += lap_us();
+
+        if (!cache_is_valid && state->doc_widths_mode == DocWidthsMode::Deferred)
+        {
+            DocReaderCache *deferred_cache = &cache;
+            std::string book_id = state->package_md5;
+            state->doc_index->start_background_measure(
+                state->path,
+                [deferred_cache, book_id](const std::vector<uint32_t> &doc_widths) {
+                    deferred_cache->write(book_id, DOC_WIDTHS_CACHE_KEY, encode_uint_vector_base64(doc_widths));
+                }
+            );
+        }
+        else if (!cache_is_valid && state->doc_widths_mode == DocWidthsMode::Eager)
         {
+            if (!state->doc_index->precompute_address_widths(state->path, on_progress, state->max_measure_threads))
+            {
+                return false;
+            }
+
             uint32_t num_spine_entries = state->doc_index->spine_size();
             doc_widths_cache.reserve(num_spine_entries);
             for (uint32_t i = 0; i < num_spine_entries; ++i)
@@ -190,8 +304,11 @@ bool EPubReader::open(DocReaderCache &cache)
                 doc_widths_cache.emplace_back(state->doc_index->address_width(i));
             }
 
-            cache.write(state->package_md5, DOC_WIDTHS_CACHE_KEY, encode_uint_vector(doc_widths_cache));
+            cache.write(state->package_md5, DOC_WIDTHS_CACHE_KEY, encode_uint_vector_base64(doc_widths_cache));
         }
+        state->open_timings.doc_widths_us = lap_us();
+
+        state->toc_index = std::make_unique<EpubTocIndex>(package, navmap, *state->doc_index.get());
     }
 
     // Compile user table of contents
@@ -203,10 +320,16 @@ bool EPubReader::open(DocReaderCache &cache)
             state->toc_index->toc_item_indent_level(i),
         });
     }
+    state->open_timings.index_us += lap_us();
 
     return true;
 }
 
+const EpubOpenTimings &EPubReader::get_open_timings() const
+{
+    return state->open_timings;
+}
+
 bool EPubReader::is_open() const
 {
     return state->zip != nullptr;
@@ -217,6 +340,20 @@ std::string EPubReader::get_id() const
     return state->package_md5;
 }
 
+void EPubReader::set_sequential_access()
+{
+    state->sequential_access = true;
+    if (state->doc_index)
+    {
+        state->doc_index->set_max_cached_documents(SEQUENTIAL_CACHED_DOCUMENTS);
+    }
+}
+
+void EPubReader::set_max_measure_threads(uint32_t max_threads)
+{
+    state->max_measure_threads = max_threads;
+}
+
 const std::vector<TocItem> &EPubReader::get_table_of_contents() const
 {
     return state->user_toc;
@@ -258,3 +395,46 @@ std::vector<char> EPubReader::load_resource(const std::filesystem::path &path) c
 {
     return read_zip_file_str(state->zip, path);
 }
+
+std::vector<char> EPubReader::load_resource_prefix(const std::filesystem::path &path, uint32_t max_bytes) const
+{
+    return read_zip_file_prefix(state->zip, path, max_bytes);
+}
+
+std::shared_ptr<ResourceLoader> EPubReader::create_resource_loader() const
+{
+    return std::make_shared<EpubResourceLoader>(state->path);
+}
+
+std::optional<DocMetadata> epub_read_metadata(const std::filesystem::path &path)
+{
+    int err = 0;
+    zip_t *zip = zip_open(path.c_str(), ZIP_RDONLY, &err);
+    if (zip == nullptr)
+    {
+        std::cerr << "Failed to epub " << path
+            << " code: " << err
+            << std::endl;
+        return std::nullopt;
+    }
+
+    std::optional<DocMetadata> metadata;
+
+    std::string rootfile_path;
+    std::vector<char> package_xml;
+    if (read_package_document(zip, rootfile_path, package_xml))
+    {
+        PackageMetadata package_metadata;
+        epub_parse_package_metadata(package_xml.data(), package_metadata);
+
+        metadata = DocMetadata{
+            MD5()(package_xml.data(), package_xml.size()),
+            package_metadata.title,
+            package_metadata.author
+        };
+    }
+
+    zip_close(zip);
+
+    return metadata;
+}
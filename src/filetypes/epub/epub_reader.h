@@ -6,23 +6,49 @@
 
 struct EpubReaderState;
 
+// How document widths are found when a book isn't in the cache
+enum class DocWidthsMode
+{
+    Eager,     // measure all documents during open
+    Deferred,  // open right away, global progress is estimated until documents are measured in the background
+    Estimated, // open right away and never measure ahead, for readers that don't need exact progress
+};
+
+// Time spent in each step of the last open, for profiling
+struct EpubOpenTimings
+{
+    uint32_t zip_open_us = 0;
+    uint32_t package_us = 0;     // container and package document
+    uint32_t toc_parse_us = 0;   // ncx or nav document
+    uint32_t doc_widths_us = 0;  // measuring documents, in eager mode without a cache
+    uint32_t index_us = 0;       // everything else
+};
+
 class EPubReader: public DocReader
 {
     std::unique_ptr<EpubReaderState> state;
 
 public:
-    EPubReader(std::filesystem::path path);
+    EPubReader(std::filesystem::path path, DocWidthsMode doc_widths_mode = DocWidthsMode::Deferred);
     EPubReader(const EPubReader &) = delete;
     EPubReader &operator=(const EPubReader &) = delete;
 
     virtual ~EPubReader();
 
     using DocReader::open;
-    bool open(DocReaderCache &) override;
+    bool open(DocReaderCache &, const OpenProgressCallback &) override;
     bool is_open() const override;
 
     std::string get_id() const override;
 
+    void set_sequential_access() override;
+
+    // Limit the threads measuring documents in eager mode, 0 for one per core.
+    // Call before open.
+    void set_max_measure_threads(uint32_t max_threads);
+
+    const EpubOpenTimings &get_open_timings() const;
+
     const std::vector<TocItem> &get_table_of_contents() const override;
     TocPosition get_toc_position(const DocAddr &address) const override;
     DocAddr get_toc_item_address(uint32_t toc_item_index) const override;
@@ -32,6 +58,11 @@ public:
     std::shared_ptr<TokenIter> get_iter(DocAddr address = make_address()) const override;
 
     std::vector<char> load_resource(const std::filesystem::path &path) const override;
+    std::vector<char> load_resource_prefix(const std::filesystem::path &path, uint32_t max_bytes) const override;
+    std::shared_ptr<ResourceLoader> create_resource_loader() const override;
 };
 
+// Reads the id, title and author from the package document only
+std::optional<DocMetadata> epub_read_metadata(const std::filesystem::path &path);
+
 #endif
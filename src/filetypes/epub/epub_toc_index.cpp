@@ -36,8 +36,10 @@ struct EpubTocIndexState
     EpubDocIndex &doc_index;
     std::vector<TocItemCache> toc;
 
-    std::vector<uint32_t> spine_to_offset;
-    uint32_t book_width = 0;
+    // Global progress lookup, rebuilt as document widths become known
+    mutable std::optional<uint32_t> spine_to_offset_version;
+    mutable std::vector<uint32_t> spine_to_offset;
+    mutable uint32_t book_width = 0;
 
     mutable uint32_t cached_toc_index = 0;
     mutable DocAddr cached_toc_index_start_address = -1;
@@ -299,17 +301,6 @@ EpubTocIndex::EpubTocIndex(const PackageContents &package, const std::vector<Nav
         fallback_convert_spine_to_toc(package, toc);
     }
 
-    // Compile global progress lookup
-    {
-        uint32_t offset = 0;
-        for (uint32_t i = 0; i < doc_index.spine_size(); ++i)
-        {
-            state->spine_to_offset.emplace_back(offset);
-            offset += doc_index.address_width(i);
-        }
-        state->book_width = offset;
-    }
-
     #if DEBUG
     {
         std::cerr << "TOC:" << std::endl;
@@ -448,6 +439,22 @@ std::pair<uint32_t, uint32_t> EpubTocIndex::get_global_progress(const DocAddr &a
         return {0, 0};
     }
 
+    uint32_t widths_version = state->doc_index.sync_address_widths();
+    if (state->spine_to_offset_version != widths_version)
+    {
+        // Unmeasured documents are estimated, so progress firms up as they're measured
+        state->spine_to_offset.clear();
+
+        uint32_t offset = 0;
+        for (uint32_t width : state->doc_index.estimated_address_widths())
+        {
+            state->spine_to_offset.emplace_back(offset);
+            offset += width;
+        }
+        state->book_width = offset;
+        state->spine_to_offset_version = widths_version;
+    }
+
     return {
         state->spine_to_offset[cur_spine] + (address - make_address(cur_spine)),
         state->book_width
@@ -249,3 +249,46 @@ TEST(EPUB_METADATA, epub_parse_nav__nested)
     ASSERT_TRUE(epub_parse_nav("root/nav.xhtml", xml, navmap));
     ASSERT_EQ(navmap, expected_navmap);
 }
+
+TEST(EPUB_METADATA, epub_parse_package_metadata__invalid_xml)
+{
+    PackageMetadata metadata;
+    ASSERT_FALSE(epub_parse_package_metadata("", metadata));
+}
+
+TEST(EPUB_METADATA, epub_parse_package_metadata__basic)
+{
+    const char *xml = (
+        "<?xml version='1.0' encoding='utf-8'?>"
+        "<package xmlns=\"http://www.idpf.org/2007/opf\" version=\"3.0\">"
+          "<metadata xmlns:dc=\"http://purl.org/dc/elements/1.1/\">"
+            "<dc:identifier id=\"uid\">urn:uuid:1234</dc:identifier>"
+            "<dc:title>\n  The   Title  </dc:title>"
+            "<dc:creator id=\"creator1\">First <i>Author</i></dc:creator>"
+            "<dc:creator id=\"creator2\">Second Author</dc:creator>"
+          "</metadata>"
+          "<manifest></manifest>"
+          "<spine></spine>"
+        "</package>"
+    );
+
+    PackageMetadata metadata;
+    ASSERT_TRUE(epub_parse_package_metadata(xml, metadata));
+    ASSERT_EQ(metadata.title, "The Title");
+    ASSERT_EQ(metadata.author, "First Author");
+}
+
+TEST(EPUB_METADATA, epub_parse_package_metadata__missing_fields)
+{
+    const char *xml = (
+        "<?xml version='1.0' encoding='utf-8'?>"
+        "<package>"
+          "<metadata></metadata>"
+        "</package>"
+    );
+
+    PackageMetadata metadata;
+    ASSERT_TRUE(epub_parse_package_metadata(xml, metadata));
+    ASSERT_EQ(metadata.title, "");
+    ASSERT_EQ(metadata.author, "");
+}
@@ -1,5 +1,7 @@
 #include "../xhtml_parser.h"
 
+#include "util/alloc_stats.h"
+
 #include <gtest/gtest.h>
 
 static void ASSERT_TOKENS_EQ(const std::vector<std::unique_ptr<DocToken>> &actual_tokens, const std::vector<std::unique_ptr<DocToken>> &expected_tokens)
@@ -92,6 +94,25 @@ TEST(XHTML_PARSER, line_break)
     );
 }
 
+TEST(XHTML_PARSER, unknown_elems_are_inline)
+{
+    // Names close to blocking elements, matching is exact and case sensitive
+    const char *xml = (
+        "<html><body>"
+        "<span>A</span><h7>B</h7><DIV>C</DIV><divs>D</divs><di>E</di>"
+        "<blockquotes>F</blockquotes><x>G</x><pp>H</pp>"
+        "</body></html>"
+    );
+
+    std::vector<std::unique_ptr<DocToken>> expected_tokens;
+    expected_tokens.push_back(std::make_unique<TextDocToken>(0, "ABCDEFGH"));
+
+    ASSERT_TOKENS_EQ(
+        _parse_xhtml_tokens(xml),
+        expected_tokens
+    );
+}
+
 TEST(XHTML_PARSER, section_compaction)
 {
     const char *xml = (
@@ -224,3 +245,66 @@ TEST(XHTML_PARSER, capture_ids)
 
     ASSERT_EQ(expected_ids, ids);
 }
+
+TEST(XHTML_PARSER, reused_parser_matches_fresh)
+{
+    const std::vector<const char *> docs = {
+        "<html><body><p id=\"a\">Para 1</p><p>Para 2 <img src=\"x.png\"/></p></body></html>",
+        "<?xml version=\"1.0\"?><!DOCTYPE html [<!ENTITY ent \"entity text\">]><html><body>Text &ent;</body></html>",
+        "<html><body><h1>Header</h1><pre>  code\n</pre><ul><li>Item</li></ul></body></html>",
+        "not xml",
+        "",
+        "<html><body><div>Unclosed <b>bold</div> after</body></html>",
+        "<html><body><p id=\"a\">Para 1</p><p>Para 2 <img src=\"x.png\"/></p></body></html>",
+    };
+
+    // Alternate tree parses and scans on the same parser
+    XhtmlParser parser;
+    for (uint32_t round = 0; round < 2; ++round)
+    {
+        for (uint32_t i = 0; i < docs.size(); ++i)
+        {
+            std::vector<std::unique_ptr<DocToken>> expected_tokens;
+            std::unordered_map<std::string, DocAddr> expected_ids;
+            bool expected_ok = parse_xhtml_tokens(docs[i], "/base/file.xhtml", i, expected_tokens, expected_ids);
+
+            std::vector<std::unique_ptr<DocToken>> tokens;
+            std::unordered_map<std::string, DocAddr> ids;
+            ASSERT_EQ(parser.parse_tokens(docs[i], "/base/file.xhtml", i, tokens, ids), expected_ok) << docs[i];
+            ASSERT_TOKENS_EQ(tokens, expected_tokens);
+            ASSERT_EQ(ids, expected_ids);
+
+            ASSERT_EQ(parser.scan_address_width(docs[i]), scan_xhtml_address_width(docs[i])) << docs[i];
+        }
+    }
+}
+
+TEST(XHTML_PARSER, allocation_budget)
+{
+    if (!alloc_tracking_enabled())
+    {
+        GTEST_SKIP() << "Built without ALLOC_TRACKING";
+    }
+
+    std::string xml = "<html><body>";
+    for (int i = 0; i < 100; ++i)
+    {
+        xml += "<p>A paragraph with <b>bold</b> and <i>italic</i> text.</p>";
+    }
+    xml += "</body></html>";
+
+    XhtmlParser parser;
+    std::vector<std::unique_ptr<DocToken>> tokens;
+    std::unordered_map<std::string, DocAddr> ids;
+    ASSERT_TRUE(parser.parse_tokens(xml.c_str(), "/base/file.xhtml", 0, tokens, ids));  // warm up
+
+    tokens.clear();
+    reset_alloc_site_counts();
+    ASSERT_TRUE(parser.parse_tokens(xml.c_str(), "/base/file.xhtml", 0, tokens, ids));
+
+    AllocSiteCounts counts = get_alloc_site_counts(AllocSite::XhtmlParse);
+    ASSERT_EQ(counts.calls, 1);
+    ASSERT_GT(tokens.size(), 0);
+    // Measured at about 3 per token
+    ASSERT_LE(counts.allocations, tokens.size() * 4);
+}
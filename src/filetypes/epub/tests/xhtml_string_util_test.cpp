@@ -2,6 +2,32 @@
 
 #include <gtest/gtest.h>
 
+#include <random>
+
+// Original char by char implementation, for comparison
+static std::string reference_compact_whitespace(const std::string &str)
+{
+    std::string result;
+    bool last_was_whitespace = false;
+    for (char c : str)
+    {
+        bool whitespace = c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        if (whitespace && last_was_whitespace)
+        {
+            continue;
+        }
+        result.push_back(whitespace ? ' ' : c);
+        last_was_whitespace = whitespace;
+    }
+    return result;
+}
+
+static std::string compact_in_place(std::string str)
+{
+    str.resize(compact_whitespace_in_place(str.data(), str.size()));
+    return str;
+}
+
 TEST(XHTML_STRING_UTIL, compact_whitespace)
 {
     EXPECT_EQ(compact_whitespace(""), "");
@@ -48,3 +74,80 @@ TEST(XHTML_STRING_UTIL, compact_strings)
     // also does compaction
     EXPECT_EQ(compact_strings({"\thi\t\t there\t\t"}), "hi there");
 }
+
+TEST(XHTML_STRING_UTIL, compact_whitespace_in_place)
+{
+    EXPECT_EQ(compact_in_place(""), "");
+    EXPECT_EQ(compact_in_place("  foo\r\n\nbar\t"), " foo bar ");
+
+    // Only the given length is touched
+    std::string str = "a  b  c";
+    ASSERT_EQ(compact_whitespace_in_place(str.data(), 4), 3);
+    EXPECT_EQ(str.substr(0, 3), "a b");
+    EXPECT_EQ(str.substr(4), "  c");
+
+    // Block sized runs of text, single spaces, and whitespace
+    std::string words;
+    for (int i = 0; i < 20; ++i)
+    {
+        words += "word ";
+    }
+    EXPECT_EQ(compact_in_place(words), words);
+    EXPECT_EQ(compact_in_place(std::string(40, ' ') + "x" + std::string(40, '\n')), " x ");
+    EXPECT_EQ(compact_in_place(std::string(15, 'a') + "  " + std::string(15, 'b') + " "), std::string(15, 'a') + " " + std::string(15, 'b') + " ");
+}
+
+TEST(XHTML_STRING_UTIL, compact_whitespace_matches_reference)
+{
+    const char alphabet[] = {'a', 'b', ' ', ' ', ' ', '\t', '\r', '\n', '\xce', '\xbb', '.'};
+
+    std::mt19937 rng(1234);
+    auto pick = [&rng](uint32_t n) {
+        return std::uniform_int_distribution<uint32_t>(0, n - 1)(rng);
+    };
+
+    for (int i = 0; i < 5000; ++i)
+    {
+        // Mostly prose-like text, sometimes dense whitespace
+        uint32_t whitespace_odds = 1 + pick(8);
+        std::string str;
+        uint32_t len = pick(100);
+        for (uint32_t j = 0; j < len; ++j)
+        {
+            str.push_back(pick(whitespace_odds) ? alphabet[pick(2)] : alphabet[2 + pick(6)]);
+            if (!pick(10))
+            {
+                str.push_back(alphabet[8 + pick(3)]);
+            }
+        }
+
+        std::string expected = reference_compact_whitespace(str);
+        ASSERT_EQ(compact_whitespace(str.c_str()), expected);
+        ASSERT_EQ(compact_in_place(str), expected);
+
+        // Unaligned start
+        if (!str.empty())
+        {
+            ASSERT_EQ(compact_in_place(str.substr(1)), reference_compact_whitespace(str.substr(1)));
+        }
+    }
+}
+
+TEST(XHTML_STRING_UTIL, compact_strings_in_place)
+{
+    std::string str;
+    compact_strings_in_place(str);
+    EXPECT_EQ(str, "");
+
+    str = " \t\n ";
+    compact_strings_in_place(str);
+    EXPECT_EQ(str, "");
+
+    str = "\thi\t\t there\t\t";
+    compact_strings_in_place(str);
+    EXPECT_EQ(str, "hi there");
+
+    str = std::string(30, ' ') + "long  enough  to  span  several  blocks" + std::string(30, '\n');
+    compact_strings_in_place(str);
+    EXPECT_EQ(str, "long enough to span several blocks");
+}
@@ -0,0 +1,143 @@
+#include "../xhtml_parser.h"
+
+#include "doc_api/token_addressing.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+static uint32_t parsed_address_width(const std::string &xml)
+{
+    std::vector<std::unique_ptr<DocToken>> tokens;
+    std::unordered_map<std::string, DocAddr> ids;
+    parse_xhtml_tokens(xml.c_str(), "/base/file.xhtml", 0, tokens, ids);
+
+    if (tokens.empty())
+    {
+        return 0;
+    }
+    const auto &last_token = tokens.back();
+    return last_token->address + get_address_width(*last_token);
+}
+
+static void ASSERT_SCAN_MATCHES_PARSE(const std::string &xml)
+{
+    auto scanned = scan_xhtml_address_width(xml.c_str());
+    ASSERT_TRUE(scanned.has_value()) << xml;
+    ASSERT_EQ(*scanned, parsed_address_width(xml)) << xml;
+}
+
+static std::string wrap_body(const std::string &body)
+{
+    return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+           "<html xmlns=\"http://www.w3.org/1999/xhtml\"><head><title>Title text</title></head>"
+           "<body>" + body + "</body></html>";
+}
+
+TEST(XHTML_WIDTH_SCAN, empty_documents)
+{
+    ASSERT_SCAN_MATCHES_PARSE("");
+    ASSERT_SCAN_MATCHES_PARSE("not xml");
+    ASSERT_SCAN_MATCHES_PARSE("<html></html>");
+    ASSERT_SCAN_MATCHES_PARSE("<html><body></body></html>");
+    ASSERT_SCAN_MATCHES_PARSE("<html><body>   \n\t  </body></html>");
+    ASSERT_SCAN_MATCHES_PARSE("<notbody><body>Text</body></notbody>");
+    ASSERT_SCAN_MATCHES_PARSE("<html><head>Text</head><div><body>Text</body></div></html>");
+}
+
+TEST(XHTML_WIDTH_SCAN, corpus)
+{
+    const std::vector<std::string> bodies = {
+        "Text",
+        "  This  <i>  has  </i>  some  <i>extra</i>  white<i> <i/>space  ",
+        "<div>Line 1</div><div>Line 2</div>Line 3<br/>Line 4",
+        "<p>Para 1</p><p></p><p>  </p><p>Para 2</p>",
+        "<h1>Header</h1><p>Text</p><h2><span>Sub</span> header</h2>",
+        "<pre>  code\r\n  more code  </pre><pre>\r\r</pre>",
+        "<p><img src=\"a.png\"/></p><image href=\"b.png\"/><img/><img alt=\"none\"/>",
+        "<svg><image xlink:href=\"c.png\" xmlns:xlink=\"http://www.w3.org/1999/xlink\"/></svg>",
+        "<ul><li>One</li><li>Two<ol><li>Nested</li></ol></li></ul><p>After</p>",
+        "<table><tr><td>a</td><td>b</td></tr><tr><td><p>c</p></td></tr></table>",
+        "<div id=\"x\"><a id=\"y\">Link</a></div><p id=\"z\"/>",
+        "Unicode λ text — with “quotes” and 漢字",
+        "Entities &amp; &lt;tag&gt; &#160; &#x3bb; &nbsp; &undefined;",
+        "<![CDATA[cdata text]]> after cdata",
+        "<!-- comment --> text <?pi instruction?> more",
+        "<p>Unclosed <b>bold</p> text</div> stray",
+        "<h3>Ends with header</h3>",
+        "<p>Ends with image</p><img src=\"x.png\"/>",
+        "Text<img src=\"x.png\">alt text</img>after",
+    };
+
+    for (const auto &body : bodies)
+    {
+        ASSERT_SCAN_MATCHES_PARSE(wrap_body(body));
+    }
+}
+
+TEST(XHTML_WIDTH_SCAN, generated_documents)
+{
+    const std::vector<std::string> open_tags = {
+        "<p>", "<div>", "<span>", "<i>", "<h1>", "<h4>", "<ul>", "<ol>", "<li>",
+        "<pre>", "<table>", "<tr>", "<td>", "<blockquote>", "<section>",
+    };
+    const std::vector<std::string> fragments = {
+        "word", " ", "  ", "\n", "\r\n", "\t", "λ", "漢字", "a b", "&amp;", "&#160;",
+        "<br/>", "<img src=\"i.png\"/>", "<img/>", "<hr/>", "<!-- c -->", "<![CDATA[x y]]>",
+        "<p/>", "<td/>", "</p>",
+    };
+
+    std::mt19937 rng(1234);
+    auto pick = [&rng](uint32_t n) {
+        return std::uniform_int_distribution<uint32_t>(0, n - 1)(rng);
+    };
+
+    for (int doc = 0; doc < 500; ++doc)
+    {
+        std::string body;
+        std::vector<std::string> open_stack;
+
+        int steps = 1 + pick(60);
+        for (int i = 0; i < steps; ++i)
+        {
+            uint32_t action = pick(10);
+            if (action < 3)
+            {
+                const auto &tag = open_tags[pick(open_tags.size())];
+                body += tag;
+                open_stack.push_back("</" + tag.substr(1));
+            }
+            else if (action < 5 && !open_stack.empty())
+            {
+                body += open_stack.back();
+                open_stack.pop_back();
+            }
+            else
+            {
+                body += fragments[pick(fragments.size())];
+            }
+        }
+
+        // Occasionally leave elements unclosed to exercise recovery
+        if (pick(4))
+        {
+            while (!open_stack.empty())
+            {
+                body += open_stack.back();
+                open_stack.pop_back();
+            }
+        }
+
+        ASSERT_SCAN_MATCHES_PARSE(wrap_body(body));
+    }
+}
+
+TEST(XHTML_WIDTH_SCAN, dtd_declarations_unsupported)
+{
+    const char *xml = (
+        "<?xml version=\"1.0\"?>"
+        "<!DOCTYPE html [<!ENTITY ent \"entity text\">]>"
+        "<html><body>Text &ent;</body></html>"
+    );
+    ASSERT_FALSE(scan_xhtml_address_width(xml).has_value());
+}
@@ -6,12 +6,16 @@
 #include "./util/str_utils.h"
 
 #include "doc_api/token_addressing.h"
+#include "util/alloc_stats.h"
 
 #include <libxml/parser.h>
+#include <libxml/parserInternals.h>
 
+#include <array>
 #include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <optional>
 #include <set>
 #include <unordered_map>
 
@@ -22,21 +26,6 @@ namespace {
 
 const std::string SPACE = " ";
 
-bool element_is_blocking(const xmlChar *name)
-{
-    if (!name)
-    {
-        return false;
-    }
-    static const std::set<std::string> blocking_elements = {
-        "address", "article", "aside", "blockquote", "canvas", "dd", "div", "dl", "dt",
-        "fieldset", "figcaption", "figure", "footer", "form", "h1", "h2", "h3", "h4",
-        "h5", "h6", "header", "hgroup", "hr", "li", "main", "nav", "noscript", "ol",
-        "output", "p", "pre", "section", "table", "tfoot", "ul", "video", "br"
-    };
-    return blocking_elements.find((const char*)name) != blocking_elements.end();
-}
-
 enum class ElementType
 {
     H,
@@ -51,36 +40,152 @@ enum class ElementType
     Td,
 };
 
-const std::unordered_map<std::string, ElementType> _elem_name_to_enum {
-    {"h1",    ElementType::H},
-    {"h2",    ElementType::H},
-    {"h3",    ElementType::H},
-    {"h4",    ElementType::H},
-    {"h5",    ElementType::H},
-    {"h6",    ElementType::H},
-    {"p",     ElementType::P},
-    {"ol",    ElementType::Ol},
-    {"ul",    ElementType::Ul},
-    {"pre",   ElementType::Pre},
-    {"img",   ElementType::Image},
-    {"image", ElementType::Image},
-    {"table", ElementType::Table},
-    {"tr",    ElementType::Tr},
-    {"td",    ElementType::Td},
+struct ElementInfo
+{
+    const char *name;
+    ElementType type;
+    bool blocking;
 };
 
-ElementType elem_name_to_enum(const xmlChar *elem_name)
+constexpr ElementInfo KNOWN_ELEMENTS[] = {
+    {"address",    ElementType::Unknown, true},
+    {"article",    ElementType::Unknown, true},
+    {"aside",      ElementType::Unknown, true},
+    {"blockquote", ElementType::Unknown, true},
+    {"br",         ElementType::Unknown, true},
+    {"canvas",     ElementType::Unknown, true},
+    {"dd",         ElementType::Unknown, true},
+    {"div",        ElementType::Unknown, true},
+    {"dl",         ElementType::Unknown, true},
+    {"dt",         ElementType::Unknown, true},
+    {"fieldset",   ElementType::Unknown, true},
+    {"figcaption", ElementType::Unknown, true},
+    {"figure",     ElementType::Unknown, true},
+    {"footer",     ElementType::Unknown, true},
+    {"form",       ElementType::Unknown, true},
+    {"h1",         ElementType::H,       true},
+    {"h2",         ElementType::H,       true},
+    {"h3",         ElementType::H,       true},
+    {"h4",         ElementType::H,       true},
+    {"h5",         ElementType::H,       true},
+    {"h6",         ElementType::H,       true},
+    {"header",     ElementType::Unknown, true},
+    {"hgroup",     ElementType::Unknown, true},
+    {"hr",         ElementType::Unknown, true},
+    {"image",      ElementType::Image,   false},
+    {"img",        ElementType::Image,   false},
+    {"li",         ElementType::Unknown, true},
+    {"main",       ElementType::Unknown, true},
+    {"nav",        ElementType::Unknown, true},
+    {"noscript",   ElementType::Unknown, true},
+    {"ol",         ElementType::Ol,      true},
+    {"output",     ElementType::Unknown, true},
+    {"p",          ElementType::P,       true},
+    {"pre",        ElementType::Pre,     true},
+    {"section",    ElementType::Unknown, true},
+    {"table",      ElementType::Table,   true},
+    {"td",         ElementType::Td,      false},
+    {"tfoot",      ElementType::Unknown, true},
+    {"tr",         ElementType::Tr,      false},
+    {"ul",         ElementType::Ul,      true},
+    {"video",      ElementType::Unknown, true},
+};
+
+constexpr uint32_t NUM_KNOWN_ELEMENTS = sizeof(KNOWN_ELEMENTS) / sizeof(KNOWN_ELEMENTS[0]);
+constexpr uint32_t MAX_ELEMENT_NAME_LEN = 10;
+constexpr uint32_t ELEMENT_TABLE_SIZE = 128;
+
+constexpr uint32_t const_strlen(const char *str)
+{
+    uint32_t len = 0;
+    while (str[len])
+    {
+        ++len;
+    }
+    return len;
+}
+
+// Element names are classified for every element of every chapter, so avoid
+// string construction and lookups. The multipliers were picked so that no two
+// known names share a slot, which the static_assert below checks. name[1] is
+// the terminator for single char names.
+constexpr uint32_t element_name_slot(const char *name, uint32_t len)
+{
+    return (
+        len +
+        static_cast<uint8_t>(name[0]) +
+        static_cast<uint8_t>(name[1]) * 14 +
+        static_cast<uint8_t>(name[len - 1]) * 55
+    ) % ELEMENT_TABLE_SIZE;
+}
+
+// Index into KNOWN_ELEMENTS per slot, -1 when empty, or -2 on a collision
+constexpr std::array<int8_t, ELEMENT_TABLE_SIZE> build_element_table()
+{
+    std::array<int8_t, ELEMENT_TABLE_SIZE> table = {};
+    for (uint32_t i = 0; i < ELEMENT_TABLE_SIZE; ++i)
+    {
+        table[i] = -1;
+    }
+    for (uint32_t i = 0; i < NUM_KNOWN_ELEMENTS; ++i)
+    {
+        const char *name = KNOWN_ELEMENTS[i].name;
+        int8_t &slot = table[element_name_slot(name, const_strlen(name))];
+        slot = slot == -1 ? i : -2;
+    }
+    return table;
+}
+
+constexpr std::array<int8_t, ELEMENT_TABLE_SIZE> ELEMENT_TABLE = build_element_table();
+
+constexpr bool element_table_is_perfect()
+{
+    uint32_t num_filled = 0;
+    for (int8_t index : ELEMENT_TABLE)
+    {
+        if (index == -2)
+        {
+            return false;
+        }
+        num_filled += index >= 0;
+    }
+    return num_filled == NUM_KNOWN_ELEMENTS;
+}
+
+static_assert(element_table_is_perfect(), "element name slots collide, pick new multipliers");
+
+const ElementInfo *find_element(const xmlChar *elem_name)
 {
     if (!elem_name)
     {
-        return ElementType::Unknown;
+        return nullptr;
+    }
+
+    const char *name = (const char*)elem_name;
+    uint32_t len = strnlen(name, MAX_ELEMENT_NAME_LEN + 1);
+    if (len == 0 || len > MAX_ELEMENT_NAME_LEN)
+    {
+        return nullptr;
     }
-    auto it = _elem_name_to_enum.find((const char*)elem_name);
-    if (it != _elem_name_to_enum.end())
+
+    int8_t index = ELEMENT_TABLE[element_name_slot(name, len)];
+    if (index < 0 || strcmp(KNOWN_ELEMENTS[index].name, name) != 0)
     {
-        return it->second;
+        return nullptr;
     }
-    return ElementType::Unknown;
+    return &KNOWN_ELEMENTS[index];
+}
+
+bool element_is_blocking(const xmlChar *name)
+{
+    const ElementInfo *info = find_element(name);
+    return info && info->blocking;
+}
+
+ElementType elem_name_to_enum(const xmlChar *elem_name)
+{
+    const ElementInfo *info = find_element(elem_name);
+    return info ? info->type : ElementType::Unknown;
 }
 
 std::string escape_newlines(const xmlChar *str)
@@ -252,11 +357,12 @@ public:
 
         // Look for id
         {
-            const xmlChar *elem_id = xmlGetProp(node, BAD_CAST "id");
+            xmlChar *elem_id = xmlGetProp(node, BAD_CAST "id");
             if (elem_id && xmlStrlen(elem_id) > 0)
             {
                 unattached_ids.insert((const char*)elem_id);
             }
+            xmlFree(elem_id);
         }
 
         if (element_is_blocking(node->name))
@@ -360,7 +466,7 @@ public:
         }
     }
 
-    const std::vector<Node> &get_nodes() const
+    std::vector<Node> &get_nodes()
     {
         return nodes;
     }
@@ -393,9 +499,329 @@ void visit_nodes(xmlNodePtr node, NodeProcessor &processor, int node_depth = 0)
     }
 }
 
-// Merge inline text types, emit DocTokens
+// Computes the address width parse_xhtml_tokens would produce, following the
+// same rules as NodeProcessor and generate_doc_tokens but only tracking where
+// the last token would end. No nodes, text or tokens are stored.
+class WidthScanner
+{
+    int list_depth = 0;
+    int pre_depth = 0;
+    int header_depth = 0;
+    int table_depth = 0;
+
+    uint32_t current_address = 0;  // relative to start of document
+
+    struct OpenElement
+    {
+        ElementType type;
+        bool is_blocking;
+    };
+    // Elements left open at the end still get exit handling, as the tree walk would
+    std::vector<OpenElement> open_elements;
+
+    // Run of same typed inline nodes, which would merge into a single token
+    std::optional<Node::Type> group_type;
+    bool group_has_text = false;
+    uint32_t group_address = 0;
+    uint32_t group_width = 0;
+
+    bool separator_allowed = true;
+    uint32_t token_end = 0;
+
+    static bool has_text(Node::Type type, const char *s, uint32_t len)
+    {
+        // Whatever survives whitespace compaction, or carriage return removal for pre
+        for (const char *end = s + len; s < end; ++s)
+        {
+            if (type == Node::Type::InlinePre ? *s != '\r' : !is_whitespace(*s))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void flush_group()
+    {
+        if (group_type && group_has_text)
+        {
+            token_end = group_address + group_width;
+            separator_allowed = true;
+        }
+        group_type = std::nullopt;
+    }
+
+    void emit_inline(Node::Type type, const char *s, uint32_t len, uint32_t width)
+    {
+        if (group_type != type)
+        {
+            flush_group();
+            group_type = type;
+            group_has_text = false;
+            group_address = current_address;
+            group_width = 0;
+        }
+
+        group_has_text = group_has_text || has_text(type, s, len);
+        group_width += width;
+    }
+
+    void emit_break()
+    {
+        flush_group();
+    }
+
+    void emit_separator()
+    {
+        flush_group();
+        if (separator_allowed)
+        {
+            token_end = current_address;
+            separator_allowed = false;
+        }
+    }
+
+    void emit_image(bool has_link)
+    {
+        flush_group();
+        if (has_link)
+        {
+            token_end = current_address + 1;
+        }
+        separator_allowed = true;
+    }
+
+public:
+    void on_text(const char *s, uint32_t len)
+    {
+        Node::Type type;
+        if (pre_depth > 0)
+        {
+            type = Node::Type::InlinePre;
+        }
+        else if (header_depth > 0)
+        {
+            type = Node::Type::InlineHeader;
+        }
+        else if (list_depth > 0)
+        {
+            type = Node::Type::InlineList;
+        }
+        else
+        {
+            type = Node::Type::InlineText;
+        }
+
+        uint32_t width = get_address_width(s, len);
+        emit_inline(type, s, len, width);
+        current_address += width;
+    }
+
+    // attributes as given to xmlSAX2StartElementNs, 5 entries per attribute
+    void on_enter_element(const xmlChar *name, const xmlChar **attributes, int num_attributes)
+    {
+        OpenElement elem = {elem_name_to_enum(name), element_is_blocking(name)};
+        open_elements.push_back(elem);
+
+        if (elem.is_blocking)
+        {
+            emit_break();
+        }
+
+        switch (elem.type)
+        {
+            case ElementType::H:
+                emit_separator();
+                ++header_depth;
+                break;
+            case ElementType::Ol:
+            case ElementType::Ul:
+                if (list_depth == 0)
+                {
+                    emit_separator();
+                }
+                ++list_depth;
+                break;
+            case ElementType::P:
+                if (table_depth == 0 && list_depth == 0)
+                {
+                    emit_separator();
+                }
+                break;
+            case ElementType::Pre:
+                emit_separator();
+                ++pre_depth;
+                break;
+            case ElementType::Table:
+                emit_separator();
+                ++table_depth;
+                break;
+            case ElementType::Image:
+                {
+                    bool has_link = false;
+                    for (int i = 0; i < num_attributes; ++i)
+                    {
+                        const xmlChar *attr_name = attributes[i * 5];
+                        has_link = has_link || xmlStrEqual(attr_name, BAD_CAST "href") || xmlStrEqual(attr_name, BAD_CAST "src");
+                    }
+                    emit_image(has_link);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    void on_exit_element()
+    {
+        if (open_elements.empty())
+        {
+            return;
+        }
+        OpenElement elem = open_elements.back();
+        open_elements.pop_back();
+
+        switch (elem.type)
+        {
+            case ElementType::H:
+                emit_separator();
+                --header_depth;
+                break;
+            case ElementType::Ol:
+            case ElementType::Ul:
+                --list_depth;
+                if (list_depth == 0)
+                {
+                    emit_separator();
+                }
+                break;
+            case ElementType::P:
+                if (table_depth == 0 && list_depth == 0)
+                {
+                    emit_separator();
+                }
+                break;
+            case ElementType::Pre:
+                emit_separator();
+                --pre_depth;
+                break;
+            case ElementType::Table:
+                emit_separator();
+                --table_depth;
+                break;
+            case ElementType::Tr:
+                emit_break();
+                break;
+            case ElementType::Td:
+                emit_inline(Node::Type::InlineText, SPACE.c_str(), SPACE.size(), 0);
+                break;
+            default:
+                break;
+        }
+
+        if (elem.is_blocking)
+        {
+            emit_break();
+        }
+
+        if (elem.type == ElementType::Image)
+        {
+            ++current_address;
+        }
+    }
+
+    uint32_t finish()
+    {
+        while (!open_elements.empty())
+        {
+            on_exit_element();
+        }
+        flush_group();
+        return token_end;
+    }
+};
+
+// SAX state, only passing through events inside of html > body like parse_xhtml_tokens
+struct WidthScanContext
+{
+    WidthScanner scanner;
+
+    int depth = 0;
+    bool root_is_html = false;
+    bool body_seen = false;
+    bool in_body = false;
+
+    bool unsupported = false;
+};
+
+void scan_start_element(void *ctx, const xmlChar *localname, const xmlChar *, const xmlChar *, int, const xmlChar **, int num_attributes, int, const xmlChar **attributes)
+{
+    auto &scan = *static_cast<WidthScanContext *>(ctx);
+    ++scan.depth;
+
+    if (scan.in_body)
+    {
+        scan.scanner.on_enter_element(localname, attributes, num_attributes);
+    }
+    else if (scan.depth == 1)
+    {
+        scan.root_is_html = xmlStrEqual(localname, BAD_CAST "html");
+    }
+    else if (scan.depth == 2 && scan.root_is_html && !scan.body_seen && xmlStrEqual(localname, BAD_CAST "body"))
+    {
+        scan.body_seen = true;
+        scan.in_body = true;
+    }
+}
+
+void scan_end_element(void *ctx, const xmlChar *, const xmlChar *, const xmlChar *)
+{
+    auto &scan = *static_cast<WidthScanContext *>(ctx);
+
+    if (scan.in_body)
+    {
+        if (scan.depth == 2)
+        {
+            scan.in_body = false;
+        }
+        else
+        {
+            scan.scanner.on_exit_element();
+        }
+    }
+
+    --scan.depth;
+}
+
+void scan_characters(void *ctx, const xmlChar *ch, int len)
+{
+    auto &scan = *static_cast<WidthScanContext *>(ctx);
+    if (scan.in_body && len > 0)
+    {
+        scan.scanner.on_text((const char *)ch, len);
+    }
+}
+
+void scan_cdata(void *, const xmlChar *, int)
+{
+    // CDATA nodes aren't treated as text by parse_xhtml_tokens
+}
+
+// Declared entities and attribute defaults would show up in the tree, leave those to the full parser
+void scan_entity_decl(void *ctx, const xmlChar *, int, const xmlChar *, const xmlChar *, xmlChar *)
+{
+    static_cast<WidthScanContext *>(ctx)->unsupported = true;
+}
+
+void scan_attribute_decl(void *ctx, const xmlChar *, const xmlChar *, int, int, const xmlChar *, xmlEnumerationPtr tree)
+{
+    static_cast<WidthScanContext *>(ctx)->unsupported = true;
+    xmlFreeEnumeration(tree);
+}
+
+// Merge inline text types, emit DocTokens. Moves text out of the inline nodes.
 void generate_doc_tokens(
-    const std::vector<Node> &nodes,
+    std::vector<Node> &nodes,
     const std::filesystem::path &base_path,
     std::vector<std::unique_ptr<DocToken>> &tokens_out
 )
@@ -433,14 +859,14 @@ void generate_doc_tokens(
             case Node::Type::InlineHeader:
             case Node::Type::InlineList:
                 {
-                    std::vector<const char*> substrings;
-                    substrings.reserve(group_size);
-                    for (uint32_t j = i; j < i + group_size; ++j)
+                    // Join into the head node's buffer and compact there,
+                    // the nodes aren't needed after this
+                    std::string text = std::move(nodes[i].text);
+                    for (uint32_t j = i + 1; j < i + group_size; ++j)
                     {
-                        substrings.push_back(nodes[j].text.c_str());
+                        text.append(nodes[j].text);
                     }
-
-                    std::string text = compact_strings(substrings);
+                    compact_strings_in_place(text);
                     if (text.size())
                     {
                         if (head.type == Node::Type::InlineText)
@@ -493,7 +919,7 @@ void generate_doc_tokens(
             case Node::Type::Image:
                 {
                     xmlNodePtr node = head.node;
-                    const xmlChar *img_path = xmlGetProp(node, BAD_CAST "href");
+                    xmlChar *img_path = xmlGetProp(node, BAD_CAST "href");
                     if (!img_path) img_path = xmlGetProp(node, BAD_CAST "src");
                     if (img_path)
                     {
@@ -501,6 +927,7 @@ void generate_doc_tokens(
                             address,
                             (base_path / (const char*)img_path).lexically_normal()
                         ));
+                        xmlFree(img_path);
                     }
                     else
                     {
@@ -532,9 +959,97 @@ void generate_doc_tokens(
 
 } // namespace
 
-bool parse_xhtml_tokens(const char *xml_str, std::filesystem::path file_path, uint32_t chapter_number, std::vector<std::unique_ptr<DocToken>> &tokens_out, std::unordered_map<std::string, DocAddr> &id_to_addr_out)
+// Interned names and short text accumulate in the shared dictionary over a
+// book, start over with a fresh one past this many entries
+#define MAX_SHARED_DICT_SIZE 100000
+
+// With recovery, scanning must use the same options as the tree parse to see the same events
+#define XHTML_PARSE_OPTIONS (XML_PARSE_NOERROR | XML_PARSE_NOWARNING | XML_PARSE_RECOVER)
+
+struct XhtmlParserState
 {
-    xmlDocPtr doc = xmlReadMemory(xml_str, strlen(xml_str), nullptr, nullptr, XML_PARSE_NOERROR | XML_PARSE_NOWARNING | XML_PARSE_RECOVER);
+    xmlDictPtr dict = nullptr;
+    xmlParserCtxtPtr tree_ctxt = nullptr;
+    xmlParserCtxtPtr scan_ctxt = nullptr;
+
+    ~XhtmlParserState()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        if (tree_ctxt)
+        {
+            xmlFreeParserCtxt(tree_ctxt);
+            tree_ctxt = nullptr;
+        }
+        if (scan_ctxt)
+        {
+            xmlFreeParserCtxt(scan_ctxt);
+            scan_ctxt = nullptr;
+        }
+        if (dict)
+        {
+            xmlDictFree(dict);
+            dict = nullptr;
+        }
+    }
+
+    // Create ctxt on first use, sharing the dictionary between both contexts
+    xmlParserCtxtPtr get_context(xmlParserCtxtPtr &ctxt)
+    {
+        if (dict && xmlDictSize(dict) > MAX_SHARED_DICT_SIZE)
+        {
+            reset();
+        }
+
+        if (!dict)
+        {
+            dict = xmlDictCreate();
+            if (!dict)
+            {
+                return nullptr;
+            }
+        }
+
+        if (!ctxt)
+        {
+            ctxt = xmlNewParserCtxt();
+            if (!ctxt)
+            {
+                return nullptr;
+            }
+            xmlDictFree(ctxt->dict);
+            ctxt->dict = dict;
+            xmlDictReference(dict);
+        }
+
+        return ctxt;
+    }
+};
+
+XhtmlParser::XhtmlParser() : state(std::make_unique<XhtmlParserState>())
+{
+}
+
+XhtmlParser::~XhtmlParser()
+{
+}
+
+bool XhtmlParser::parse_tokens(const char *xml_str, std::filesystem::path file_path, uint32_t chapter_number, std::vector<std::unique_ptr<DocToken>> &tokens_out, std::unordered_map<std::string, DocAddr> &id_to_addr_out)
+{
+    ScopedAllocCounter alloc_counter(AllocSite::XhtmlParse);
+
+    xmlParserCtxtPtr ctxt = state->get_context(state->tree_ctxt);
+    if (ctxt == nullptr)
+    {
+        std::cerr << "Unable to create parser for " << file_path << std::endl;
+        return false;
+    }
+
+    // Resets the context for this document, keeping the dictionary
+    xmlDocPtr doc = xmlCtxtReadMemory(ctxt, xml_str, strlen(xml_str), nullptr, nullptr, XHTML_PARSE_OPTIONS);
     if (doc == nullptr)
     {
         std::cerr << "Unable to parse " << file_path << " as xml" << std::endl;
@@ -558,3 +1073,75 @@ bool parse_xhtml_tokens(const char *xml_str, std::filesystem::path file_path, ui
 
     return true;
 }
+
+std::optional<uint32_t> XhtmlParser::scan_address_width(const char *xml_str)
+{
+    uint32_t len = strlen(xml_str);
+    if (len == 0)
+    {
+        return 0;  // empty input, no tokens
+    }
+
+    xmlParserCtxtPtr ctxt = state->get_context(state->scan_ctxt);
+    if (ctxt == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    xmlSAXHandler handler;
+    memset(&handler, 0, sizeof(handler));
+    handler.initialized = XML_SAX2_MAGIC;
+    handler.startElementNs = scan_start_element;
+    handler.endElementNs = scan_end_element;
+    handler.characters = scan_characters;
+    handler.ignorableWhitespace = scan_characters;
+    handler.cdataBlock = scan_cdata;
+    handler.entityDecl = scan_entity_decl;
+    handler.attributeDecl = scan_attribute_decl;
+
+    xmlCtxtReset(ctxt);
+    xmlParserInputBufferPtr buffer = xmlParserInputBufferCreateMem(xml_str, len, XML_CHAR_ENCODING_NONE);
+    if (buffer == nullptr)
+    {
+        return std::nullopt;
+    }
+    xmlParserInputPtr input = xmlNewIOInputStream(ctxt, buffer, XML_CHAR_ENCODING_NONE);
+    if (input == nullptr)
+    {
+        xmlFreeParserInputBuffer(buffer);
+        return std::nullopt;
+    }
+    inputPush(ctxt, input);
+
+    WidthScanContext scan;
+    *ctxt->sax = handler;
+    ctxt->userData = &scan;
+
+    xmlCtxtUseOptions(ctxt, XHTML_PARSE_OPTIONS);
+    xmlParseDocument(ctxt);
+
+    if (ctxt->myDoc)
+    {
+        xmlFreeDoc(ctxt->myDoc);
+        ctxt->myDoc = nullptr;
+    }
+    ctxt->userData = nullptr;
+
+    if (scan.unsupported)
+    {
+        return std::nullopt;
+    }
+    return scan.scanner.finish();
+}
+
+bool parse_xhtml_tokens(const char *xml_str, std::filesystem::path file_path, uint32_t chapter_number, std::vector<std::unique_ptr<DocToken>> &tokens_out, std::unordered_map<std::string, DocAddr> &id_to_addr_out)
+{
+    XhtmlParser parser;
+    return parser.parse_tokens(xml_str, file_path, chapter_number, tokens_out, id_to_addr_out);
+}
+
+std::optional<uint32_t> scan_xhtml_address_width(const char *xml_str)
+{
+    XhtmlParser parser;
+    return parser.scan_address_width(xml_str);
+}
@@ -4,10 +4,38 @@
 #include "doc_api/doc_token.h"
 
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 bool parse_xhtml_tokens(const char *xml_str, std::filesystem::path file_path, uint32_t chapter_number, std::vector<std::unique_ptr<DocToken>> &tokens_out, std::unordered_map<std::string, DocAddr> &id_to_addr_out);
 
+// Address width of the tokens parse_xhtml_tokens would produce, from a single
+// streaming pass that doesn't build a tree or tokens. Returns nullopt for
+// documents the scanner doesn't handle (DTD declarations), which need the full parse.
+std::optional<uint32_t> scan_xhtml_address_width(const char *xml_str);
+
+struct XhtmlParserState;
+
+// Same as the above, but keeps libxml2 parser contexts and their name
+// dictionary between documents, e.g. for all chapters of a book. Not thread
+// safe, use one per thread.
+class XhtmlParser
+{
+    std::unique_ptr<XhtmlParserState> state;
+
+public:
+    XhtmlParser();
+    XhtmlParser(const XhtmlParser &) = delete;
+    XhtmlParser &operator=(const XhtmlParser &) = delete;
+    ~XhtmlParser();
+
+    // See parse_xhtml_tokens
+    bool parse_tokens(const char *xml_str, std::filesystem::path file_path, uint32_t chapter_number, std::vector<std::unique_ptr<DocToken>> &tokens_out, std::unordered_map<std::string, DocAddr> &id_to_addr_out);
+    // See scan_xhtml_address_width
+    std::optional<uint32_t> scan_address_width(const char *xml_str);
+};
+
 #endif
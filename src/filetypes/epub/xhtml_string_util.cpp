@@ -4,34 +4,161 @@
 
 #include <cstring>
 
-std::string compact_whitespace(const char *str)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define COMPACT_NEON 1
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+    #define COMPACT_SSE2 1
+#endif
+
+namespace
 {
-    std::string result;
-    result.reserve(strlen(str));
 
+inline void compact_char(char c, char *&out, bool &last_was_whitespace)
+{
+    if (is_whitespace(c))
+    {
+        if (!last_was_whitespace)
+        {
+            *out++ = ' ';  // treat all whitespace as ' '
+            last_was_whitespace = true;
+        }
+    }
+    else
+    {
+        *out++ = c;
+        last_was_whitespace = false;
+    }
+}
+
+#if COMPACT_NEON || COMPACT_SSE2
+
+// Per byte flags of a 16 byte block, packed into an integer with
+// LANE_BITS bits per byte, first byte in the lowest bits.
+struct BlockMasks
+{
+    uint64_t whitespace;
+    uint64_t not_space;  // whitespace other than ' '
+};
+
+#if COMPACT_NEON
+
+constexpr uint32_t LANE_BITS = 4;
+
+inline uint64_t pack_lanes(uint8x16_t v)
+{
+    // No movemask on NEON, narrow each 0x00/0xFF byte to a nibble instead
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(v), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+inline BlockMasks block_masks(const char *p)
+{
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+    uint8x16_t space = vceqq_u8(v, vdupq_n_u8(' '));
+    uint8x16_t other = vceqq_u8(v, vdupq_n_u8('\t'));
+    other = vorrq_u8(other, vceqq_u8(v, vdupq_n_u8('\r')));
+    other = vorrq_u8(other, vceqq_u8(v, vdupq_n_u8('\n')));
+
+    return {pack_lanes(vorrq_u8(space, other)), pack_lanes(other)};
+}
+
+#else
+
+constexpr uint32_t LANE_BITS = 1;
+
+inline BlockMasks block_masks(const char *p)
+{
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    __m128i other = _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'));
+    other = _mm_or_si128(other, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    other = _mm_or_si128(other, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+
+    return {
+        static_cast<uint64_t>(_mm_movemask_epi8(_mm_or_si128(space, other))),
+        static_cast<uint64_t>(_mm_movemask_epi8(other))
+    };
+}
+
+#endif
+
+constexpr uint64_t FIRST_LANE = (1ull << LANE_BITS) - 1;
+constexpr uint32_t LAST_LANE_SHIFT = 15 * LANE_BITS;
+
+#endif
+
+} // namespace
+
+uint32_t compact_whitespace_in_place(char *str, uint32_t len)
+{
+    char *out = str;
+    const char *in = str;
+    const char *end = str + len;
     bool last_was_whitespace = false;
-    char c;
-    for (; (c = *str); ++str)
+
+#if COMPACT_NEON || COMPACT_SSE2
+    // Most blocks of prose only have single ' ' chars between words, which
+    // compaction leaves as they are. Those get moved as a whole, anything
+    // else goes char by char.
+    while (end - in >= 16)
     {
-        if (is_whitespace(c))
+        BlockMasks masks = block_masks(in);
+        uint64_t preceded_by_whitespace = (masks.whitespace << LANE_BITS) | (last_was_whitespace ? FIRST_LANE : 0);
+
+        if (masks.not_space == 0 && (masks.whitespace & preceded_by_whitespace) == 0)
         {
-            if (last_was_whitespace)
+            if (out != in)
             {
-                continue;
+                memmove(out, in, 16);
             }
-            last_was_whitespace = true;
-            result.push_back(' ');  // treat all whitespace as ' '
+            out += 16;
+            in += 16;
+            last_was_whitespace = (masks.whitespace >> LAST_LANE_SHIFT) & 1;
         }
         else
         {
-            last_was_whitespace = false;
-            result.push_back(c);
+            for (const char *block_end = in + 16; in < block_end; ++in)
+            {
+                compact_char(*in, out, last_was_whitespace);
+            }
         }
     }
+#endif
 
+    for (; in < end; ++in)
+    {
+        compact_char(*in, out, last_was_whitespace);
+    }
+
+    return out - str;
+}
+
+std::string compact_whitespace(const char *str)
+{
+    std::string result(str);
+    result.resize(compact_whitespace_in_place(result.data(), result.size()));
     return result;
 }
 
+void compact_strings_in_place(std::string &joined)
+{
+    // Whitespace runs spanning the joined strings collapse just like runs
+    // within them, so this only has to trim the ends afterwards.
+    uint32_t len = compact_whitespace_in_place(joined.data(), joined.size());
+    if (len > 0 && joined[len - 1] == ' ')
+    {
+        --len;
+    }
+    joined.resize(len);
+
+    if (!joined.empty() && joined[0] == ' ')
+    {
+        joined.erase(0, 1);
+    }
+}
+
 std::string compact_strings(const std::vector<const char*> &strings)
 {
     std::string result;
@@ -46,26 +173,9 @@ std::string compact_strings(const std::vector<const char*> &strings)
 
     for (const char *str : strings)
     {
-        std::string substring = compact_whitespace(str);
-
-        if (result.empty())
-        {
-            substring = strip_whitespace_left(substring);
-        }
-
-        bool space_left = result.empty() ? false : is_whitespace(result[result.size() - 1]);
-        bool space_right = substring.empty() ? false : is_whitespace(substring[0]);
-        if (space_left && space_right)
-        {
-            substring = strip_whitespace_left(substring);
-        }
-
-        result.append(substring);
+        result.append(str);
     }
 
-    if (!result.empty() && is_whitespace(result[result.size() - 1]))
-    {
-        result = strip_whitespace_right(result);
-    }
+    compact_strings_in_place(result);
     return result;
 }
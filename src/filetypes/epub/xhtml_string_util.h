@@ -1,13 +1,21 @@
 #ifndef XHTML_STRING_UTIL_H_
 #define XHTML_STRING_UTIL_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 // Convert all whitespace chars to space and limit consecutive whitespace to 1 char length
 std::string compact_whitespace(const char *str);
 
+// compact_whitespace on the first len chars of str, rewriting them in place.
+// Returns the compacted length.
+uint32_t compact_whitespace_in_place(char *str, uint32_t len);
+
 // Join multiple strings, applying html whitespace rules
 std::string compact_strings(const std::vector<const char*> &strings);
 
+// compact_strings for strings that have already been joined into one buffer
+void compact_strings_in_place(std::string &joined);
+
 #endif
@@ -31,12 +31,12 @@ bool file_type_is_supported(const std::filesystem::path &path)
     return ext == EPUB_EXT || TEXT_EXTS.count(ext) > 0;
 }
 
-std::shared_ptr<DocReader> create_doc_reader(const std::filesystem::path &path)
+std::shared_ptr<DocReader> create_doc_reader(const std::filesystem::path &path, DocWidthsMode epub_widths_mode)
 {
     auto ext = norm_extension(path);
     if (ext == EPUB_EXT)
     {
-        return std::make_shared<EPubReader>(path);
+        return std::make_shared<EPubReader>(path, epub_widths_mode);
     }
     if (TEXT_EXTS.count(ext) > 0)
     {
@@ -46,3 +46,19 @@ std::shared_ptr<DocReader> create_doc_reader(const std::filesystem::path &path)
     std::cerr << "Unsupported file type: " << path.string() << std::endl;
     return nullptr;
 }
+
+std::optional<DocMetadata> read_doc_metadata(const std::filesystem::path &path)
+{
+    auto ext = norm_extension(path);
+    if (ext == EPUB_EXT)
+    {
+        return epub_read_metadata(path);
+    }
+    if (TEXT_EXTS.count(ext) > 0)
+    {
+        return txt_read_metadata(path);
+    }
+
+    std::cerr << "Unsupported file type: " << path.string() << std::endl;
+    return std::nullopt;
+}
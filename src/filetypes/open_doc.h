@@ -2,11 +2,19 @@
 #define OPEN_DOC_H_
 
 #include "doc_api/doc_reader.h"
+#include "filetypes/epub/epub_reader.h"
 
 #include <filesystem>
 #include <memory>
+#include <optional>
 
 bool file_type_is_supported(const std::filesystem::path &path);
-std::shared_ptr<DocReader> create_doc_reader(const std::filesystem::path &path);
+// epub_widths_mode applies to epubs only
+std::shared_ptr<DocReader> create_doc_reader(
+    const std::filesystem::path &path,
+    DocWidthsMode epub_widths_mode = DocWidthsMode::Deferred
+);
+// Safe to call from a background thread
+std::optional<DocMetadata> read_doc_metadata(const std::filesystem::path &path);
 
 #endif
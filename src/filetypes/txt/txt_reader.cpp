@@ -47,6 +47,28 @@ bool tokenize_text_file(const std::filesystem::path &path, std::vector<std::uniq
     return true;
 }
 
+// Same id as tokenize_text_file, without building tokens
+bool hash_text_file(const std::filesystem::path &path, std::string &md5_out)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    MD5 md5;
+    while (std::getline(file, line))
+    {
+        md5.add(line.c_str(), line.size());
+        md5.add("\n", 1);
+    }
+
+    md5_out = md5.getHash();
+
+    return true;
+}
+
 } // namespace
 
 struct TxtReaderState
@@ -73,7 +95,7 @@ TxtReader::~TxtReader()
 {
 }
 
-bool TxtReader::open(DocReaderCache &)
+bool TxtReader::open(DocReaderCache &, const OpenProgressCallback &)
 {
     if (state->is_open)
     {
@@ -136,3 +158,15 @@ std::vector<char> TxtReader::load_resource(const std::filesystem::path &) const
 {
     throw std::runtime_error("Load resource is not supported for txt");
 }
+
+std::optional<DocMetadata> txt_read_metadata(const std::filesystem::path &path)
+{
+    std::string md5;
+    if (!hash_text_file(path, md5))
+    {
+        std::cerr << "Failed to read " << path << std::endl;
+        return std::nullopt;
+    }
+
+    return DocMetadata{md5, path.stem().string(), ""};
+}
@@ -19,7 +19,7 @@ public:
     virtual ~TxtReader();
 
     using DocReader::open;
-    bool open(DocReaderCache &) override;
+    bool open(DocReaderCache &, const OpenProgressCallback &) override;
     bool is_open() const override;
 
     std::string get_id() const override;
@@ -35,4 +35,7 @@ public:
     std::vector<char> load_resource(const std::filesystem::path &path) const override;
 };
 
+// Title is taken from the file name, as text files carry no metadata
+std::optional<DocMetadata> txt_read_metadata(const std::filesystem::path &path);
+
 #endif
@@ -0,0 +1,339 @@
+#include "./book_search.h"
+
+#include "doc_api/doc_reader.h"
+#include "doc_api/search_index.h"
+#include "filetypes/open_doc.h"
+#include "reader/config.h"
+#include "reader/state_store.h"
+#include "util/task_queue.h"
+#include "util/timer.h"
+
+#include <atomic>
+#include <iostream>
+#include <optional>
+
+namespace
+{
+
+// Shared between the UI thread and the worker running the current chunk.
+// Only one chunk is in flight at a time.
+struct BuildJob
+{
+    // A reader of its own, as the one being displayed is main thread only
+    std::shared_ptr<DocReader> reader;
+    std::shared_ptr<TokenIter> iter;
+    SearchIndexBuilder builder;
+
+    std::optional<SearchIndex> index;
+    bool failed = false;
+
+    std::atomic<uint32_t> progress_percent {0};
+};
+
+// Shared between the UI thread and the worker running the current chunk
+struct UnindexedSearchJob
+{
+    std::filesystem::path book_path;
+    DocReaderCache &doc_cache;
+    TaskQueue &task_queue;
+    CancelToken token;
+
+    SearchPhraseMatcher matcher;
+    uint32_t max_results;
+    std::function<bool(const std::vector<DocAddr> &)> on_results;
+    std::function<void()> on_done;
+
+    std::shared_ptr<DocReader> reader;
+    std::shared_ptr<TokenIter> iter;
+
+    uint32_t num_found = 0;
+    std::vector<DocAddr> found_batch;
+    bool done = false;
+
+    UnindexedSearchJob(
+        std::filesystem::path book_path,
+        DocReaderCache &doc_cache,
+        TaskQueue &task_queue,
+        CancelToken token,
+        const std::string &query,
+        uint32_t max_results,
+        std::function<bool(const std::vector<DocAddr> &)> on_results,
+        std::function<void()> on_done
+    ) :
+        book_path(book_path),
+        doc_cache(doc_cache),
+        task_queue(task_queue),
+        token(token),
+        matcher(query),
+        max_results(max_results),
+        on_results(on_results),
+        on_done(on_done)
+    {
+    }
+};
+
+// Search the tokens that fit in the time budget, then deliver what was found
+// and continue with another chunk. Chapters stream through a reader of the
+// job's own, which only keeps the chapters around the current one parsed.
+void submit_unindexed_search_chunk(std::shared_ptr<UnindexedSearchJob> job)
+{
+    job->task_queue.submit_background(
+        [job]() {
+            if (!job->reader)
+            {
+                job->reader = create_doc_reader(job->book_path, DocWidthsMode::Estimated);
+                auto token = job->token;
+                bool opened = job->reader && job->reader->open(job->doc_cache, [token](uint32_t, uint32_t) {
+                    return !token.is_cancelled();
+                });
+                if (!opened)
+                {
+                    std::cerr << "Failed to open " << job->book_path << " for search" << std::endl;
+                    job->done = true;
+                    return;
+                }
+                job->reader->set_sequential_access();
+                job->iter = job->reader->get_iter(0);
+            }
+
+            Timer timer;
+            while (timer.elapsed_ms() < SEARCH_UNINDEXED_CHUNK_MS && !job->token.is_cancelled())
+            {
+                const DocToken *doc_token = job->iter->read(1);
+                if (!doc_token)
+                {
+                    job->done = true;
+                    return;
+                }
+
+                const std::string *text = get_searchable_text(*doc_token);
+                if (!text)
+                {
+                    continue;
+                }
+
+                job->matcher.add_text(doc_token->address, *text, [&job](DocAddr match_address) {
+                    job->found_batch.push_back(match_address);
+                    job->done = ++job->num_found >= job->max_results;
+                    return !job->done;
+                });
+
+                if (job->done)
+                {
+                    return;
+                }
+            }
+        },
+        [job]() {
+            bool keep_going = job->on_results(job->found_batch);
+            job->found_batch.clear();
+
+            if (!keep_going)
+            {
+                job->token.cancel();
+            }
+            else if (job->done)
+            {
+                job->on_done();
+            }
+            else
+            {
+                submit_unindexed_search_chunk(job);
+            }
+        },
+        TaskPriority::Normal,
+        job->token
+    );
+}
+
+} // namespace
+
+struct BookSearchState
+{
+    std::filesystem::path book_path;
+    std::filesystem::path index_path;
+    DocReaderCache &doc_cache;
+    TaskQueue &task_queue;
+
+    std::shared_ptr<BuildJob> job;
+    CancelToken cancel_token;
+
+    std::optional<SearchIndex> index;
+    bool failed = false;
+
+    CancelToken unindexed_search_token;
+
+    BookSearchState(
+        std::filesystem::path book_path,
+        std::filesystem::path index_path,
+        DocReaderCache &doc_cache,
+        TaskQueue &task_queue
+    ) :
+        book_path(book_path),
+        index_path(index_path),
+        doc_cache(doc_cache),
+        task_queue(task_queue),
+        job(std::make_shared<BuildJob>())
+    {
+    }
+};
+
+BookSearch::BookSearch(
+    std::filesystem::path book_path,
+    std::string book_id,
+    StateStore &state_store,
+    DocReaderCache &doc_cache,
+    TaskQueue &task_queue
+) : state(std::make_unique<BookSearchState>(book_path, state_store.get_search_index_path(book_id), doc_cache, task_queue))
+{
+    auto job = state->job;
+    auto index_path = state->index_path;
+    task_queue.submit_background(
+        [job, index_path]() {
+            job->index = SearchIndex::load(index_path);
+        },
+        [this]() {
+            if (state->job->index)
+            {
+                state->index = std::move(state->job->index);
+                state->job.reset();
+            }
+            else
+            {
+                submit_build_chunk();
+            }
+        },
+        TaskPriority::Low,
+        state->cancel_token
+    );
+}
+
+BookSearch::~BookSearch()
+{
+    state->cancel_token.cancel();
+    state->unindexed_search_token.cancel();
+}
+
+void BookSearch::submit_build_chunk()
+{
+    auto job = state->job;
+    auto token = state->cancel_token;
+    auto book_path = state->book_path;
+    auto index_path = state->index_path;
+    auto &doc_cache = state->doc_cache;
+
+    state->task_queue.submit_background(
+        [job, token, book_path, index_path, &doc_cache]() {
+            if (!job->reader)
+            {
+                // Progress is only a rough indicator here, so nothing is
+                // measured ahead of reading
+                job->reader = create_doc_reader(book_path, DocWidthsMode::Estimated);
+                bool opened = job->reader && job->reader->open(doc_cache, [token](uint32_t, uint32_t) {
+                    return !token.is_cancelled();
+                });
+                if (!opened)
+                {
+                    job->failed = true;
+                    return;
+                }
+                job->reader->set_sequential_access();
+                job->iter = job->reader->get_iter(0);
+            }
+
+            for (uint32_t i = 0; i < SEARCH_INDEX_CHUNK_TOKENS; ++i)
+            {
+                const DocToken *doc_token = job->iter->read(1);
+                if (!doc_token)
+                {
+                    job->index = job->builder.build();
+                    job->index->save(index_path);
+                    job->progress_percent = 100;
+                    return;
+                }
+                job->builder.add_token(*doc_token);
+
+                if (i == 0)
+                {
+                    job->progress_percent = job->reader->get_global_progress_percent(doc_token->address);
+                }
+            }
+        },
+        [this]() {
+            if (state->job->failed)
+            {
+                std::cerr << "Failed to index " << state->book_path << " for search" << std::endl;
+                state->failed = true;
+                state->job.reset();
+            }
+            else if (state->job->index)
+            {
+                state->index = std::move(state->job->index);
+                state->job.reset();
+            }
+            else
+            {
+                submit_build_chunk();
+            }
+        },
+        TaskPriority::Low,
+        token
+    );
+}
+
+bool BookSearch::is_ready() const
+{
+    return state->index.has_value();
+}
+
+bool BookSearch::has_failed() const
+{
+    return state->failed;
+}
+
+uint32_t BookSearch::build_progress_percent() const
+{
+    if (state->index)
+    {
+        return 100;
+    }
+    return state->job ? state->job->progress_percent.load() : 0;
+}
+
+std::vector<DocAddr> BookSearch::find(const std::string &query, uint32_t max_results) const
+{
+    if (!state->index)
+    {
+        return {};
+    }
+    return state->index->find(query, max_results);
+}
+
+void BookSearch::find_unindexed(
+    const std::string &query,
+    uint32_t max_results,
+    std::function<bool(const std::vector<DocAddr> &)> on_results,
+    std::function<void()> on_done
+)
+{
+    state->unindexed_search_token.cancel();
+    state->unindexed_search_token = CancelToken();
+
+    auto job = std::make_shared<UnindexedSearchJob>(
+        state->book_path,
+        state->doc_cache,
+        state->task_queue,
+        state->unindexed_search_token,
+        query,
+        max_results,
+        on_results,
+        on_done
+    );
+    if (job->matcher.empty() || max_results == 0)
+    {
+        on_done();
+        return;
+    }
+
+    submit_unindexed_search_chunk(job);
+}
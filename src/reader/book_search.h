@@ -0,0 +1,58 @@
+#ifndef BOOK_SEARCH_H_
+#define BOOK_SEARCH_H_
+
+#include "doc_api/doc_addr.h"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct DocReaderCache;
+struct BookSearchState;
+struct StateStore;
+struct TaskQueue;
+
+// Full text search over a book. The index is loaded from the state store, or
+// built in low priority background chunks and saved there once complete.
+class BookSearch
+{
+    std::unique_ptr<BookSearchState> state;
+
+    void submit_build_chunk();
+
+public:
+    BookSearch(
+        std::filesystem::path book_path,
+        std::string book_id,
+        StateStore &state_store,
+        DocReaderCache &doc_cache,
+        TaskQueue &task_queue
+    );
+    BookSearch(const BookSearch &) = delete;
+    BookSearch &operator=(const BookSearch &) = delete;
+    virtual ~BookSearch();
+
+    bool is_ready() const;
+    bool has_failed() const;
+    // Percent of the book indexed so far
+    uint32_t build_progress_percent() const;
+
+    // Addresses of matches in reading order. Empty until ready.
+    std::vector<DocAddr> find(const std::string &query, uint32_t max_results) const;
+
+    // Search without the index, for use until it's ready, matching as find
+    // does. Streams through the book on a worker, passing on_results the matches found in each time slice
+    // (possibly none), then calls on_done once the book is searched or
+    // max_results found. Return false from on_results to stop. Starting
+    // another search also stops this one.
+    void find_unindexed(
+        const std::string &query,
+        uint32_t max_results,
+        std::function<bool(const std::vector<DocAddr> &)> on_results,
+        std::function<void()> on_done
+    );
+};
+
+#endif
@@ -1,10 +1,18 @@
 #ifndef CONFIG_H_
 #define CONFIG_H_
 
-#define TARGET_FPS 20
+// Interval to check held keys for repeat actions
+#define HELD_KEY_POLL_MS 50
 
 #define IDLE_SAVE_TIME_SEC 60
 
+// Interval to check for input while waiting. Short while keys are held, views
+// animate, or soon after a key press, when latency matters. Longer otherwise,
+// so an idle reader wakes less often.
+#define EVENT_PUMP_ACTIVE_MS        10
+#define EVENT_PUMP_IDLE_MS          50
+#define EVENT_PUMP_ACTIVE_WINDOW_MS 2000
+
 #define FONT_DIR            "resources/fonts"
 #define DEFAULT_FONT_NAME   "resources/fonts/DejaVuSans.ttf"
 #define SYSTEM_FONT         "resources/fonts/DejaVuSansMono.ttf"
@@ -35,4 +43,21 @@
 
 #define DEFAULT_PROGRESS_REPORTING ProgressReporting::GLOBAL_PERCENT
 
+// Smooth scrolling draws from a strip of lines pre-rendered around the page.
+// A line scroll takes SMOOTH_SCROLL_LINE_MS, animated every ANIMATION_FRAME_MS.
+#define DEFAULT_SMOOTH_SCROLL      false
+#define SMOOTH_SCROLL_MARGIN_LINES 4
+#define SMOOTH_SCROLL_LINE_MS      120
+#define ANIMATION_FRAME_MS         16
+
+// Tokens indexed per background task, so indexing yields to other work
+#define SEARCH_INDEX_CHUNK_TOKENS 1000
+#define SEARCH_MAX_RESULTS        200
+
+// Time slice for searching books that aren't indexed yet, between reporting results
+#define SEARCH_UNINDEXED_CHUNK_MS 100
+
+// Books read per background task while scanning the library for metadata
+#define LIBRARY_SCAN_CHUNK_FILES 16
+
 #endif
@@ -9,15 +9,16 @@ void draw_modal_border(uint32_t w, uint32_t h, const ColorTheme &theme, SDL_Surf
     w += DIALOG_PADDING * 2;
     h += DIALOG_PADDING * 2;
 
-    // transparent background
+    // transparent background, in the destination format for a direct blit
     {
+        const SDL_PixelFormat *format = dest_surface->format;
         surface_unique_ptr mask = surface_unique_ptr {
             SDL_CreateRGBSurface(
                 SDL_SWSURFACE,
                 SCREEN_WIDTH,
                 SCREEN_HEIGHT,
-                32,
-                0, 0, 0, 0
+                format->BitsPerPixel,
+                format->Rmask, format->Gmask, format->Bmask, 0
             )
         };
         SDL_SetAlpha(mask.get(), SDL_SRCALPHA, 128);
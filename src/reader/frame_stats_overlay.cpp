@@ -0,0 +1,76 @@
+#include "./frame_stats_overlay.h"
+
+#include "./config.h"
+#include "util/frame_stats.h"
+#include "util/sdl_font_cache.h"
+#include "util/sdl_pointer.h"
+#include "util/sdl_utils.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::string format_row(const char *label, const char *p50, const char *p90, const char *p99, const char *max)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%-7s %6s %6s %6s %6s", label, p50, p90, p99, max);
+    return buf;
+}
+
+std::string format_ms(uint32_t micros)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%.1f", micros / 1000.0f);
+    return buf;
+}
+
+} // namespace
+
+void draw_frame_stats_overlay(const FrameStats &stats, SDL_Surface *dest_surface)
+{
+    TTF_Font *font = cached_load_font(SYSTEM_FONT, MIN_FONT_SIZE);
+    const int line_height = detect_line_height(font);
+    const int padding = 4;
+
+    std::vector<std::string> rows;
+    rows.push_back(format_row("ms", "p50", "p90", "p99", "max"));
+    for (uint32_t i = 0; i < NUM_FRAME_PHASES; ++i)
+    {
+        FramePhase phase = static_cast<FramePhase>(i);
+        PhaseSummary summary = stats.summarize(phase);
+        rows.push_back(format_row(
+            frame_phase_name(phase),
+            format_ms(summary.p50_us).c_str(),
+            format_ms(summary.p90_us).c_str(),
+            format_ms(summary.p99_us).c_str(),
+            format_ms(summary.max_us).c_str()
+        ));
+    }
+    rows.push_back("frames: " + std::to_string(stats.num_frames()));
+
+    const SDL_Color fg = {255, 255, 255, 0};
+    const SDL_Color bg = {0, 0, 0, 0};
+
+    int text_w = 0, text_h = 0;
+    TTF_SizeUTF8(font, rows.front().c_str(), &text_w, &text_h);
+
+    SDL_Rect bg_rect = {
+        0,
+        0,
+        static_cast<Uint16>(text_w + padding * 2),
+        static_cast<Uint16>(line_height * rows.size() + padding * 2)
+    };
+    SDL_FillRect(dest_surface, &bg_rect, SDL_MapRGB(dest_surface->format, bg.r, bg.g, bg.b));
+
+    Sint16 y = padding;
+    for (const auto &row : rows)
+    {
+        auto text = surface_unique_ptr { TTF_RenderUTF8_Shaded(font, row.c_str(), fg, bg) };
+        SDL_Rect dest_rect = {padding, y, 0, 0};
+        SDL_BlitSurface(text.get(), nullptr, dest_surface, &dest_rect);
+        y += line_height;
+    }
+}
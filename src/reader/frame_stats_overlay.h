@@ -0,0 +1,11 @@
+#ifndef FRAME_STATS_OVERLAY_H_
+#define FRAME_STATS_OVERLAY_H_
+
+#include <SDL/SDL_video.h>
+
+struct FrameStats;
+
+// Draw per phase frame time percentiles in the top left corner.
+void draw_frame_stats_overlay(const FrameStats &stats, SDL_Surface *dest_surface);
+
+#endif
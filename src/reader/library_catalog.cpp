@@ -0,0 +1,515 @@
+#include "./library_catalog.h"
+
+#include "filetypes/open_doc.h"
+#include "reader/config.h"
+#include "reader/state_store.h"
+#include "util/string_serialization.h"
+#include "util/task_queue.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+
+constexpr const char *CATALOG_HEADER = "library_catalog_v1";
+constexpr char FIELD_SEPARATOR = '\t';
+constexpr uint32_t NUM_FIELDS = 7;
+
+struct FileIdentity
+{
+    std::string path;
+    uint64_t size;
+    int64_t mtime;
+};
+
+// Shared between the UI thread and the worker walking the directory
+struct ScanJob
+{
+    std::filesystem::path root;
+
+    // Catalog when the scan started, to compare against
+    std::unordered_map<std::string, std::pair<uint64_t, int64_t>> known_files;
+
+    // Results of the walk
+    std::vector<FileIdentity> changed_files;
+    std::vector<std::string> removed_paths;
+    bool walk_failed = false;
+
+    // Metadata reads, done a chunk at a time
+    uint32_t next_changed_file = 0;
+};
+
+// Files in flight for one metadata read chunk
+struct ReadChunk
+{
+    std::vector<FileIdentity> files;
+    std::vector<std::optional<DocMetadata>> metadata;
+};
+
+std::string escape_field(const std::string &field)
+{
+    std::string out;
+    out.reserve(field.size());
+    for (char c : field)
+    {
+        switch (c)
+        {
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            default:
+                out += c;
+                break;
+        }
+    }
+    return out;
+}
+
+std::string unescape_field(const std::string &field)
+{
+    std::string out;
+    out.reserve(field.size());
+    for (uint32_t i = 0; i < field.size(); ++i)
+    {
+        if (field[i] == '\\' && i + 1 < field.size())
+        {
+            char next = field[++i];
+            out += (next == 't') ? '\t' : (next == 'n') ? '\n' : next;
+        }
+        else
+        {
+            out += field[i];
+        }
+    }
+    return out;
+}
+
+bool is_hidden(const std::filesystem::path &path)
+{
+    // Includes "._" resource forks left on sd cards by macOS
+    std::string name = path.filename().string();
+    return !name.empty() && name[0] == '.';
+}
+
+std::string catalog_key(const std::filesystem::path &path)
+{
+    return std::filesystem::absolute(path).lexically_normal().string();
+}
+
+// Walk the directory tree and compare with what's already known
+void walk_library(ScanJob &job)
+{
+    std::error_code ec;
+    std::filesystem::recursive_directory_iterator it(
+        job.root,
+        std::filesystem::directory_options::skip_permission_denied,
+        ec
+    );
+    if (ec)
+    {
+        std::cerr << "Unable to scan library " << job.root << ": " << ec.message() << std::endl;
+        job.walk_failed = true;
+        return;
+    }
+
+    std::unordered_set<std::string> seen;
+    for (; it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (ec)
+        {
+            std::cerr << "Error scanning library: " << ec.message() << std::endl;
+            job.walk_failed = true;
+            return;
+        }
+
+        const auto &entry = *it;
+        if (is_hidden(entry.path()))
+        {
+            if (entry.is_directory(ec))
+            {
+                it.disable_recursion_pending();
+            }
+            continue;
+        }
+        if (!entry.is_regular_file(ec) || !file_type_is_supported(entry.path()))
+        {
+            continue;
+        }
+
+        uint64_t size = entry.file_size(ec);
+        if (ec)
+        {
+            continue;
+        }
+        int64_t mtime = entry.last_write_time(ec).time_since_epoch().count();
+        if (ec)
+        {
+            continue;
+        }
+
+        std::string path = catalog_key(entry.path());
+        seen.insert(path);
+
+        auto known = job.known_files.find(path);
+        if (known == job.known_files.end() || known->second != std::make_pair(size, mtime))
+        {
+            job.changed_files.push_back({path, size, mtime});
+        }
+    }
+
+    for (const auto &[path, identity] : job.known_files)
+    {
+        if (seen.count(path) == 0)
+        {
+            job.removed_paths.push_back(path);
+        }
+    }
+}
+
+// Skipped if token is cancelled before the write starts, so a save that's
+// been superseded can't overwrite a newer one.
+void write_catalog_file(const std::filesystem::path &path, const std::string &encoded, const CancelToken &token = CancelToken())
+{
+    // Saves may overlap if scans finish close together
+    static std::mutex write_mutex;
+    std::lock_guard<std::mutex> lock(write_mutex);
+    if (token.is_cancelled())
+    {
+        return;
+    }
+
+    std::filesystem::path tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream fp(tmp_path, std::ios::binary);
+        fp << encoded;
+        if (!fp)
+        {
+            std::cerr << "Unable to write library catalog " << tmp_path << std::endl;
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        std::cerr << "Unable to save library catalog " << path << ": " << ec.message() << std::endl;
+    }
+}
+
+} // namespace
+
+std::string encode_library_catalog(const std::unordered_map<std::string, CatalogEntry> &entries)
+{
+    std::ostringstream out;
+    out << CATALOG_HEADER << '\n';
+    for (const auto &[path, entry] : entries)
+    {
+        out << escape_field(path) << FIELD_SEPARATOR
+            << entry.file_size << FIELD_SEPARATOR
+            << entry.file_mtime << FIELD_SEPARATOR
+            << escape_field(entry.book_id) << FIELD_SEPARATOR
+            << (entry.progress_percent ? std::to_string(*entry.progress_percent) : "") << FIELD_SEPARATOR
+            << escape_field(entry.title) << FIELD_SEPARATOR
+            << escape_field(entry.author) << '\n';
+    }
+    return out.str();
+}
+
+bool try_decode_library_catalog(const std::string &encoded, std::unordered_map<std::string, CatalogEntry> &entries_out)
+{
+    std::istringstream in(encoded);
+
+    std::string line;
+    if (!std::getline(in, line) || line != CATALOG_HEADER)
+    {
+        return false;
+    }
+
+    std::unordered_map<std::string, CatalogEntry> entries;
+    while (std::getline(in, line))
+    {
+        std::vector<std::string> fields;
+        std::istringstream line_stream(line);
+        std::string field;
+        while (std::getline(line_stream, field, FIELD_SEPARATOR))
+        {
+            fields.push_back(field);
+        }
+        if (!line.empty() && line.back() == FIELD_SEPARATOR)
+        {
+            fields.emplace_back();  // trailing empty field
+        }
+        if (fields.size() != NUM_FIELDS)
+        {
+            return false;
+        }
+
+        CatalogEntry entry;
+        try
+        {
+            entry.file_size = std::stoull(fields[1]);
+            entry.file_mtime = std::stoll(fields[2]);
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+        entry.book_id = unescape_field(fields[3]);
+        if (!fields[4].empty())
+        {
+            entry.progress_percent = try_decode_uint(fields[4]);
+        }
+        entry.title = unescape_field(fields[5]);
+        entry.author = unescape_field(fields[6]);
+
+        entries[unescape_field(fields[0])] = std::move(entry);
+    }
+
+    entries_out = std::move(entries);
+    return true;
+}
+
+struct LibraryCatalogState
+{
+    StateStore &state_store;
+    TaskQueue &task_queue;
+    std::filesystem::path catalog_path;
+
+    std::unordered_map<std::string, CatalogEntry> entries;
+    bool unsaved_changes = false;
+    uint32_t saves_in_flight = 0;  // queued or running, until completed on the main thread
+    CancelToken save_token;
+
+    std::shared_ptr<ScanJob> scan_job;
+    CancelToken scan_token;
+
+    uint32_t next_subscriber_id = 1;
+    std::unordered_map<uint32_t, std::function<void()>> subscribers;
+
+    LibraryCatalogState(StateStore &state_store, TaskQueue &task_queue)
+        : state_store(state_store),
+          task_queue(task_queue),
+          catalog_path(state_store.get_library_catalog_path())
+    {
+    }
+
+    void submit_save()
+    {
+        auto path = catalog_path;
+        auto token = save_token;
+        task_queue.submit_background(
+            [path, token, encoded = encode_library_catalog(entries)]() {
+                write_catalog_file(path, encoded, token);
+            },
+            [this]() {
+                --saves_in_flight;
+            },
+            TaskPriority::Low,
+            save_token
+        );
+        ++saves_in_flight;
+        unsaved_changes = false;
+    }
+};
+
+LibraryCatalog::LibraryCatalog(StateStore &state_store, TaskQueue &task_queue)
+    : state(std::make_unique<LibraryCatalogState>(state_store, task_queue))
+{
+    std::ifstream fp(state->catalog_path, std::ios::binary);
+    if (fp)
+    {
+        std::stringstream buffer;
+        buffer << fp.rdbuf();
+        if (!try_decode_library_catalog(buffer.str(), state->entries))
+        {
+            std::cerr << "Ignoring invalid library catalog " << state->catalog_path << std::endl;
+        }
+    }
+}
+
+LibraryCatalog::~LibraryCatalog()
+{
+    state->scan_token.cancel();
+
+    // Queued saves are dropped on shutdown, so write synchronously in their
+    // place. Cancelling first stops a save that hasn't started writing from
+    // overwriting this one.
+    state->save_token.cancel();
+    if (state->unsaved_changes || state->saves_in_flight > 0)
+    {
+        write_catalog_file(state->catalog_path, encode_library_catalog(state->entries));
+    }
+}
+
+void LibraryCatalog::notify_subscribers() const
+{
+    for (auto &sub: state->subscribers)
+    {
+        sub.second();
+    }
+}
+
+void LibraryCatalog::scan(const std::filesystem::path &root)
+{
+    state->scan_token.cancel();
+    state->scan_token = CancelToken();
+
+    auto job = std::make_shared<ScanJob>();
+    job->root = root;
+    for (const auto &[path, entry] : state->entries)
+    {
+        job->known_files.emplace(path, std::make_pair(entry.file_size, entry.file_mtime));
+    }
+    state->scan_job = job;
+
+    state->task_queue.submit_background(
+        [job]() {
+            walk_library(*job);
+        },
+        [this, job]() {
+            if (job->walk_failed)
+            {
+                // Keep what's known, rather than dropping books on a bad read
+                state->scan_job.reset();
+                return;
+            }
+
+            for (const auto &path : job->removed_paths)
+            {
+                state->entries.erase(path);
+            }
+            if (!job->removed_paths.empty())
+            {
+                state->unsaved_changes = true;
+                notify_subscribers();
+            }
+
+            submit_read_chunk();
+        },
+        TaskPriority::Low,
+        state->scan_token
+    );
+}
+
+// Read the metadata of the next few changed files, then merge them in and
+// continue with the next chunk until all are read.
+void LibraryCatalog::submit_read_chunk()
+{
+    auto job = state->scan_job;
+    if (job->next_changed_file >= job->changed_files.size())
+    {
+        state->scan_job.reset();
+        if (state->unsaved_changes)
+        {
+            state->submit_save();
+        }
+        return;
+    }
+
+    auto chunk = std::make_shared<ReadChunk>();
+    auto begin = job->changed_files.begin() + job->next_changed_file;
+    auto end = job->changed_files.begin() + std::min<uint32_t>(
+        job->next_changed_file + LIBRARY_SCAN_CHUNK_FILES,
+        job->changed_files.size()
+    );
+    chunk->files.assign(begin, end);
+    job->next_changed_file += chunk->files.size();
+
+    state->task_queue.submit_background(
+        [chunk]() {
+            for (const auto &file : chunk->files)
+            {
+                chunk->metadata.push_back(read_doc_metadata(file.path));
+            }
+        },
+        [this, chunk]() {
+            for (uint32_t i = 0; i < chunk->files.size(); ++i)
+            {
+                const auto &file = chunk->files[i];
+                const auto &metadata = chunk->metadata[i];
+
+                CatalogEntry entry;
+                entry.file_size = file.size;
+                entry.file_mtime = file.mtime;
+                if (metadata)
+                {
+                    entry.book_id = metadata->id;
+                    entry.title = metadata->title;
+                    entry.author = metadata->author;
+                    entry.progress_percent = state->state_store.get_book_progress_percent(metadata->id);
+                }
+                state->entries[file.path] = std::move(entry);
+            }
+            state->unsaved_changes = true;
+            notify_subscribers();
+
+            submit_read_chunk();
+        },
+        TaskPriority::Low,
+        state->scan_token
+    );
+}
+
+bool LibraryCatalog::is_scanning() const
+{
+    return state->scan_job != nullptr;
+}
+
+const CatalogEntry *LibraryCatalog::find(const std::filesystem::path &path) const
+{
+    auto it = state->entries.find(catalog_key(path));
+    if (it == state->entries.end())
+    {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void LibraryCatalog::refresh_progress(const std::filesystem::path &path)
+{
+    auto it = state->entries.find(catalog_key(path));
+    if (it == state->entries.end() || it->second.book_id.empty())
+    {
+        return;
+    }
+
+    CatalogEntry &entry = it->second;
+    auto progress_percent = state->state_store.get_book_progress_percent(entry.book_id);
+    if (progress_percent != entry.progress_percent)
+    {
+        entry.progress_percent = progress_percent;
+        state->unsaved_changes = true;
+        notify_subscribers();
+
+        if (!is_scanning())
+        {
+            state->submit_save();
+        }
+    }
+}
+
+uint32_t LibraryCatalog::subscribe_to_changes(std::function<void()> callback)
+{
+    uint32_t sub_id = state->next_subscriber_id++;
+    state->subscribers[sub_id] = callback;
+    return sub_id;
+}
+
+void LibraryCatalog::unsubscribe_from_changes(uint32_t sub_id)
+{
+    state->subscribers.erase(sub_id);
+}
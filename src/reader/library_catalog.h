@@ -0,0 +1,65 @@
+#ifndef LIBRARY_CATALOG_H_
+#define LIBRARY_CATALOG_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+struct LibraryCatalogState;
+struct StateStore;
+struct TaskQueue;
+
+struct CatalogEntry
+{
+    std::string book_id;  // empty if the file couldn't be read
+    std::string title;
+    std::string author;
+    std::optional<uint32_t> progress_percent;
+
+    // File identity when the metadata was read
+    uint64_t file_size = 0;
+    int64_t file_mtime = 0;
+};
+
+// Book metadata for every supported file under a directory, so the library
+// can be browsed without opening each book. Persisted in the state store and
+// kept up to date by scans, which only read files whose size or modification
+// time changed since the last scan.
+class LibraryCatalog
+{
+    std::unique_ptr<LibraryCatalogState> state;
+
+    void submit_read_chunk();
+    void notify_subscribers() const;
+
+public:
+    // Loads the saved catalog
+    LibraryCatalog(StateStore &state_store, TaskQueue &task_queue);
+    LibraryCatalog(const LibraryCatalog &) = delete;
+    LibraryCatalog &operator=(const LibraryCatalog &) = delete;
+    virtual ~LibraryCatalog();
+
+    // Walk root in the background and update the catalog to match, replacing
+    // any scan in progress. Subscribers are notified as entries change.
+    void scan(const std::filesystem::path &root);
+    bool is_scanning() const;
+
+    // Null if the file isn't in the catalog yet
+    const CatalogEntry *find(const std::filesystem::path &path) const;
+
+    // Pick up progress recorded in the state store since the book was scanned
+    void refresh_progress(const std::filesystem::path &path);
+
+    uint32_t subscribe_to_changes(std::function<void()> callback);
+    void unsubscribe_from_changes(uint32_t sub_id);
+};
+
+// Text format of the saved catalog, one entry per line keyed by path
+std::string encode_library_catalog(const std::unordered_map<std::string, CatalogEntry> &entries);
+bool try_decode_library_catalog(const std::string &encoded, std::unordered_map<std::string, CatalogEntry> &entries_out);
+
+#endif
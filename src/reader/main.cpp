@@ -1,7 +1,10 @@
 #include "./config.h"
 #include "./font_catalog.h"
+#include "./frame_stats_overlay.h"
+#include "./library_catalog.h"
 #include "./settings_store.h"
 #include "./shoulder_keymap.h"
+#include "./ss_doc_reader_cache.h"
 #include "./state_store.h"
 #include "./system_styling.h"
 #include "./color_theme_def.h"
@@ -13,10 +16,12 @@
 #include "filetypes/open_doc.h"
 #include "sys/keymap.h"
 #include "sys/screen.h"
-#include "util/fps_limiter.h"
+#include "util/event_wait.h"
+#include "util/frame_stats.h"
 #include "util/held_key_tracker.h"
 #include "util/key_value_file.h"
 #include "util/math.h"
+#include "util/sdl_pointer.h"
 #include "util/sdl_font_cache.h"
 #include "util/task_queue.h"
 #include "util/timer.h"
@@ -24,8 +29,11 @@
 #include <libxml/parser.h>
 #include <SDL/SDL.h>
 
+#include <algorithm>
 #include <csignal>
+#include <fstream>
 #include <iostream>
+#include <memory>
 
 namespace
 {
@@ -33,13 +41,15 @@ namespace
 void initialize_views(
     ViewStack &view_stack,
     StateStore &state_store,
+    DocReaderCache &doc_cache,
     SystemStyling &sys_styling,
     TokenViewStyling &token_view_styling,
     TaskQueue &task_queue,
+    LibraryCatalog &library_catalog,
     std::optional<std::filesystem::path> requested_book_path
 )
 {
-    auto load_book = [&view_stack, &state_store, &sys_styling, &token_view_styling, &task_queue](std::filesystem::path path) {
+    auto load_book = [&view_stack, &state_store, &doc_cache, &sys_styling, &token_view_styling, &task_queue](std::filesystem::path path) {
         if (!std::filesystem::exists(path))
         {
             std::cerr << path << " does not exist" << std::endl;
@@ -58,7 +68,8 @@ void initialize_views(
                 token_view_styling,
                 view_stack,
                 state_store,
-                [&task_queue](task_func task){ task_queue.submit(task); }
+                doc_cache,
+                task_queue
             )
         );
     };
@@ -72,7 +83,8 @@ void initialize_views(
         auto browse_path = state_store.get_current_browse_path().value_or(DEFAULT_BROWSE_PATH);
         std::shared_ptr<FileSelector> fs = std::make_shared<FileSelector>(
             browse_path,
-            sys_styling
+            sys_styling,
+            &library_catalog
         );
 
         fs->set_on_file_selected(load_book);
@@ -158,7 +170,80 @@ void signal_handler(int)
     quit = true;
 }
 
+// Time until the main loop needs to wake up, if no events arrive.
+uint32_t next_timer_due_ms(const HeldKeyTracker &held_key_tracker, const Timer &held_key_timer, const Timer &idle_timer)
+{
+    const uint32_t idle_save_ms = IDLE_SAVE_TIME_SEC * 1000;
+    uint32_t timeout_ms = idle_save_ms - std::min(idle_timer.elapsed_ms(), idle_save_ms);
+
+    if (held_key_tracker.any_held())
+    {
+        const uint32_t held_poll_ms = HELD_KEY_POLL_MS;
+        timeout_ms = std::min(
+            timeout_ms,
+            held_poll_ms - std::min(held_key_timer.elapsed_ms(), held_poll_ms)
+        );
+    }
+
+    return timeout_ms;
+}
+
+bool drain_tasks(TaskQueue &task_queue)
+{
+    ScopedFrameTimer timer(FramePhase::Tasks);
+    return task_queue.drain();
+}
+
 const char *CONFIG_KEY_STORE_PATH = "store_path";
+const char *CONFIG_KEY_RENDER_DIRECT = "render_direct";              // 1 to draw into the video surface, skipping the offscreen copy
+const char *CONFIG_KEY_COLOR_DEPTH = "color_depth";                  // 16 for RGB565 surfaces, otherwise 32
+const char *CONFIG_KEY_SMOOTH_SCROLL = "smooth_scroll";              // 1 to animate line scrolling
+const char *CONFIG_KEY_FRAME_STATS_OVERLAY = "frame_stats_overlay";  // 1 to show at startup, START toggles
+const char *CONFIG_KEY_FRAME_STATS_LOG = "frame_stats_log";          // per frame csv output path
+
+// Surface views draw into, and how a drawn frame reaches the display. Views
+// only redraw what changed, so the surface must keep the previous frame. That
+// rules out drawing into the back buffer of a page flipped video surface,
+// which needs the offscreen copy instead.
+class RenderTarget
+{
+    SDL_Surface *video;
+    surface_unique_ptr offscreen;  // null when drawing into video directly
+
+public:
+    RenderTarget(SDL_Surface *video, bool render_direct)
+        : video(video)
+    {
+        if (!render_direct || (video->flags & SDL_DOUBLEBUF))
+        {
+            // Only touched by the CPU, so kept in system memory
+            const SDL_PixelFormat *format = video->format;
+            offscreen = surface_unique_ptr {
+                SDL_CreateRGBSurface(
+                    SDL_SWSURFACE,
+                    SCREEN_WIDTH,
+                    SCREEN_HEIGHT,
+                    format->BitsPerPixel,
+                    format->Rmask, format->Gmask, format->Bmask, 0
+                )
+            };
+        }
+    }
+
+    SDL_Surface *surface() const
+    {
+        return offscreen ? offscreen.get() : video;
+    }
+
+    void present()
+    {
+        if (offscreen)
+        {
+            SDL_BlitSurface(offscreen.get(), NULL, video, NULL);
+        }
+        SDL_Flip(video);
+    }
+};
 
 std::unordered_map<std::string, std::string> load_config_with_defaults()
 {
@@ -188,18 +273,28 @@ int main(int argc, char **argv)
 
     std::cout << "Screen Size: " << SCREEN_WIDTH << "x" << SCREEN_HEIGHT << std::endl;
 
+    // libxml2 must be initialized before parsing on worker threads
+    xmlInitParser();
+
     // SDL Init
     SDL_Init(SDL_INIT_VIDEO);
     SDL_ShowCursor(SDL_DISABLE);
     TTF_Init();
 
-    // Surfaces
-    SDL_Surface *video = SDL_SetVideoMode(SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_HWSURFACE);
-    SDL_Surface *screen = SDL_CreateRGBSurface(SDL_HWSURFACE, SCREEN_WIDTH, SCREEN_HEIGHT, 32, 0, 0, 0, 0);
+    auto config = load_config_with_defaults();
+
+    // Surfaces. Everything drawn, including cached images, takes the video
+    // surface's format, so 16 bit color halves fill, blit and cache costs.
+    int color_depth = config[CONFIG_KEY_COLOR_DEPTH] == "16" ? 16 : 32;
+    SDL_Surface *video = SDL_SetVideoMode(SCREEN_WIDTH, SCREEN_HEIGHT, color_depth, SDL_HWSURFACE);
+    // Off unless configured: drawing into a single buffered framebuffer can
+    // show partly drawn frames, which hasn't been ruled out on the device
+    RenderTarget render_target(video, config[CONFIG_KEY_RENDER_DIRECT] == "1");
+    SDL_Surface *screen = render_target.surface();
     set_render_surface_format(screen->format);
 
-    auto config = load_config_with_defaults();
     StateStore state_store(config[CONFIG_KEY_STORE_PATH]);
+    SSDocReaderCache doc_cache(state_store);  // outlives readers, which may write to it in the background
 
     // Preload & check fonts
     auto init_font_name = get_valid_font_name(settings_get_font_name(state_store).value_or(DEFAULT_FONT_NAME));
@@ -231,7 +326,8 @@ int main(int argc, char **argv)
     // Text Styling
     TokenViewStyling token_view_styling(
         settings_get_show_title_bar(state_store).value_or(DEFAULT_SHOW_PROGRESS),
-        settings_get_progress_reporting(state_store).value_or(DEFAULT_PROGRESS_REPORTING)
+        settings_get_progress_reporting(state_store).value_or(DEFAULT_PROGRESS_REPORTING),
+        config[CONFIG_KEY_SMOOTH_SCROLL].empty() ? DEFAULT_SMOOTH_SCROLL : config[CONFIG_KEY_SMOOTH_SCROLL] == "1"
     );
     token_view_styling.subscribe_to_changes([&token_view_styling, &state_store]() {
         // Persist changes
@@ -241,6 +337,12 @@ int main(int argc, char **argv)
 
     // Setup views
     TaskQueue task_queue;
+
+    // Saved metadata is shown right away, while the scan picks up added or changed books.
+    // Released explicitly on shutdown, before the libraries its scans use.
+    auto library_catalog = std::make_unique<LibraryCatalog>(state_store, task_queue);
+    library_catalog->scan(DEFAULT_BROWSE_PATH);
+
     ViewStack view_stack;
 
     std::optional<std::filesystem::path> requested_book_path = (
@@ -249,9 +351,11 @@ int main(int argc, char **argv)
     initialize_views(
         view_stack,
         state_store,
+        doc_cache,
         sys_styling,
         token_view_styling,
         task_queue,
+        *library_catalog,
         requested_book_path
     );
     quit = view_stack.is_done();
@@ -278,26 +382,69 @@ int main(int argc, char **argv)
     SystemKeyChordTracker chord_tracker;
 
     auto key_held_callback = [&view_stack](SDLKey key, uint32_t held_ms) {
+        ScopedFrameTimer timer(FramePhase::Events);
         view_stack.on_keyheld(key, held_ms);
     };
 
+    // Frame timing instrumentation, only active when configured
+    FrameStats frame_stats;
+    std::ofstream frame_stats_log;
+    bool show_frame_stats = config[CONFIG_KEY_FRAME_STATS_OVERLAY] == "1";
+    bool frame_stats_toggled = false;
+    if (!config[CONFIG_KEY_FRAME_STATS_LOG].empty())
+    {
+        frame_stats_log.open(config[CONFIG_KEY_FRAME_STATS_LOG]);
+        if (frame_stats_log)
+        {
+            frame_stats.write_log_header(frame_stats_log);
+        }
+        else
+        {
+            std::cerr << "Unable to open frame stats log " << config[CONFIG_KEY_FRAME_STATS_LOG] << std::endl;
+        }
+    }
+    const bool frame_stats_enabled = !config[CONFIG_KEY_FRAME_STATS_OVERLAY].empty() || frame_stats_log.is_open();
+    if (frame_stats_enabled)
+    {
+        set_active_frame_stats(&frame_stats);
+    }
+
     // Timing
     Timer idle_timer;
-    FPSLimiter limit_fps(TARGET_FPS);
-    const uint32_t avg_loop_time = 1000 / TARGET_FPS;
+    Timer held_key_timer;
+    Timer animation_timer;
+
+    // Wake the main loop when background work completes
+    task_queue.set_on_completion_ready(push_wakeup_event);
 
     // Initial render
     view_stack.render(screen, true);
-    SDL_BlitSurface(screen, NULL, video, NULL);
-    SDL_Flip(video);
+    render_target.present();
 
     while (!quit)
     {
-        bool ran_user_code = task_queue.drain();
+        bool ran_user_code = drain_tasks(task_queue);
+
+        // Sleep until input arrives, background work completes, or a timer is due
+        uint32_t timeout_ms = ran_user_code ? 0 : next_timer_due_ms(held_key_tracker, held_key_timer, idle_timer);
+        if (view_stack.is_animating())
+        {
+            const uint32_t frame_ms = ANIMATION_FRAME_MS;
+            timeout_ms = std::min(timeout_ms, frame_ms - std::min(animation_timer.elapsed_ms(), frame_ms));
+        }
+
+        bool active = (
+            held_key_tracker.any_held() ||
+            view_stack.is_animating() ||
+            idle_timer.elapsed_ms() < EVENT_PUMP_ACTIVE_WINDOW_MS
+        );
 
         SDL_Event event;
-        while (SDL_PollEvent(&event))
+        bool has_event = wait_event_timeout(event, timeout_ms, active ? EVENT_PUMP_ACTIVE_MS : EVENT_PUMP_IDLE_MS);
+        while (has_event)
         {
+            ScopedFrameTimer events_timer(FramePhase::Events);
+
             switch (event.type)
             {
                 case SDL_QUIT:
@@ -313,6 +460,12 @@ int main(int argc, char **argv)
                         {
                             state_store.flush();
                         }
+                        else if (frame_stats_enabled && key == SW_BTN_START)
+                        {
+                            show_frame_stats = !show_frame_stats;
+                            frame_stats_toggled = true;
+                            ran_user_code = true;
+                        }
                         else
                         {
                             view_stack.on_keypress(key);
@@ -341,34 +494,69 @@ int main(int argc, char **argv)
                     }
                     break;
                 default:
+                    // SDL_USEREVENT wakeups are handled by draining the task queue
                     break;
             }
+
+            has_event = SDL_PollEvent(&event);
         }
 
         quit = quit || chord_tracker.exit_requested();
 
-        held_key_tracker.accumulate(avg_loop_time); // Pretend perfect loop timing for event firing consistency
+        ran_user_code = drain_tasks(task_queue) || ran_user_code;
+
+        // Cap the step so that time spent idle isn't counted towards a fresh keypress
+        held_key_tracker.accumulate(std::min(held_key_timer.elapsed_ms(), static_cast<uint32_t>(HELD_KEY_POLL_MS)));
+        held_key_timer.reset();
         ran_user_code = held_key_tracker.for_longest_held(key_held_callback) || ran_user_code;
 
+        // Animation frames are rendered like any other
+        ran_user_code = view_stack.is_animating() || ran_user_code;
+
         if (ran_user_code)
         {
-            bool force_render = view_stack.pop_completed_views();
+            animation_timer.reset();
+
+            bool force_render = view_stack.pop_completed_views() || frame_stats_toggled;
+            frame_stats_toggled = false;
 
             if (view_stack.is_done())
             {
                 quit = true;
             }
 
-            if (view_stack.render(screen, force_render))
+            bool rendered;
             {
-                SDL_BlitSurface(screen, NULL, video, NULL);
-                SDL_Flip(video);
+                ScopedFrameTimer render_timer(FramePhase::Render);
+                rendered = view_stack.render(screen, force_render);
+            }
+
+            if (rendered)
+            {
+                if (show_frame_stats)
+                {
+                    draw_frame_stats_overlay(frame_stats, screen);
+                }
+
+                ScopedFrameTimer present_timer(FramePhase::Present);
+                render_target.present();
             }
         }
 
-        if (!quit)
+        if (frame_stats_enabled)
         {
-            limit_fps();
+            if (ran_user_code)
+            {
+                const FrameTimes &times = frame_stats.end_frame();
+                if (frame_stats_log.is_open())
+                {
+                    frame_stats.write_log_row(frame_stats_log, times);
+                }
+            }
+            else
+            {
+                frame_stats.discard_frame();
+            }
         }
 
         if (idle_timer.elapsed_sec() >= IDLE_SAVE_TIME_SEC)
@@ -380,10 +568,23 @@ int main(int argc, char **argv)
         }
     }
 
+    task_queue.set_on_completion_ready(nullptr);
+
+    if (frame_stats_enabled)
+    {
+        set_active_frame_stats(nullptr);
+        frame_stats.write_summary(frame_stats_log.is_open() ? frame_stats_log : std::cout);
+    }
+
     view_stack.shutdown();
+
+    // Workers may be decoding images or parsing xml, so stop them before
+    // cleaning up SDL and libxml2. This also releases readers and surfaces
+    // held by queued work.
+    task_queue.shutdown();
+    library_catalog.reset();
     state_store.flush();
 
-    SDL_FreeSurface(screen);
     SDL_Quit();
     xmlCleanupParser();
     
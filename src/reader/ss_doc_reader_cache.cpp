@@ -7,7 +7,7 @@ SSDocReaderCache::SSDocReaderCache(StateStore &store): store(store)
 
 std::optional<std::string> SSDocReaderCache::read(const std::string &book_id, const std::string &key) const
 {
-    const auto &kv = store.get_reader_cache(book_id);
+    const auto kv = store.get_reader_cache(book_id);
     const auto it = kv.find(key);
     if (it == kv.end())
     {
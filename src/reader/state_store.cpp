@@ -1,5 +1,6 @@
 #include "./state_store.h"
 #include "util/key_value_file.h"
+#include "util/string_serialization.h"
 
 #include <fstream>
 #include <unordered_map>
@@ -10,6 +11,7 @@ namespace
 constexpr const char *ACTIVITY_KEY_BROWSER_PATH = "browser_path";
 constexpr const char *ACTIVITY_KEY_BOOK_PATH = "book_path";
 constexpr const char *ADDRESS_KEY = "address";
+constexpr const char *PROGRESS_KEY = "progress";
 
 /////////////////////////////////////
 // Activity Store
@@ -62,24 +64,39 @@ std::filesystem::path address_store_path_for_book(const std::filesystem::path &b
     return base_path / (book_id + ".address");
 }
 
-void write_book_address(const std::filesystem::path &path, const DocAddr &address)
+void write_book_address(const std::filesystem::path &path, const DocAddr &address, std::optional<uint32_t> progress_percent)
 {
     string_unordered_map kv = {
         {ADDRESS_KEY, encode_address(address)}
     };
+    if (progress_percent)
+    {
+        kv[PROGRESS_KEY] = std::to_string(*progress_percent);
+    }
 
     write_key_value(path, kv);
 }
 
-std::optional<DocAddr> load_book_address(const std::filesystem::path &path)
+std::pair<std::optional<DocAddr>, std::optional<uint32_t>> load_book_address(const std::filesystem::path &path)
 {
+    std::optional<DocAddr> address;
+    std::optional<uint32_t> progress_percent;
+
     auto kv = load_key_value(path);
-    auto it = kv.find(ADDRESS_KEY);
-    if (it == kv.end())
+
+    auto address_it = kv.find(ADDRESS_KEY);
+    if (address_it != kv.end())
+    {
+        address = decode_address(address_it->second);
+    }
+
+    auto progress_it = kv.find(PROGRESS_KEY);
+    if (progress_it != kv.end())
     {
-        return std::nullopt;
+        progress_percent = try_decode_uint(progress_it->second);
     }
-    return decode_address(it->second);
+
+    return {address, progress_percent};
 }
 
 /////////////////////////////////////
@@ -90,11 +107,20 @@ std::filesystem::path reader_cache_store_path_for_book(const std::filesystem::pa
     return base_path / (book_id + ".cache");
 }
 
+/////////////////////////////////////
+// Search Index Store
+
+std::filesystem::path search_index_store_path_for_book(const std::filesystem::path &base_path, const std::string &book_id)
+{
+    return base_path / (book_id + ".index");
+}
+
 } // namespace
 
 StateStore::StateStore(std::filesystem::path base_dir)
     : activity_store_path(base_dir / "activity"),
       book_data_root_path(base_dir / "books"),
+      library_catalog_path(base_dir / "library"),
       settings_store_path(base_dir / "settings"),
       settings(load_key_value(settings_store_path))
 {
@@ -164,15 +190,19 @@ std::optional<DocAddr> StateStore::get_book_address(const std::string &book_id)
         return it->second;
     }
 
-    auto cache = load_book_address(
+    auto [address, progress_percent] = load_book_address(
         address_store_path_for_book(book_data_root_path, book_id)
     );
-    if (cache)
+    if (address)
+    {
+        book_addresses[book_id] = *address;
+    }
+    if (progress_percent)
     {
-        book_addresses[book_id] = *cache;
+        book_progress_percents.try_emplace(book_id, *progress_percent);
     }
 
-    return cache;
+    return address;
 }
 
 void StateStore::set_book_address(const std::string &book_id, DocAddr address)
@@ -184,7 +214,31 @@ void StateStore::set_book_address(const std::string &book_id, DocAddr address)
     }
 }
 
-const string_unordered_map &StateStore::get_reader_cache(const std::string &book_id) const
+std::optional<uint32_t> StateStore::get_book_progress_percent(const std::string &book_id) const
+{
+    auto it = book_progress_percents.find(book_id);
+    if (it != book_progress_percents.end())
+    {
+        return it->second;
+    }
+
+    auto progress_percent = load_book_address(
+        address_store_path_for_book(book_data_root_path, book_id)
+    ).second;
+    if (progress_percent)
+    {
+        book_progress_percents[book_id] = *progress_percent;
+    }
+
+    return progress_percent;
+}
+
+void StateStore::set_book_progress_percent(const std::string &book_id, uint32_t progress_percent)
+{
+    book_progress_percents[book_id] = progress_percent;
+}
+
+const string_unordered_map &StateStore::locked_get_reader_cache(const std::string &book_id) const
 {
     auto it = book_reader_caches.find(book_id);
     if (it != book_reader_caches.end())
@@ -199,9 +253,16 @@ const string_unordered_map &StateStore::get_reader_cache(const std::string &book
     return book_reader_caches[book_id];
 }
 
+string_unordered_map StateStore::get_reader_cache(const std::string &book_id) const
+{
+    std::lock_guard<std::mutex> lock(reader_cache_mutex);
+    return locked_get_reader_cache(book_id);
+}
+
 void StateStore::set_reader_cache(const std::string &book_id, const string_unordered_map &new_cache)
 {
-    const auto &cur_cache = get_reader_cache(book_id);
+    std::lock_guard<std::mutex> lock(reader_cache_mutex);
+    const auto &cur_cache = locked_get_reader_cache(book_id);
 
     if (cur_cache != new_cache)
     {
@@ -210,6 +271,16 @@ void StateStore::set_reader_cache(const std::string &book_id, const string_unord
     }
 }
 
+std::filesystem::path StateStore::get_search_index_path(const std::string &book_id) const
+{
+    return search_index_store_path_for_book(book_data_root_path, book_id);
+}
+
+std::filesystem::path StateStore::get_library_catalog_path() const
+{
+    return library_catalog_path;
+}
+
 std::optional<std::string> StateStore::get_setting(const std::string &name) const
 {
     auto it = settings.find(name);
@@ -242,9 +313,11 @@ void StateStore::flush() const
     {
         for (const auto &[book_id, address] : book_addresses)
         {
+            auto progress_it = book_progress_percents.find(book_id);
             write_book_address(
                 address_store_path_for_book(book_data_root_path, book_id),
-                address
+                address,
+                progress_it != book_progress_percents.end() ? std::optional<uint32_t>(progress_it->second) : std::nullopt
             );
         }
         book_addresses.clear();
@@ -252,6 +325,7 @@ void StateStore::flush() const
 
     // book cache
     {
+        std::lock_guard<std::mutex> lock(reader_cache_mutex);
         for (const auto &book_id : reader_cache_dirty)
         {
             const auto &cache = book_reader_caches[book_id];
@@ -4,6 +4,7 @@
 #include "doc_api/doc_addr.h"
 
 #include <filesystem>
+#include <mutex>
 #include <optional>
 #include <set>
 #include <unordered_map>
@@ -22,8 +23,12 @@ class StateStore {
 
     // book addresses
     std::filesystem::path book_data_root_path;
+    mutable std::unordered_map<std::string, uint32_t> book_progress_percents; // kept after flush, for browsing
 
-    // reader cache
+    std::filesystem::path library_catalog_path;
+
+    // reader cache (may be accessed from a background thread while a book is opening)
+    mutable std::mutex reader_cache_mutex;
     mutable std::unordered_map<std::string, string_unordered_map> book_reader_caches;
     mutable std::set<std::string> reader_cache_dirty;
 
@@ -31,6 +36,8 @@ class StateStore {
     std::filesystem::path settings_store_path;
     string_unordered_map settings;
 
+    const string_unordered_map &locked_get_reader_cache(const std::string &book_id) const;
+
 public:
     StateStore(std::filesystem::path base_dir);
     virtual ~StateStore();
@@ -47,11 +54,19 @@ public:
     // book addresses
     std::optional<DocAddr> get_book_address(const std::string &book_id) const;
     void set_book_address(const std::string &book_id, DocAddr address);
+    // Saved along with the address, so set both together
+    std::optional<uint32_t> get_book_progress_percent(const std::string &book_id) const;
+    void set_book_progress_percent(const std::string &book_id, uint32_t progress_percent);
 
     // reader cache
-    const string_unordered_map &get_reader_cache(const std::string &book_id) const;
+    string_unordered_map get_reader_cache(const std::string &book_id) const;
     void set_reader_cache(const std::string &book_id, const string_unordered_map &cache);
 
+    // search index, read and written directly by the owner (not buffered until flush)
+    std::filesystem::path get_search_index_path(const std::string &book_id) const;
+    // library catalog, read and written directly by the owner
+    std::filesystem::path get_library_catalog_path() const;
+
     // generic settings
     std::optional<std::string> get_setting(const std::string &name) const;
     void set_setting(const std::string &name, const std::string &value);
@@ -0,0 +1,217 @@
+#include "reader/library_catalog.h"
+#include "reader/state_store.h"
+#include "util/task_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+namespace
+{
+
+void scan_until_done(LibraryCatalog &catalog, TaskQueue &queue, const std::filesystem::path &root)
+{
+    catalog.scan(root);
+    while (catalog.is_scanning())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        queue.drain();
+    }
+}
+
+void write_file(const std::filesystem::path &path, const std::string &contents)
+{
+    std::ofstream fp(path);
+    fp << contents;
+}
+
+struct TempDir
+{
+    std::filesystem::path path;
+
+    TempDir()
+        : path(std::filesystem::temp_directory_path() / ("library_catalog_test_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed())))
+    {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+
+    ~TempDir()
+    {
+        std::filesystem::remove_all(path);
+    }
+};
+
+} // namespace
+
+TEST(LIBRARY_CATALOG, encode_decode)
+{
+    CatalogEntry with_fields;
+    with_fields.book_id = "abc123";
+    with_fields.title = "Title\twith\\odd\nchars";
+    with_fields.author = "Author";
+    with_fields.progress_percent = 42;
+    with_fields.file_size = 5000000000ull;
+    with_fields.file_mtime = -12345;
+
+    CatalogEntry unreadable;
+    unreadable.file_size = 10;
+    unreadable.file_mtime = 20;
+
+    std::unordered_map<std::string, CatalogEntry> entries = {
+        {"/books/a.epub", with_fields},
+        {"/books/odd\tname.txt", unreadable},
+    };
+
+    std::unordered_map<std::string, CatalogEntry> decoded;
+    ASSERT_TRUE(try_decode_library_catalog(encode_library_catalog(entries), decoded));
+    ASSERT_EQ(decoded.size(), 2);
+
+    const auto &a = decoded.at("/books/a.epub");
+    EXPECT_EQ(a.book_id, with_fields.book_id);
+    EXPECT_EQ(a.title, with_fields.title);
+    EXPECT_EQ(a.author, with_fields.author);
+    EXPECT_EQ(a.progress_percent, with_fields.progress_percent);
+    EXPECT_EQ(a.file_size, with_fields.file_size);
+    EXPECT_EQ(a.file_mtime, with_fields.file_mtime);
+
+    const auto &b = decoded.at("/books/odd\tname.txt");
+    EXPECT_EQ(b.book_id, "");
+    EXPECT_EQ(b.title, "");
+    EXPECT_EQ(b.author, "");
+    EXPECT_FALSE(b.progress_percent);
+    EXPECT_EQ(b.file_size, 10);
+    EXPECT_EQ(b.file_mtime, 20);
+}
+
+TEST(LIBRARY_CATALOG, decode_invalid)
+{
+    std::unordered_map<std::string, CatalogEntry> decoded;
+    EXPECT_FALSE(try_decode_library_catalog("", decoded));
+    EXPECT_FALSE(try_decode_library_catalog("library_catalog_v0\n", decoded));
+    EXPECT_FALSE(try_decode_library_catalog("library_catalog_v1\n/a.txt\t1\t2\n", decoded));
+    EXPECT_FALSE(try_decode_library_catalog("library_catalog_v1\n/a.txt\tx\t2\t\t\t\t\n", decoded));
+    EXPECT_TRUE(try_decode_library_catalog("library_catalog_v1\n", decoded));
+    EXPECT_TRUE(decoded.empty());
+}
+
+TEST(LIBRARY_CATALOG, scan)
+{
+    TempDir dir;
+    std::filesystem::path books = dir.path / "books";
+    std::filesystem::create_directories(books / "nested");
+    std::filesystem::create_directories(books / ".hidden");
+    write_file(books / "first.txt", "hello\n");
+    write_file(books / "nested" / "second.md", "world\n");
+    write_file(books / ".hidden" / "skipped.txt", "skipped\n");
+    write_file(books / "._resource_fork.txt", "skipped\n");
+    write_file(books / "unsupported.pdf", "skipped\n");
+
+    TaskQueue queue(1);
+    {
+        StateStore store(dir.path / "store");
+        LibraryCatalog catalog(store, queue);
+
+        uint32_t num_changes = 0;
+        catalog.subscribe_to_changes([&num_changes]() { ++num_changes; });
+
+        scan_until_done(catalog, queue, books);
+        EXPECT_GT(num_changes, 0);
+
+        const CatalogEntry *first = catalog.find(books / "first.txt");
+        ASSERT_NE(first, nullptr);
+        EXPECT_EQ(first->title, "first");
+        EXPECT_FALSE(first->book_id.empty());
+        EXPECT_FALSE(first->progress_percent);
+
+        ASSERT_NE(catalog.find(books / "nested" / "second.md"), nullptr);
+        EXPECT_EQ(catalog.find(books / ".hidden" / "skipped.txt"), nullptr);
+        EXPECT_EQ(catalog.find(books / "._resource_fork.txt"), nullptr);
+        EXPECT_EQ(catalog.find(books / "unsupported.pdf"), nullptr);
+
+        // Progress is picked up from the state store on request
+        store.set_book_address(first->book_id, 0);
+        store.set_book_progress_percent(first->book_id, 30);
+        catalog.refresh_progress(books / "first.txt");
+        EXPECT_EQ(catalog.find(books / "first.txt")->progress_percent, 30);
+
+        // Unchanged rescans don't notify
+        num_changes = 0;
+        scan_until_done(catalog, queue, books);
+        EXPECT_EQ(num_changes, 0);
+
+        std::filesystem::remove(books / "nested" / "second.md");
+        write_file(books / "third.txt", "!\n");
+        scan_until_done(catalog, queue, books);
+        EXPECT_GT(num_changes, 0);
+        EXPECT_EQ(catalog.find(books / "nested" / "second.md"), nullptr);
+        ASSERT_NE(catalog.find(books / "third.txt"), nullptr);
+    }
+
+    // Saved for the next start, once the background save is done
+    while (queue.background_tasks_pending())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    {
+        StateStore store(dir.path / "store");
+        LibraryCatalog catalog(store, queue);
+
+        const CatalogEntry *first = catalog.find(books / "first.txt");
+        ASSERT_NE(first, nullptr);
+        EXPECT_EQ(first->progress_percent, 30);
+        EXPECT_NE(catalog.find(books / "third.txt"), nullptr);
+    }
+}
+
+TEST(LIBRARY_CATALOG, queued_save_written_on_destruction)
+{
+    TempDir dir;
+    std::filesystem::path books = dir.path / "books";
+    std::filesystem::create_directories(books);
+    write_file(books / "first.txt", "hello\n");
+
+    auto queue = std::make_unique<TaskQueue>(1);
+    std::atomic<bool> release_worker(false);
+    {
+        StateStore store(dir.path / "store");
+        LibraryCatalog catalog(store, *queue);
+        scan_until_done(catalog, *queue, books);
+
+        // Keep the save queued behind a busy worker, so it's dropped on shutdown
+        queue->submit_background([&release_worker]() {
+            while (!release_worker)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        const CatalogEntry *first = catalog.find(books / "first.txt");
+        ASSERT_NE(first, nullptr);
+        store.set_book_address(first->book_id, 0);
+        store.set_book_progress_percent(first->book_id, 55);
+        catalog.refresh_progress(books / "first.txt");
+    }
+
+    // Shut down as the app does, with the catalog gone first
+    std::thread releaser([&release_worker]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release_worker = true;
+    });
+    queue.reset();
+    releaser.join();
+
+    TaskQueue next_queue(1);
+    {
+        StateStore store(dir.path / "store");
+        LibraryCatalog catalog(store, next_queue);
+
+        const CatalogEntry *first = catalog.find(books / "first.txt");
+        ASSERT_NE(first, nullptr);
+        EXPECT_EQ(first->progress_percent, 55);
+    }
+}
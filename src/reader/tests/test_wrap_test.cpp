@@ -1,4 +1,5 @@
 #include "reader/text_wrap.h"
+#include "util/alloc_stats.h"
 
 #include <gtest/gtest.h>
 
@@ -132,3 +133,34 @@ TEST(TEXT_WRAP, limit_mac_char_len)
         (std::vector<std::string>{"123", "45", "789", "ABC", "D"})
     );
 }
+
+TEST(TEXT_WRAP, allocation_budget)
+{
+    if (!alloc_tracking_enabled())
+    {
+        GTEST_SKIP() << "Built without ALLOC_TRACKING";
+    }
+
+    std::string paragraph;
+    for (int i = 0; i < 200; ++i)
+    {
+        paragraph += "word ";
+    }
+
+    // Wrapping itself shouldn't allocate per line, only the callbacks may
+    uint32_t num_lines = 0;
+    reset_alloc_site_counts();
+    wrap_lines(
+        paragraph.c_str(),
+        fits_on_line_by_char,
+        [&num_lines](const char *, uint32_t) {
+            ++num_lines;
+        },
+        100
+    );
+
+    AllocSiteCounts counts = get_alloc_site_counts(AllocSite::WrapLines);
+    ASSERT_GT(num_lines, 50);
+    ASSERT_EQ(counts.calls, 1);
+    ASSERT_EQ(counts.allocations, 0);
+}
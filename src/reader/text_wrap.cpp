@@ -1,5 +1,6 @@
 #include "./text_wrap.h"
 
+#include "util/alloc_stats.h"
 #include "util/str_utils.h"
 #include "util/utf8.h"
 
@@ -79,6 +80,8 @@ void wrap_lines(
     uint32_t max_line_search_chars
 )
 {
+    ScopedAllocCounter alloc_counter(AllocSite::WrapLines);
+
     uint32_t n = strlen(str);
     if (n == 0)
     {
@@ -16,6 +16,9 @@ public:
     // If true, the stack will always re-render the view behind this view.
     virtual bool is_modal() { return false; }
 
+    // If true, render is called every animation frame, even without input.
+    virtual bool is_animating() { return false; }
+
     // Key down event.
     virtual void on_keypress(SDLKey key) = 0;
 
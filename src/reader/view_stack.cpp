@@ -51,6 +51,11 @@ bool ViewStack::is_done()
     return views.empty();
 }
 
+bool ViewStack::is_animating()
+{
+    return !views.empty() && views.back()->is_animating();
+}
+
 void ViewStack::on_keypress(SDLKey key)
 {
     if (!views.empty())
@@ -16,6 +16,7 @@ public:
 
     bool render(SDL_Surface *dest, bool force_render) override;
     bool is_done() override;
+    bool is_animating() override;
 
     void on_keypress(SDLKey key) override;
     void on_keyheld(SDLKey key, uint32_t hold_time_ms) override;
@@ -2,11 +2,13 @@
 
 #include "./selection_menu.h"
 #include "filetypes/open_doc.h"
+#include "reader/library_catalog.h"
 #include "reader/system_styling.h"
 #include "sys/filesystem.h"
 
 #include <filesystem>
 #include <iostream>
+#include <optional>
 #include <vector>
 
 struct FSState
@@ -17,10 +19,18 @@ struct FSState
     std::function<void(const std::filesystem::path &)> on_file_focus;
     std::function<void()> on_view_focus;
 
+    LibraryCatalog *library_catalog;
+    uint32_t catalog_sub_id = 0;
+    bool labels_stale = false;
+
+    // Last book opened, whose progress may have changed when returning here
+    std::optional<std::filesystem::path> opened_path;
+
     SelectionMenu menu;
 
-    FSState(std::filesystem::path path, SystemStyling &styling)
+    FSState(std::filesystem::path path, SystemStyling &styling, LibraryCatalog *library_catalog)
         : path(path),
+          library_catalog(library_catalog),
           menu(styling)
     {
     }
@@ -28,6 +38,54 @@ struct FSState
 
 namespace {
 
+std::string entry_label(const FSState *s, const FSEntry &entry)
+{
+    if (entry.is_dir || !s->library_catalog)
+    {
+        return entry.name;
+    }
+
+    const CatalogEntry *book = s->library_catalog->find(s->path / entry.name);
+    if (!book || book->title.empty())
+    {
+        return entry.name;
+    }
+
+    std::string label = book->title;
+    if (!book->author.empty())
+    {
+        label += " - " + book->author;
+    }
+    if (book->progress_percent)
+    {
+        label += " (" + std::to_string(*book->progress_percent) + "%)";
+    }
+    return label;
+}
+
+std::vector<std::string> entry_labels(const FSState *s)
+{
+    std::vector<std::string> labels;
+    for (const auto &entry : s->path_entries)
+    {
+        labels.push_back(entry_label(s, entry));
+    }
+    return labels;
+}
+
+// Labels may not match names, so find entries by name
+void set_cursor_to_entry(FSState *s, const std::string &name)
+{
+    for (uint32_t i = 0; i < s->path_entries.size(); ++i)
+    {
+        if (s->path_entries[i].name == name)
+        {
+            s->menu.set_cursor_pos(i);
+            break;
+        }
+    }
+}
+
 void refresh_path_entries(FSState *s)
 {
     s->path_entries.clear();
@@ -42,12 +100,8 @@ void refresh_path_entries(FSState *s)
         }
     }
 
-    std::vector<std::string> menu_entries;
-    for (const auto &entry : s->path_entries)
-    {
-        menu_entries.push_back(entry.name);
-    }
-    s->menu.set_entries(menu_entries);
+    s->menu.set_entries(entry_labels(s));
+    s->labels_stale = false;
 }
 
 void on_menu_entry_selected(FSState *s, uint32_t menu_index)
@@ -66,7 +120,7 @@ void on_menu_entry_selected(FSState *s, uint32_t menu_index)
 
             s->path = s->path.parent_path();
             refresh_path_entries(s);
-            s->menu.set_cursor_pos(highlight_name);
+            set_cursor_to_entry(s, highlight_name);
         }
         else
         {
@@ -78,6 +132,7 @@ void on_menu_entry_selected(FSState *s, uint32_t menu_index)
     }
     else
     {
+        s->opened_path = s->path / entry.name;
         if (s->on_file_selected)
         {
             s->on_file_selected(s->path / entry.name);
@@ -124,10 +179,11 @@ std::filesystem::path sanitize_starting_path(std::filesystem::path path)
 
 } // namespace
 
-FileSelector::FileSelector(std::filesystem::path path, SystemStyling &styling)
+FileSelector::FileSelector(std::filesystem::path path, SystemStyling &styling, LibraryCatalog *library_catalog)
     : state(std::make_unique<FSState>(
           sanitize_starting_path(path),
-          styling
+          styling,
+          library_catalog
       ))
 {
     state->menu.set_on_selection([this](uint32_t menu_index) {
@@ -138,10 +194,18 @@ FileSelector::FileSelector(std::filesystem::path path, SystemStyling &styling)
         on_menu_entry_focused(this->state.get(), menu_index);
     });
 
+    if (library_catalog)
+    {
+        // Relabel on the next render, as a scan may update many entries at once
+        state->catalog_sub_id = library_catalog->subscribe_to_changes([this]() {
+            state->labels_stale = true;
+        });
+    }
+
     refresh_path_entries(state.get());
     if (path.has_filename())
     {
-        state->menu.set_cursor_pos(path.filename());
+        set_cursor_to_entry(state.get(), path.filename());
     }
     else
     {
@@ -151,10 +215,20 @@ FileSelector::FileSelector(std::filesystem::path path, SystemStyling &styling)
 
 FileSelector::~FileSelector()
 {
+    if (state->library_catalog)
+    {
+        state->library_catalog->unsubscribe_from_changes(state->catalog_sub_id);
+    }
 }
 
 bool FileSelector::render(SDL_Surface *dest_surface, bool force_render)
 {
+    if (state->labels_stale)
+    {
+        state->menu.replace_entries(entry_labels(state.get()));
+        state->labels_stale = false;
+    }
+
     return state->menu.render(dest_surface, force_render);
 }
 
@@ -175,6 +249,11 @@ void FileSelector::on_keyheld(SDLKey key, uint32_t held_time_ms)
 
 void FileSelector::on_focus()
 {
+    if (state->library_catalog && state->opened_path)
+    {
+        state->library_catalog->refresh_progress(*state->opened_path);
+    }
+
     if (state->on_view_focus)
     {
         state->on_view_focus();
@@ -11,6 +11,7 @@
 #include <string>
 
 struct FSState;
+struct LibraryCatalog;
 struct SystemStyling;
 
 class FileSelector: public View
@@ -19,7 +20,8 @@ class FileSelector: public View
 
 public:
     // Expects to receive a path to a file, or directory with trailing separator.
-    FileSelector(std::filesystem::path path, SystemStyling &styling);
+    // Books are labeled with their title and progress from the catalog, if given.
+    FileSelector(std::filesystem::path path, SystemStyling &styling, LibraryCatalog *library_catalog = nullptr);
     virtual ~FileSelector();
 
     bool render(SDL_Surface *dest_surface, bool force_render) override;
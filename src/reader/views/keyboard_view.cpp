@@ -0,0 +1,260 @@
+#include "./keyboard_view.h"
+
+#include "reader/system_styling.h"
+#include "sys/keymap.h"
+#include "sys/screen.h"
+#include "util/sdl_utils.h"
+
+#include <algorithm>
+
+namespace
+{
+
+constexpr const char *KEY_SPACE = "Space";
+constexpr const char *KEY_DELETE = "Del";
+constexpr const char *KEY_DONE = "Done";
+
+const std::vector<std::vector<std::string>> KEY_ROWS = {
+    {"1", "2", "3", "4", "5", "6", "7", "8", "9", "0"},
+    {"q", "w", "e", "r", "t", "y", "u", "i", "o", "p"},
+    {"a", "s", "d", "f", "g", "h", "j", "k", "l", "'"},
+    {"z", "x", "c", "v", "b", "n", "m", ",", ".", "-"},
+    {KEY_SPACE, KEY_DELETE, KEY_DONE},
+};
+
+constexpr int LINE_PADDING = 4;
+constexpr uint32_t MAX_TEXT_LENGTH = 64;
+
+void blit_centered(SDL_Surface *text, const SDL_Rect &cell, SDL_Surface *dest_surface)
+{
+    SDL_Rect rect = {
+        static_cast<Sint16>(cell.x + (cell.w - text->w) / 2),
+        static_cast<Sint16>(cell.y + (cell.h - text->h) / 2),
+        0,
+        0
+    };
+    SDL_BlitSurface(text, NULL, dest_surface, &rect);
+}
+
+} // namespace
+
+KeyboardView::KeyboardView(const std::string &prompt, SystemStyling &styling)
+    : prompt(prompt),
+      styling(styling),
+      styling_sub_id(styling.subscribe_to_changes([this](SystemStyling::ChangeId) {
+          needs_render = true;
+      })),
+      move_throttle(250, 100)
+{
+}
+
+KeyboardView::~KeyboardView()
+{
+    styling.unsubscribe_from_changes(styling_sub_id);
+}
+
+void KeyboardView::set_on_submit(std::function<void(const std::string &)> callback)
+{
+    on_submit = callback;
+}
+
+void KeyboardView::close()
+{
+    _is_done = true;
+}
+
+void KeyboardView::move_cursor(int d_row, int d_col)
+{
+    int num_rows = KEY_ROWS.size();
+
+    if (d_row)
+    {
+        // Keep roughly the same horizontal position between rows of different lengths
+        uint32_t old_len = KEY_ROWS[cursor_row].size();
+        cursor_row = (cursor_row + num_rows + d_row) % num_rows;
+        uint32_t new_len = KEY_ROWS[cursor_row].size();
+        cursor_col = (cursor_col * new_len + new_len / 2) / old_len;
+        cursor_col = std::min(cursor_col, new_len - 1);
+    }
+
+    if (d_col)
+    {
+        int row_len = KEY_ROWS[cursor_row].size();
+        cursor_col = (cursor_col + row_len + d_col) % row_len;
+    }
+
+    needs_render = true;
+}
+
+void KeyboardView::press_key()
+{
+    const std::string &key = KEY_ROWS[cursor_row][cursor_col];
+    if (key == KEY_DONE)
+    {
+        submit();
+    }
+    else if (key == KEY_DELETE)
+    {
+        delete_char();
+    }
+    else if (text.size() < MAX_TEXT_LENGTH)
+    {
+        text += (key == KEY_SPACE) ? " " : key;
+        needs_render = true;
+    }
+}
+
+void KeyboardView::delete_char()
+{
+    if (!text.empty())
+    {
+        text.pop_back();
+        needs_render = true;
+    }
+}
+
+void KeyboardView::submit()
+{
+    if (on_submit && !text.empty())
+    {
+        on_submit(text);
+    }
+}
+
+bool KeyboardView::render(SDL_Surface *dest_surface, bool force_render)
+{
+    if (!needs_render && !force_render)
+    {
+        return false;
+    }
+    needs_render = false;
+
+    TTF_Font *font = styling.get_loaded_font();
+    const auto &theme = styling.get_loaded_color_theme();
+    const SDL_PixelFormat *pixel_format = dest_surface->format;
+
+    uint32_t bg_color = SDL_MapRGB(pixel_format, theme.background.r, theme.background.g, theme.background.b);
+    uint32_t hl_color = SDL_MapRGB(pixel_format, theme.highlight_background.r, theme.highlight_background.g, theme.highlight_background.b);
+
+    SDL_Rect screen_rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+    SDL_FillRect(dest_surface, &screen_rect, bg_color);
+
+    int line_height = detect_line_height(font) + LINE_PADDING;
+
+    // Entered text, keeping the end visible when too long for the screen
+    {
+        std::string line = prompt + text + "_";
+        auto message = surface_unique_ptr { TTF_RenderUTF8_Shaded(
+            font,
+            line.c_str(),
+            theme.main_text,
+            theme.background
+        ) };
+
+        SDL_Rect src_rect = {
+            static_cast<Sint16>(std::max(0, message->w - (SCREEN_WIDTH - LINE_PADDING * 2))),
+            0,
+            static_cast<Uint16>(message->w),
+            static_cast<Uint16>(message->h)
+        };
+        SDL_Rect dest_rect = {LINE_PADDING, LINE_PADDING, 0, 0};
+        SDL_BlitSurface(message.get(), &src_rect, dest_surface, &dest_rect);
+    }
+
+    // Keys fill the bottom of the screen
+    int num_rows = KEY_ROWS.size();
+    int row_height = std::min(line_height * 2, (SCREEN_HEIGHT - line_height - LINE_PADDING * 2) / num_rows);
+    int y = SCREEN_HEIGHT - row_height * num_rows;
+
+    for (int row = 0; row < num_rows; ++row)
+    {
+        const auto &keys = KEY_ROWS[row];
+        int cell_width = SCREEN_WIDTH / keys.size();
+
+        for (uint32_t col = 0; col < keys.size(); ++col)
+        {
+            bool is_highlighted = (static_cast<uint32_t>(row) == cursor_row && col == cursor_col);
+
+            SDL_Rect cell = {
+                static_cast<Sint16>(col * cell_width),
+                static_cast<Sint16>(y),
+                static_cast<Uint16>(cell_width),
+                static_cast<Uint16>(row_height)
+            };
+            if (is_highlighted)
+            {
+                SDL_FillRect(dest_surface, &cell, hl_color);
+            }
+
+            auto label = surface_unique_ptr { TTF_RenderUTF8_Shaded(
+                font,
+                keys[col].c_str(),
+                is_highlighted ? theme.highlight_text : theme.secondary_text,
+                is_highlighted ? theme.highlight_background : theme.background
+            ) };
+            blit_centered(label.get(), cell, dest_surface);
+        }
+
+        y += row_height;
+    }
+
+    return true;
+}
+
+bool KeyboardView::is_done()
+{
+    return _is_done;
+}
+
+void KeyboardView::on_keypress(SDLKey key)
+{
+    switch (key) {
+        case SW_BTN_UP:
+            move_cursor(-1, 0);
+            break;
+        case SW_BTN_DOWN:
+            move_cursor(1, 0);
+            break;
+        case SW_BTN_LEFT:
+            move_cursor(0, -1);
+            break;
+        case SW_BTN_RIGHT:
+            move_cursor(0, 1);
+            break;
+        case SW_BTN_A:
+            press_key();
+            break;
+        case SW_BTN_B:
+            if (text.empty())
+            {
+                _is_done = true;
+            }
+            else
+            {
+                delete_char();
+            }
+            break;
+        case SW_BTN_START:
+            submit();
+            break;
+        default:
+            break;
+    }
+}
+
+void KeyboardView::on_keyheld(SDLKey key, uint32_t held_time_ms)
+{
+    switch (key) {
+        case SW_BTN_UP:
+        case SW_BTN_DOWN:
+        case SW_BTN_LEFT:
+        case SW_BTN_RIGHT:
+            if (move_throttle(held_time_ms))
+            {
+                on_keypress(key);
+            }
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef KEYBOARD_VIEW_H_
+#define KEYBOARD_VIEW_H_
+
+#include "reader/view.h"
+#include "util/throttled.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+struct SystemStyling;
+
+// On-screen keyboard for entering a line of text with the d-pad.
+// A types the highlighted key, B deletes (or closes when empty), START submits.
+class KeyboardView: public View
+{
+    bool needs_render = true;
+    bool _is_done = false;
+
+    std::string prompt;
+    std::string text;
+
+    uint32_t cursor_row = 1;  // first row of letters
+    uint32_t cursor_col = 0;
+
+    SystemStyling &styling;
+    const uint32_t styling_sub_id;
+
+    Throttled move_throttle;
+
+    std::function<void(const std::string &)> on_submit;
+
+    void move_cursor(int d_row, int d_col);
+    void press_key();
+    void delete_char();
+    void submit();
+
+public:
+    KeyboardView(const std::string &prompt, SystemStyling &styling);
+    virtual ~KeyboardView();
+
+    // Called with the entered text. The keyboard stays open until closed.
+    void set_on_submit(std::function<void(const std::string &)> callback);
+    void close();
+
+    bool render(SDL_Surface *dest_surface, bool force_render) override;
+    bool is_done() override;
+    void on_keypress(SDLKey key) override;
+    void on_keyheld(SDLKey key, uint32_t held_time_ms) override;
+};
+
+#endif
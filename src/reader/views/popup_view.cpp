@@ -3,6 +3,7 @@
 #include "reader/draw_modal_border.h"
 #include "reader/system_styling.h"
 #include "sys/screen.h"
+#include "util/glyph_atlas.h"
 #include "util/sdl_font_cache.h"
 #include "util/sdl_utils.h"
 
@@ -31,27 +32,23 @@ bool PopupView::render(SDL_Surface *dest_surface, bool force_render)
     TTF_Font *font = cached_load_font(font_name, styling.get_font_size());
     const auto &theme = styling.get_loaded_color_theme();
 
-    auto text = surface_unique_ptr { TTF_RenderUTF8_Shaded(
-        font,
-        message.c_str(),
-        theme.main_text,
-        theme.background
-    ) };
+    GlyphAtlas &atlas = cached_glyph_atlas(font, theme.main_text, theme.background);
+    int text_w = atlas.get_text_width(message.c_str());
+    int text_h = atlas.get_height();
 
     draw_modal_border(
-        text->w,
-        text->h,
+        text_w,
+        text_h,
         styling.get_loaded_color_theme(),
         dest_surface
     );
 
-    SDL_Rect rect = {
-        static_cast<Sint16>(SCREEN_WIDTH / 2 - text->w / 2),
-        static_cast<Sint16>(SCREEN_HEIGHT / 2 - text->h / 2),
-        0,
-        0
-    };
-    SDL_BlitSurface(text.get(), NULL, dest_surface, &rect);
+    atlas.render(
+        message.c_str(),
+        dest_surface,
+        SCREEN_WIDTH / 2 - text_w / 2,
+        SCREEN_HEIGHT / 2 - text_h / 2
+    );
 
     _needs_render = false;
 
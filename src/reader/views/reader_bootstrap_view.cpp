@@ -3,15 +3,36 @@
 #include "./popup_view.h"
 #include "./reader_view.h"
 #include "filetypes/open_doc.h"
+#include "reader/book_search.h"
 #include "reader/config.h"
-#include "reader/ss_doc_reader_cache.h"
+#include "reader/draw_modal_border.h"
 #include "reader/state_store.h"
 #include "reader/system_styling.h"
 #include "reader/view_stack.h"
+#include "sys/keymap.h"
 #include "sys/screen.h"
+#include "util/sdl_font_cache.h"
+#include "util/sdl_pointer.h"
+#include "util/task_queue.h"
 
+#include <atomic>
 #include <iostream>
 
+namespace
+{
+
+// Shared between the UI thread and the worker performing the open
+struct OpenJob
+{
+    std::shared_ptr<DocReader> reader;
+    bool success = false;
+
+    // Percent of open completed, or -1 if no progress reported
+    std::atomic<int> progress_percent {-1};
+};
+
+} // namespace
+
 struct ReaderBootstrapViewState
 {
     std::filesystem::path book_path;
@@ -19,27 +40,38 @@ struct ReaderBootstrapViewState
     TokenViewStyling &token_view_styling;
     ViewStack &view_stack;
     StateStore &state_store;
+    DocReaderCache &doc_cache;
+    TaskQueue &task_queue;
+
+    std::shared_ptr<OpenJob> job;
+    CancelToken cancel_token;
 
     bool is_done = false;
     bool needs_render = true;
+    int rendered_progress_percent = -1;
 
     ReaderBootstrapViewState(
         std::filesystem::path book_path,
         SystemStyling &sys_styling,
         TokenViewStyling &token_view_styling,
         ViewStack &view_stack,
-        StateStore &state_store
+        StateStore &state_store,
+        DocReaderCache &doc_cache,
+        TaskQueue &task_queue
     ) :
         book_path(book_path),
         sys_styling(sys_styling),
         token_view_styling(token_view_styling),
         view_stack(view_stack),
-        state_store(state_store)
+        state_store(state_store),
+        doc_cache(doc_cache),
+        task_queue(task_queue),
+        job(std::make_shared<OpenJob>())
     {
     }
 };
 
-void ReaderBootstrapView::load_reader()
+void ReaderBootstrapView::on_reader_loaded()
 {
     state->is_done = true;
 
@@ -49,9 +81,8 @@ void ReaderBootstrapView::load_reader()
     auto &view_stack = state->view_stack;
     auto &state_store = state->state_store;
 
-    std::shared_ptr<DocReader> reader = create_doc_reader(book_path);
-    SSDocReaderCache cache(state_store);
-    if (!reader || !reader->open(cache))
+    std::shared_ptr<DocReader> reader = state->job->reader;
+    if (!state->job->success)
     {
         std::cerr << "Failed to open " << book_path << std::endl;
         view_stack.push(std::make_shared<PopupView>("Error opening", SYSTEM_FONT, sys_styling));
@@ -61,17 +92,27 @@ void ReaderBootstrapView::load_reader()
     state_store.set_current_book_path(book_path);
 
     auto book_id = reader->get_id();
+    auto book_search = std::make_shared<BookSearch>(
+        book_path,
+        book_id,
+        state_store,
+        state->doc_cache,
+        state->task_queue
+    );
     auto reader_view = std::make_shared<ReaderView>(
         book_path,
         reader,
+        book_search,
         state_store.get_book_address(book_id).value_or(0),
         sys_styling,
         token_view_styling,
-        view_stack
+        view_stack,
+        state->task_queue
     );
 
-    reader_view->set_on_change_address([&state_store, book_id](DocAddr addr) {
+    reader_view->set_on_change_address([&state_store, book_id, reader](DocAddr addr) {
         state_store.set_book_address(book_id, addr);
+        state_store.set_book_progress_percent(book_id, reader->get_global_progress_percent(addr));
     });
 
     view_stack.push(reader_view);
@@ -83,24 +124,51 @@ ReaderBootstrapView::ReaderBootstrapView(
     TokenViewStyling &token_view_styling,
     ViewStack &view_stack,
     StateStore &state_store,
-    std::function<void(std::function<void()>)> async
-) : state(std::make_unique<ReaderBootstrapViewState>(book_path, sys_styling, token_view_styling, view_stack, state_store))
+    DocReaderCache &doc_cache,
+    TaskQueue &task_queue
+) : state(std::make_unique<ReaderBootstrapViewState>(book_path, sys_styling, token_view_styling, view_stack, state_store, doc_cache, task_queue))
 {
-    // Perform asynchronously so that rendering can continue
-    async([this](){ load_reader(); });
+    // Open on a worker so that input and rendering can continue
+    auto job = state->job;
+    auto token = state->cancel_token;
+    task_queue.submit_background(
+        [job, token, book_path, &doc_cache, &task_queue]() {
+            job->reader = create_doc_reader(book_path);
+            if (!job->reader)
+            {
+                return;
+            }
+
+            job->success = job->reader->open(doc_cache, [job, token, &task_queue](uint32_t done, uint32_t total) {
+                int percent = total ? done * 100 / total : 0;
+                if (percent != job->progress_percent.exchange(percent))
+                {
+                    task_queue.post([]() {});  // wake main loop to re-render
+                }
+                return !token.is_cancelled();
+            });
+        },
+        [this]() { on_reader_loaded(); },
+        TaskPriority::High,
+        token
+    );
 }
 
 ReaderBootstrapView::~ReaderBootstrapView()
 {
+    state->cancel_token.cancel();
 }
 
 bool ReaderBootstrapView::render(SDL_Surface *dest_surface, bool force_render)
 {
-    bool perform_render = force_render || state->needs_render;
+    int progress_percent = state->job->progress_percent.load();
+
+    bool perform_render = force_render || state->needs_render || progress_percent != state->rendered_progress_percent;
     if (perform_render)
     {
         // blank screen during loading
-        const auto &bg_color = state->sys_styling.get_loaded_color_theme().background;
+        const auto &theme = state->sys_styling.get_loaded_color_theme();
+        const auto &bg_color = theme.background;
 
         SDL_Rect rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
         uint32_t surf_color = SDL_MapRGB(
@@ -111,6 +179,31 @@ bool ReaderBootstrapView::render(SDL_Surface *dest_surface, bool force_render)
         );
         SDL_FillRect(dest_surface, &rect, surf_color);
 
+        // Only slow (uncached) opens report progress
+        if (progress_percent >= 0)
+        {
+            std::string message = "Opening " + std::to_string(progress_percent) + "% (B to cancel)";
+
+            TTF_Font *font = cached_load_font(SYSTEM_FONT, state->sys_styling.get_font_size());
+            auto text = surface_unique_ptr { TTF_RenderUTF8_Shaded(
+                font,
+                message.c_str(),
+                theme.main_text,
+                theme.background
+            ) };
+
+            draw_modal_border(text->w, text->h, theme, dest_surface);
+
+            SDL_Rect text_rect = {
+                static_cast<Sint16>(SCREEN_WIDTH / 2 - text->w / 2),
+                static_cast<Sint16>(SCREEN_HEIGHT / 2 - text->h / 2),
+                0,
+                0
+            };
+            SDL_BlitSurface(text.get(), NULL, dest_surface, &text_rect);
+        }
+
+        state->rendered_progress_percent = progress_percent;
         state->needs_render = false;
     }
 
@@ -122,6 +215,16 @@ bool ReaderBootstrapView::is_done()
     return state->is_done;
 }
 
-void ReaderBootstrapView::on_keypress(SDLKey)
+void ReaderBootstrapView::on_keypress(SDLKey key)
+{
+    if (key == SW_BTN_B)
+    {
+        state->cancel_token.cancel();
+        state->is_done = true;
+    }
+}
+
+void ReaderBootstrapView::on_pop()
 {
+    state->cancel_token.cancel();
 }
@@ -4,22 +4,25 @@
 #include "doc_api/doc_addr.h"
 #include "reader/view.h"
 
+struct DocReaderCache;
 struct ReaderBootstrapViewState;
 struct SystemStyling;
 struct TokenViewStyling;
 struct ViewStack;
 struct StateStore;
+struct TaskQueue;
 
 #include <filesystem>
 #include <functional>
 #include <memory>
 
-// Temporary view to open a book and display loading/error message
+// Temporary view to open a book in the background and display loading/error message.
+// Pushes a ReaderView once the book is ready. Back button abandons the open.
 class ReaderBootstrapView: public View
 {
     std::unique_ptr<ReaderBootstrapViewState> state;
 
-    void load_reader();
+    void on_reader_loaded();
 
 public:
     ReaderBootstrapView(
@@ -28,13 +31,15 @@ public:
         TokenViewStyling &token_view_styling,
         ViewStack &view_stack,
         StateStore &state_store,
-        std::function<void(std::function<void()>)> async
+        DocReaderCache &doc_cache,
+        TaskQueue &task_queue
     );
     virtual ~ReaderBootstrapView();
 
     bool render(SDL_Surface *dest_surface, bool force_render) override;
     bool is_done() override;
     void on_keypress(SDLKey) override;
+    void on_pop() override;
 };
 
 #endif
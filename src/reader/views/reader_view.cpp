@@ -1,9 +1,13 @@
 #include "./reader_view.h"
 
+#include "./keyboard_view.h"
+#include "./popup_view.h"
 #include "./selection_menu.h"
 #include "./token_view/token_view.h"
 #include "./token_view/token_view_styling.h"
 
+#include "reader/book_search.h"
+#include "reader/config.h"
 #include "reader/system_styling.h"
 #include "reader/view_stack.h"
 
@@ -22,6 +26,7 @@ struct ReaderViewState
 
     std::string filename;
     std::shared_ptr<DocReader> reader;
+    std::shared_ptr<BookSearch> book_search;  // null if search isn't supported
     SystemStyling &sys_styling;
     TokenViewStyling &token_view_styling;
     uint32_t token_view_styling_sub_id;
@@ -30,9 +35,10 @@ struct ReaderViewState
 
     std::unique_ptr<TokenView> token_view;
     
-    ReaderViewState(std::filesystem::path path, DocAddr seek_address, std::shared_ptr<DocReader> reader, SystemStyling &sys_styling, TokenViewStyling &token_view_styling, uint32_t token_view_styling_sub_id, ViewStack &view_stack)
+    ReaderViewState(std::filesystem::path path, DocAddr seek_address, std::shared_ptr<DocReader> reader, std::shared_ptr<BookSearch> book_search, SystemStyling &sys_styling, TokenViewStyling &token_view_styling, uint32_t token_view_styling_sub_id, ViewStack &view_stack, TaskQueue &task_queue)
         : filename(path.filename()),
           reader(reader),
+          book_search(book_search),
           sys_styling(sys_styling),
           token_view_styling(token_view_styling),
           token_view_styling_sub_id(token_view_styling_sub_id),
@@ -41,7 +47,8 @@ struct ReaderViewState
               reader,
               seek_address,
               sys_styling,
-              token_view_styling
+              token_view_styling,
+              task_queue
           ))
     {
     }
@@ -109,25 +116,157 @@ void open_toc_menu(ReaderView &reader_view, ReaderViewState &state)
     state.view_stack.push(toc_select_menu);
 }
 
+std::string search_result_label(const ReaderViewState &state, DocAddr address)
+{
+    // Label results by chapter and book position
+    const auto &toc = state.reader->get_table_of_contents();
+    auto toc_index = state.reader->get_toc_position(address).toc_index;
+    const std::string &name = toc_index < toc.size() ? toc[toc_index].display_name : state.filename;
+
+    return name + " (" + std::to_string(state.reader->get_global_progress_percent(address)) + "%)";
+}
+
+// Until the index is ready, stream in results as the book is searched
+void show_unindexed_search_results(ReaderView &reader_view, ReaderViewState &state, std::shared_ptr<KeyboardView> keyboard, const std::string &query)
+{
+    auto results = std::make_shared<std::vector<DocAddr>>();
+    auto results_menu = std::make_shared<SelectionMenu>(std::vector<std::string>{"Searching..."}, state.sys_styling);
+
+    results_menu->set_on_selection([&reader_view, keyboard, results, weak_menu=std::weak_ptr<SelectionMenu>(results_menu)](uint32_t result_index) {
+        // Ignore the status line shown before any results
+        if (result_index < results->size())
+        {
+            reader_view.seek_to_address((*results)[result_index]);
+            keyboard->close();
+            if (auto menu = weak_menu.lock())
+            {
+                menu->close();
+            }
+        }
+    });
+
+    state.book_search->find_unindexed(
+        query,
+        SEARCH_MAX_RESULTS,
+        [&state, results, weak_menu=std::weak_ptr<SelectionMenu>(results_menu)](const std::vector<DocAddr> &found) {
+            auto menu = weak_menu.lock();
+            if (!menu || menu->is_done())
+            {
+                return false;
+            }
+            if (found.empty())
+            {
+                return true;
+            }
+
+            std::vector<std::string> labels;
+            for (DocAddr address : found)
+            {
+                labels.push_back(search_result_label(state, address));
+            }
+
+            if (results->empty())
+            {
+                menu->set_entries(labels);
+            }
+            else
+            {
+                menu->append_entries(labels);
+            }
+            results->insert(results->end(), found.begin(), found.end());
+            return true;
+        },
+        [results, weak_menu=std::weak_ptr<SelectionMenu>(results_menu)]() {
+            auto menu = weak_menu.lock();
+            if (menu && results->empty())
+            {
+                menu->set_entries({"No matches"});
+            }
+        }
+    );
+
+    state.view_stack.push(results_menu);
+}
+
+void show_search_results(ReaderView &reader_view, ReaderViewState &state, std::shared_ptr<KeyboardView> keyboard, const std::string &query)
+{
+    auto &book_search = *state.book_search;
+    if (book_search.has_failed())
+    {
+        state.view_stack.push(std::make_shared<PopupView>("Search unavailable", SYSTEM_FONT, state.sys_styling));
+        return;
+    }
+    if (!book_search.is_ready())
+    {
+        show_unindexed_search_results(reader_view, state, keyboard, query);
+        return;
+    }
+
+    std::vector<DocAddr> results = book_search.find(query, SEARCH_MAX_RESULTS);
+    if (results.empty())
+    {
+        state.view_stack.push(std::make_shared<PopupView>("No matches", SYSTEM_FONT, state.sys_styling));
+        return;
+    }
+
+    std::vector<std::string> menu_names;
+    for (DocAddr address : results)
+    {
+        menu_names.push_back(search_result_label(state, address));
+    }
+
+    auto results_menu = std::make_shared<SelectionMenu>(menu_names, state.sys_styling);
+    results_menu->set_on_selection([&reader_view, keyboard, results](uint32_t result_index) {
+        reader_view.seek_to_address(results[result_index]);
+        keyboard->close();
+    });
+    results_menu->set_close_on_select();
+
+    state.view_stack.push(results_menu);
+}
+
+void open_search(ReaderView &reader_view, ReaderViewState &state)
+{
+    if (!state.book_search)
+    {
+        return;
+    }
+
+    // Keyboard stays under the results, so backing out allows refining the query
+    auto keyboard = std::make_shared<KeyboardView>("Search: ", state.sys_styling);
+    keyboard->set_on_submit([&reader_view, &state, weak_keyboard=std::weak_ptr<KeyboardView>(keyboard)](const std::string &query) {
+        if (auto keyboard = weak_keyboard.lock())
+        {
+            show_search_results(reader_view, state, keyboard, query);
+        }
+    });
+
+    state.view_stack.push(keyboard);
+}
+
 } // namespace
 
 ReaderView::ReaderView(
     std::filesystem::path path,
     std::shared_ptr<DocReader> reader,
+    std::shared_ptr<BookSearch> book_search,
     DocAddr seek_address,
     SystemStyling &sys_styling,
     TokenViewStyling &token_view_styling,
-    ViewStack &view_stack
+    ViewStack &view_stack,
+    TaskQueue &task_queue
 ) : state(std::make_unique<ReaderViewState>(
         path,
         seek_address,
         reader,
+        book_search,
         sys_styling,
         token_view_styling,
         token_view_styling.subscribe_to_changes([this]() {
             update_token_view_title(get_current_address(*state));
         }),
-        view_stack
+        view_stack,
+        task_queue
     ))
 {
     update_token_view_title(seek_address);
@@ -182,6 +321,11 @@ bool ReaderView::is_done()
     return state->is_done;
 }
 
+bool ReaderView::is_animating()
+{
+    return state->token_view->is_animating();
+}
+
 void ReaderView::on_keypress(SDLKey key)
 {
     if (key == SW_BTN_B)
@@ -199,6 +343,9 @@ void ReaderView::on_keypress(SDLKey key)
         case SW_BTN_SELECT:
             open_toc_menu(*this, *state);
             break;
+        case SW_BTN_Y:
+            open_search(*this, *state);
+            break;
         default:
             state->token_view->on_keypress(key);
             break;
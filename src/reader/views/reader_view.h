@@ -8,9 +8,11 @@
 #include <functional>
 #include <string>
 
+struct BookSearch;
 struct DocReader;
 struct ReaderViewState;
 struct SystemStyling;
+struct TaskQueue;
 struct TokenViewStyling;
 struct ViewStack;
 
@@ -24,10 +26,12 @@ public:
     ReaderView(
         std::filesystem::path path,
         std::shared_ptr<DocReader> reader,
+        std::shared_ptr<BookSearch> book_search,
         DocAddr seek_address,
         SystemStyling &sys_styling,
         TokenViewStyling &token_view_styling,
-        ViewStack &view_stack
+        ViewStack &view_stack,
+        TaskQueue &task_queue
     );
     ReaderView(const ReaderView &) = delete;
     ReaderView &operator=(const ReaderView &) = delete;
@@ -35,6 +39,7 @@ public:
 
     bool render(SDL_Surface *dest_surface, bool force_render) override;
     bool is_done() override;
+    bool is_animating() override;
 
     void on_keypress(SDLKey key) override;
     void on_keyheld(SDLKey key, uint32_t hold_time_ms) override;
@@ -5,6 +5,7 @@
 #include "sys/keymap.h"
 #include "reader/shoulder_keymap.h"
 #include "reader/system_styling.h"
+#include "util/glyph_atlas.h"
 #include "util/sdl_utils.h"
 
 uint32_t SelectionMenu::num_display_lines() const
@@ -27,6 +28,8 @@ SelectionMenu::SelectionMenu(std::vector<std::string> entries, SystemStyling &st
       styling(styling),
       styling_sub_id(styling.subscribe_to_changes([this](SystemStyling::ChangeId) {
           needs_render = true;
+          needs_full_render = true;
+          entry_surfaces.clear();
           int new_line_height = detect_line_height(
               this->styling.get_font_name(),
               this->styling.get_font_size()
@@ -53,8 +56,34 @@ SelectionMenu::~SelectionMenu()
 void SelectionMenu::set_entries(std::vector<std::string> new_entries)
 {
     entries = new_entries;
+    entry_surfaces.clear();
     set_cursor_pos(0);
     needs_render = true;
+    needs_full_render = true;
+}
+
+void SelectionMenu::append_entries(const std::vector<std::string> &new_entries)
+{
+    entries.insert(entries.end(), new_entries.begin(), new_entries.end());
+    needs_render = true;
+    needs_full_render = true;
+}
+
+void SelectionMenu::replace_entries(std::vector<std::string> new_entries)
+{
+    if (new_entries.size() != entries.size())
+    {
+        set_entries(new_entries);
+        return;
+    }
+
+    if (new_entries != entries)
+    {
+        entries = new_entries;
+        entry_surfaces.clear();
+        needs_render = true;
+        needs_full_render = true;
+    }
 }
 
 void SelectionMenu::set_on_selection(std::function<void(uint32_t)> callback)
@@ -120,72 +149,111 @@ void SelectionMenu::close()
     _is_done = true;
 }
 
-bool SelectionMenu::render(SDL_Surface *dest_surface, bool force_render)
+SDL_Surface *SelectionMenu::get_entry_surface(uint32_t index, bool is_highlighted, const SDL_PixelFormat *format)
 {
-    if (!needs_render && !force_render)
+    auto &surfaces = entry_surfaces[index];
+    auto &surface = is_highlighted ? surfaces.highlighted : surfaces.normal;
+    if (surface)
     {
-        return false;
+        return surface.get();
     }
-    needs_render = false;
-
-    TTF_Font *loaded_font = styling.get_loaded_font();
-
-    const SDL_PixelFormat *pixel_format = dest_surface->format;
 
     const auto &theme = styling.get_loaded_color_theme();
-    const SDL_Color &fg_color = theme.main_text;
-    const SDL_Color &bg_color = theme.background;
-    const SDL_Color &hl_bg_color = theme.highlight_background;
-    const SDL_Color &hl_text_color = theme.highlight_text;
+    GlyphAtlas &atlas = cached_glyph_atlas(
+        styling.get_loaded_font(),
+        is_highlighted ? theme.highlight_text : theme.main_text,
+        is_highlighted ? theme.highlight_background : theme.background
+    );
 
-    uint32_t rect_bg_color = SDL_MapRGB(pixel_format, bg_color.r, bg_color.g, bg_color.b);
-    uint32_t rect_highlight_color = SDL_MapRGB(pixel_format, hl_bg_color.r, hl_bg_color.g, hl_bg_color.b);
+    const char *text = entries[index].c_str();
+    int text_width = atlas.get_text_width(text);
+    if (text_width == 0)
+    {
+        return nullptr;
+    }
 
-    Sint16 x = line_padding;
-    Sint16 y = excess_pxl_y() / 2;
+    surface = surface_unique_ptr { SDL_CreateRGBSurface(
+        SDL_SWSURFACE,
+        text_width,
+        atlas.get_height(),
+        format->BitsPerPixel,
+        format->Rmask, format->Gmask, format->Bmask, 0
+    ) };
+    if (surface)
+    {
+        atlas.render(text, surface.get(), 0, 0);
+    }
+    return surface.get();
+}
 
-    // Clear screen
-    SDL_Rect rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
-    SDL_FillRect(dest_surface, &rect, rect_bg_color);
+void SelectionMenu::render_entry(uint32_t index, SDL_Surface *dest_surface)
+{
+    bool is_highlighted = (index == cursor_pos);
+    Sint16 y = excess_pxl_y() / 2 + (index - scroll_pos) * line_height;
 
-    // Draw lines
-    uint32_t num_lines = num_display_lines();
-    for (uint32_t i = 0; i < num_lines; ++i)
+    // Draw background, with highlight
     {
-        uint32_t global_i = i + scroll_pos;
-        if (global_i >= entries.size())
-        {
-            break;
-        }
+        const auto &theme = styling.get_loaded_color_theme();
+        const SDL_Color &color = is_highlighted ? theme.highlight_background : theme.background;
+        SDL_Rect rect = {0, y, SCREEN_WIDTH, (Uint16)(line_height)};
+        SDL_FillRect(dest_surface, &rect, SDL_MapRGB(dest_surface->format, color.r, color.g, color.b));
+    }
 
-        const auto &entry = entries[global_i];
+    // Draw text
+    if (SDL_Surface *text = get_entry_surface(index, is_highlighted, dest_surface->format))
+    {
+        SDL_Rect rect = {
+            static_cast<Sint16>(line_padding),
+            static_cast<Sint16>(y + line_padding / 2),
+            0, 0
+        };
+        SDL_BlitSurface(text, nullptr, dest_surface, &rect);
+    }
+}
 
-        bool is_highlighted = (global_i == cursor_pos);
+bool SelectionMenu::render(SDL_Surface *dest_surface, bool force_render)
+{
+    if (!needs_render && !force_render)
+    {
+        return false;
+    }
+    needs_render = false;
 
-        // Draw hightlight
-        if (is_highlighted)
-        {
-            SDL_Rect rect = {0, y, SCREEN_WIDTH, (Uint16)(line_height)};
-            SDL_FillRect(dest_surface, &rect, rect_highlight_color);
-        }
+    uint32_t num_lines = std::min<uint32_t>(num_display_lines(), entries.size() - std::min<uint32_t>(scroll_pos, entries.size()));
 
-        // Draw text
+    // The cursor moved within the page, so only its old and new rows change
+    if (!force_render && !needs_full_render && scroll_pos == rendered_scroll_pos)
+    {
+        if (rendered_cursor_pos == cursor_pos)
         {
-            SDL_Rect rectMessage = {
-                x,
-                static_cast<Sint16>(y + line_padding / 2),
-                0, 0
-            };
-            auto message = surface_unique_ptr { TTF_RenderUTF8_Shaded(
-                loaded_font,
-                entry.c_str(),
-                is_highlighted ? hl_text_color : fg_color,
-                is_highlighted ? hl_bg_color : bg_color
-            ) };
-            SDL_BlitSurface(message.get(), NULL, dest_surface, &rectMessage);
+            return false;
         }
+        render_entry(rendered_cursor_pos, dest_surface);
+        render_entry(cursor_pos, dest_surface);
+        rendered_cursor_pos = cursor_pos;
+        return true;
+    }
+    needs_full_render = false;
+    rendered_cursor_pos = cursor_pos;
+    rendered_scroll_pos = scroll_pos;
+
+    // Keep only the entries still shown
+    for (auto it = entry_surfaces.begin(); it != entry_surfaces.end();)
+    {
+        bool is_shown = it->first >= scroll_pos && it->first < scroll_pos + num_lines;
+        it = is_shown ? std::next(it) : entry_surfaces.erase(it);
+    }
 
-        y += line_height;
+    // Clear screen
+    {
+        const SDL_Color &bg_color = styling.get_loaded_color_theme().background;
+        SDL_Rect rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        SDL_FillRect(dest_surface, &rect, SDL_MapRGB(dest_surface->format, bg_color.r, bg_color.g, bg_color.b));
+    }
+
+    for (uint32_t i = 0; i < num_lines; ++i)
+    {
+        render_entry(scroll_pos + i, dest_surface);
     }
 
     return true;
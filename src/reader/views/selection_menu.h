@@ -2,12 +2,14 @@
 #define SELECTION_MENU_H_
 
 #include "reader/view.h"
+#include "util/sdl_pointer.h"
 #include "util/throttled.h"
 
 #include <SDL/SDL_ttf.h>
 
 #include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 struct SystemStyling;
@@ -15,6 +17,19 @@ struct SystemStyling;
 class SelectionMenu: public View
 {
     bool needs_render = true;
+    // Otherwise only the rows whose highlight changed are redrawn
+    bool needs_full_render = true;
+    uint32_t rendered_cursor_pos = 0;
+    uint32_t rendered_scroll_pos = 0;
+
+    // Text of visible entries, as drawn normally and highlighted. Dropped
+    // when the styling or entries change.
+    struct EntrySurfaces
+    {
+        surface_unique_ptr normal;
+        surface_unique_ptr highlighted;
+    };
+    std::unordered_map<uint32_t, EntrySurfaces> entry_surfaces;
 
     std::vector<std::string> entries;
     uint32_t cursor_pos = 0;
@@ -29,6 +44,9 @@ class SelectionMenu: public View
     uint32_t num_display_lines() const;
     uint32_t excess_pxl_y() const;
 
+    SDL_Surface *get_entry_surface(uint32_t index, bool is_highlighted, const SDL_PixelFormat *format);
+    void render_entry(uint32_t index, SDL_Surface *dest_surface);
+
     Throttled scroll_throttle;
 
     bool _is_done = false;
@@ -47,6 +65,10 @@ public:
     virtual ~SelectionMenu();
 
     void set_entries(std::vector<std::string> new_entries);
+    // Add entries at the end, leaving the cursor where it is
+    void append_entries(const std::vector<std::string> &new_entries);
+    // Change the text of the current entries, leaving the cursor where it is
+    void replace_entries(std::vector<std::string> new_entries);
     void set_on_selection(std::function<void(uint32_t)> callback);
     void set_on_focus(std::function<void(uint32_t)> callback);
     // Define fallback keypress handler
@@ -10,11 +10,39 @@
 #include "reader/system_styling.h"
 #include "sys/keymap.h"
 #include "sys/screen.h"
+#include "util/glyph_atlas.h"
 #include "util/sdl_font_cache.h"
 #include "util/sdl_utils.h"
 
 #include <filesystem>
 
+namespace
+{
+
+// Text measured ahead of drawing, so the dialog can be sized first
+struct SettingsText
+{
+    std::string str;
+    TTF_Font *font;
+    SDL_Color fg;
+    SDL_Color bg;
+    int w;
+    int h;
+
+    void render(SDL_Surface *dest, Sint16 x, Sint16 y) const
+    {
+        cached_glyph_atlas(font, fg, bg).render(str.c_str(), dest, x, y);
+    }
+};
+
+SettingsText measure_text(TTF_Font *font, const char *str, SDL_Color fg, SDL_Color bg)
+{
+    GlyphAtlas &atlas = cached_glyph_atlas(font, fg, bg);
+    return {str, font, fg, bg, atlas.get_text_width(str), atlas.get_height()};
+}
+
+} // namespace
+
 SettingsView::SettingsView(
     SystemStyling &sys_styling,
     TokenViewStyling &token_view_styling,
@@ -46,8 +74,8 @@ bool SettingsView::render(SDL_Surface *dest_surface, bool force_render)
         constexpr int style_hl = 1;
         constexpr int style_label = 2;
 
-        auto render_text = [&](const char *str, int style, TTF_Font *font = nullptr) {
-            return surface_unique_ptr { TTF_RenderUTF8_Shaded(
+        auto make_text = [&](const char *str, int style, TTF_Font *font = nullptr) {
+            return measure_text(
                 font ? font : sys_font,
                 str,
                 style == style_normal ?
@@ -56,41 +84,41 @@ bool SettingsView::render(SDL_Surface *dest_surface, bool force_render)
                 style == style_normal ?
                     theme.background :
                     (style == style_hl ? theme.highlight_background : theme.background)
-            ) };
+            );
         };
 
-        auto left_arrow = render_text("◂", style_hl);
-        auto right_arrow = render_text("▸", style_hl);
+        auto left_arrow = make_text("◂", style_hl);
+        auto right_arrow = make_text("▸", style_hl);
 
-        auto theme_label = render_text("Theme:", style_label);
-        auto theme_value = render_text(
+        auto theme_label = make_text("Theme:", style_label);
+        auto theme_value = make_text(
             sys_styling.get_color_theme().c_str(),
             line_selected == 0 ? style_hl : style_normal
         );
 
-        auto font_size_label = render_text("Font size:", style_label);
-        auto font_size_value = render_text(
+        auto font_size_label = make_text("Font size:", style_label);
+        auto font_size_value = make_text(
             std::to_string(sys_styling.get_font_size()).c_str(),
             line_selected == 1 ? style_hl : style_normal
         );
 
-        auto font_name_label = render_text("Font:", style_label);
-        auto font_name_value = render_text(
+        auto font_name_label = make_text("Font:", style_label);
+        auto font_name_value = make_text(
             std::filesystem::path(sys_styling.get_font_name()).filename().stem().string().c_str(),
             line_selected == 2 ? style_hl : style_normal,
             user_font
         );
 
-        auto shoulder_keymap_label = render_text("Shoulder keymap:", style_label);
-        auto shoulder_keymap_value = render_text(
+        auto shoulder_keymap_label = make_text("Shoulder keymap:", style_label);
+        auto shoulder_keymap_value = make_text(
             get_shoulder_keymap_display_name(
                 sys_styling.get_shoulder_keymap()
             ).c_str(),
             line_selected == 3 ? style_hl : style_normal
         );
 
-        auto progress_label = render_text("Progress:", style_label);
-        auto progress_value = render_text(
+        auto progress_label = make_text("Progress:", style_label);
+        auto progress_value = make_text(
             token_view_styling.get_progress_reporting() == ProgressReporting::CHAPTER_PERCENT ?
             "Chapter %" :
             "Book %",
@@ -99,18 +127,18 @@ bool SettingsView::render(SDL_Surface *dest_surface, bool force_render)
 
         Uint16 content_w;
         {
-            int arrow_w = left_arrow->w + right_arrow->w;
+            int arrow_w = left_arrow.w + right_arrow.w;
             std::vector<int> widths {
-                theme_label->w,
-                theme_value->w + arrow_w,
-                font_size_label->w,
-                font_size_value->w + arrow_w,
-                font_name_label->w,
-                font_name_value->w + arrow_w,
-                shoulder_keymap_label->w,
-                shoulder_keymap_value->w + arrow_w,
-                progress_label->w,
-                progress_value->w + arrow_w
+                theme_label.w,
+                theme_value.w + arrow_w,
+                font_size_label.w,
+                font_size_value.w + arrow_w,
+                font_name_label.w,
+                font_name_value.w + arrow_w,
+                shoulder_keymap_label.w,
+                shoulder_keymap_value.w + arrow_w,
+                progress_label.w,
+                progress_value.w + arrow_w
             };
             content_w = *std::max_element(widths.begin(), widths.end());
         }
@@ -118,7 +146,7 @@ bool SettingsView::render(SDL_Surface *dest_surface, bool force_render)
         int num_menu_items = 5;
         Uint16 text_padding = 5;
         Uint16 max_content_h = SCREEN_HEIGHT - DIALOG_BORDER_WIDTH * 2;
-        Uint16 line_height = theme_label->h + theme_value->h;
+        Uint16 line_height = theme_label.h + theme_value.h;
         int max_lines = std::max(1, (max_content_h + text_padding) / (line_height + text_padding));
         int num_lines_shown = std::min(num_menu_items, max_lines);
         {
@@ -151,25 +179,25 @@ bool SettingsView::render(SDL_Surface *dest_surface, bool force_render)
         // draw text
         {
             SDL_Rect rect = {0, content_y, 0, 0};
-            auto push_text = [&](SDL_Surface *surf, bool add_arrows = false) {
-                Sint16 start = SCREEN_WIDTH / 2 - surf->w / 2;
+            auto push_text = [&](const SettingsText &text, bool add_arrows = false) {
+                Sint16 start = SCREEN_WIDTH / 2 - text.w / 2;
 
                 rect.x = start;
-                SDL_BlitSurface(surf, NULL, dest_surface, &rect);
+                text.render(dest_surface, rect.x, rect.y);
 
                 if (add_arrows)
                 {
                     SDL_Rect arrow_rect = {0, 0, 0, 0};
-                    arrow_rect.y = rect.y + (surf->h - left_arrow->h) / 2;
+                    arrow_rect.y = rect.y + (text.h - left_arrow.h) / 2;
 
-                    arrow_rect.x = start - left_arrow->w;
-                    SDL_BlitSurface(left_arrow.get(), NULL, dest_surface, &arrow_rect);
+                    arrow_rect.x = start - left_arrow.w;
+                    left_arrow.render(dest_surface, arrow_rect.x, arrow_rect.y);
 
-                    arrow_rect.x = start + surf->w;
-                    SDL_BlitSurface(right_arrow.get(), NULL, dest_surface, &arrow_rect);
+                    arrow_rect.x = start + text.w;
+                    right_arrow.render(dest_surface, arrow_rect.x, arrow_rect.y);
                 }
 
-                rect.y += surf->h;
+                rect.y += text.h;
             };
 
             auto is_line_shown = [this, num_lines_shown](uint32_t i) {
@@ -178,36 +206,36 @@ bool SettingsView::render(SDL_Surface *dest_surface, bool force_render)
 
             if (is_line_shown(0))
             {
-                push_text(theme_label.get());
-                push_text(theme_value.get(), line_selected == 0);
+                push_text(theme_label);
+                push_text(theme_value, line_selected == 0);
                 rect.y += text_padding;
             }
 
             if (is_line_shown(1))
             {
-                push_text(font_size_label.get());
-                push_text(font_size_value.get(), line_selected == 1);
+                push_text(font_size_label);
+                push_text(font_size_value, line_selected == 1);
                 rect.y += text_padding;
             }
 
             if (is_line_shown(2))
             {
-                push_text(font_name_label.get());
-                push_text(font_name_value.get(), line_selected == 2);
+                push_text(font_name_label);
+                push_text(font_name_value, line_selected == 2);
                 rect.y += text_padding;
             }
 
             if (is_line_shown(3))
             {
-                push_text(shoulder_keymap_label.get());
-                push_text(shoulder_keymap_value.get(), line_selected == 3);
+                push_text(shoulder_keymap_label);
+                push_text(shoulder_keymap_value, line_selected == 3);
                 rect.y += text_padding;
             }
 
             if (is_line_shown(4))
             {
-                push_text(progress_label.get());
-                push_text(progress_value.get(), line_selected == 4);
+                push_text(progress_label);
+                push_text(progress_value, line_selected == 4);
             }
         }
 
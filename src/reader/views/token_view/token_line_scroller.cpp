@@ -3,11 +3,15 @@
 #include "doc_api/token_addressing.h"
 #include "reader/text_wrap.h"
 #include "sys/screen.h"
+#include "util/alloc_stats.h"
+#include "util/frame_stats.h"
 #include "util/sdl_utils.h"
 #include "util/str_utils.h"
 
 #include "extern/rotozoom/SDL_rotozoom.h"
 
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <iostream>
 
@@ -16,6 +20,11 @@ namespace
 
 const std::string BULLET = "•";
 
+// Enough for png and gif headers, and jpegs with little metadata. Jpegs with
+// larger segments ahead of the frame header are retried with the max.
+constexpr uint32_t IMAGE_PROBE_BYTES = 4 * 1024;
+constexpr uint32_t IMAGE_PROBE_MAX_BYTES = 128 * 1024;
+
 uint32_t get_line_for_address(const IndexedDequeue<std::unique_ptr<DisplayLine>> &lines, DocAddr address)
 {
     int best_line = lines.start_index();
@@ -48,17 +57,97 @@ float scale_to_fit_width(int w)
     return 1;
 }
 
+// Size after scale_to_fit_width, rounded as zoomSurface does
+ImageSize scaled_image_size(ImageSize image_size)
+{
+    float scale = scale_to_fit_width(image_size.width);
+    if (scale == 1)
+    {
+        return image_size;
+    }
+    return {
+        std::max(static_cast<uint32_t>(image_size.width * static_cast<double>(scale)), 1u),
+        std::max(static_cast<uint32_t>(image_size.height * static_cast<double>(scale)), 1u)
+    };
+}
+
+// Decode and scale to fit the screen. Safe to call from a worker thread.
+surface_unique_ptr decode_scaled_image(const std::vector<char> &img_data, const std::filesystem::path &path)
+{
+    std::string file_ext;
+    try
+    {
+        file_ext = path.extension().string().substr(1);
+    }
+    catch (const std::out_of_range &)
+    {
+        return nullptr;
+    }
+
+    auto img_surface = load_surface_from_ptr(
+        img_data.data(),
+        img_data.size(),
+        file_ext.c_str(),
+        get_render_surface_format()
+    );
+    if (!img_surface)
+    {
+        std::cerr << "Failed to load image: " << path << std::endl;
+        return nullptr;
+    }
+
+    float scale = scale_to_fit_width(img_surface->w);
+    if (scale != 1)
+    {
+        // Scaled at 32 bits, so convert back when rendering at another depth
+        img_surface = surface_unique_ptr { zoomSurface(img_surface.get(), scale, scale, 1) };
+        SDL_PixelFormat *render_format = get_render_surface_format();
+        if (img_surface && img_surface->format->BitsPerPixel != render_format->BitsPerPixel)
+        {
+            img_surface = surface_unique_ptr { SDL_ConvertSurface(img_surface.get(), render_format, 0) };
+        }
+        if (!img_surface)
+        {
+            std::cerr << "Failed to scale image: " << path << std::endl;
+            return nullptr;
+        }
+    }
+
+    return img_surface;
+}
+
 } // namespace
 
+// May be queued twice, when an image queued ahead of time is drawn before
+// it's loaded. The first task to run does the work.
+struct TokenLineScroller::ImageLoadJob
+{
+    std::filesystem::path path;
+    std::shared_ptr<ResourceLoader> loader;  // null if img_data was read up front
+    std::vector<char> img_data;
+    surface_unique_ptr surface;
+
+    TaskPriority priority = TaskPriority::Low;  // highest queued at
+    std::atomic<bool> claimed {false};
+    std::atomic<bool> finished {false};
+    bool delivered = false;  // main thread only
+};
+
 std::vector<std::unique_ptr<DisplayLine>> TokenLineScroller::image_to_display_lines(const ImageDocToken &token)
 {
-    SDL_Surface *image = load_scaled_image(token.path);
+    std::optional<ImageSize> image_size = get_scaled_image_size(token.path);
 
     std::vector<std::unique_ptr<DisplayLine>> lines;
-    if (image && image->h)
+    if (image_size)
     {
-        int num_lines = (image->h + line_height_pixels - 1) / line_height_pixels;
-        lines.emplace_back(std::make_unique<ImageLine>(token.address, token.path, num_lines, image->w, image->h));
+        // Decode ahead of drawing, behind images already on screen
+        if (!image_cache.get_image(token.path.string()))
+        {
+            start_image_load(token.path, TaskPriority::Low);
+        }
+
+        int num_lines = (image_size->height + line_height_pixels - 1) / line_height_pixels;
+        lines.emplace_back(std::make_unique<ImageLine>(token.address, token.path, num_lines, image_size->width, image_size->height));
         for (int i = 1; i < num_lines; ++i)
         {
             lines.emplace_back(std::make_unique<ImageRefLine>(token.address, i));
@@ -133,6 +222,9 @@ std::vector<std::unique_ptr<DisplayLine>> TokenLineScroller::render_display_line
 
 void TokenLineScroller::get_more_lines_forward(uint32_t num_lines)
 {
+    ScopedFrameTimer layout_timer(FramePhase::Layout);
+    ScopedAllocCounter alloc_counter(AllocSite::LayoutLines);
+
     while (num_lines > 0)
     {
         const DocToken *token = forward_it->read(1);
@@ -155,6 +247,9 @@ void TokenLineScroller::get_more_lines_forward(uint32_t num_lines)
 
 void TokenLineScroller::get_more_lines_backward(uint32_t num_lines)
 {
+    ScopedFrameTimer layout_timer(FramePhase::Layout);
+    ScopedAllocCounter alloc_counter(AllocSite::LayoutLines);
+
     while (num_lines > 0)
     {
         const DocToken *token = backward_it->read(-1);
@@ -199,16 +294,23 @@ TokenLineScroller::TokenLineScroller(
     const std::shared_ptr<DocReader> reader,
     DocAddr address,
     std::function<bool(const char *, uint32_t)> line_fits,
-    uint32_t line_height_pixels
+    uint32_t line_height_pixels,
+    TaskQueue &task_queue
 ) : reader(reader),
     forward_it(nullptr),
     backward_it(nullptr),
     line_fits(line_fits),
-    line_height_pixels(line_height_pixels)
+    line_height_pixels(line_height_pixels),
+    task_queue(task_queue)
 {
     initialize_buffer_at(address);
 }
 
+TokenLineScroller::~TokenLineScroller()
+{
+    image_load_token.cancel();
+}
+
 void TokenLineScroller::materialize_line(int line_num)
 {
     int forward_needed = line_num - lines_buf.end_index() + 1;
@@ -288,42 +390,181 @@ SDL_Surface *TokenLineScroller::load_scaled_image(const std::filesystem::path &p
         }
     }
 
+    start_image_load(path, TaskPriority::High);
+    return nullptr;
+}
+
+bool TokenLineScroller::is_image_failed(const std::filesystem::path &path) const
+{
+    return failed_images.count(path.string()) > 0;
+}
+
+void TokenLineScroller::set_on_image_loaded(std::function<void()> callback)
+{
+    on_image_loaded = callback;
+}
+
+// Display size of the image, for layout. Only the header is read, decoding
+// waits until the image is drawn.
+std::optional<ImageSize> TokenLineScroller::get_scaled_image_size(const std::filesystem::path &path)
+{
+    const std::string &key = path.string();
+    {
+        auto it = image_sizes.find(key);
+        if (it != image_sizes.end())
+        {
+            return it->second;
+        }
+    }
+    if (failed_images.count(key))
+    {
+        return std::nullopt;
+    }
+
+    std::optional<ImageSize> image_size;
+    for (uint32_t probe_bytes : {IMAGE_PROBE_BYTES, IMAGE_PROBE_MAX_BYTES})
+    {
+        auto header = reader->load_resource_prefix(path, probe_bytes);
+        image_size = probe_image_size(header.data(), header.size());
+        if (image_size || header.size() < probe_bytes)
+        {
+            break;
+        }
+    }
+    if (image_size)
+    {
+        image_sizes[key] = scaled_image_size(*image_size);
+        return image_sizes[key];
+    }
+
+    // Format unknown to the probe, so decode now for the size
+    auto img_data = read_image_data(path);
+    auto img_surface = img_data.empty() ? nullptr : decode_scaled_image(img_data, path);
+    if (!img_surface)
+    {
+        failed_images.insert(key);
+        return std::nullopt;
+    }
+    ImageSize decoded_size = {
+        static_cast<uint32_t>(img_surface->w),
+        static_cast<uint32_t>(img_surface->h)
+    };
+    image_sizes[key] = decoded_size;
+    image_cache.put_image(key, std::move(img_surface));
+    return decoded_size;
+}
+
+std::vector<char> TokenLineScroller::read_image_data(const std::filesystem::path &path)
+{
+    // Read on the main thread, as readers aren't safe to share between threads
     auto img_data = reader->load_resource(path);
     if (img_data.empty())
     {
         std::cerr << "Failed to read image data: " << path << std::endl;
-        return nullptr;
     }
+    return img_data;
+}
 
-    std::string file_ext;
-    try
+void TokenLineScroller::start_image_load(const std::filesystem::path &path, TaskPriority priority)
+{
+    const std::string &key = path.string();
+    if (failed_images.count(key))
     {
-        file_ext = path.extension().string().substr(1);
+        return;
     }
-    catch (const std::out_of_range &)
+
+    auto it = loading_images.find(key);
+    if (it != loading_images.end())
     {
-        return nullptr;
+        if (priority > it->second->priority)
+        {
+            submit_image_job(it->second, priority);
+        }
+        return;
     }
 
-    auto img_surface = load_surface_from_ptr(
-        img_data.data(),
-        img_data.size(),
-        file_ext.c_str(),
-        get_render_surface_format()
-    );
-    if (!img_surface)
+    auto job = std::make_shared<ImageLoadJob>();
+    job->path = path;
+
+    if (!resource_loader)
     {
-        std::cerr << "Failed to load image: " << path << std::endl;
-        return nullptr;
+        resource_loader = reader->create_resource_loader();
+    }
+    if (resource_loader)
+    {
+        job->loader = resource_loader;
+    }
+    else if (priority == TaskPriority::Low)
+    {
+        // Reading would hold up the main thread, so wait until it's drawn
+        return;
+    }
+    else
+    {
+        job->img_data = read_image_data(path);
+        if (job->img_data.empty())
+        {
+            failed_images.insert(key);
+            return;
+        }
     }
 
-    float scale = scale_to_fit_width(img_surface->w);
-    image_cache.put_image(
-        path,
-        scale != 1 ? 
-            surface_unique_ptr { zoomSurface(img_surface.get(), scale, scale, 1) } :
-            std::move(img_surface)
-    );
+    loading_images[key] = job;
+    submit_image_job(job, priority);
+}
 
-    return image_cache.get_image(path);
+void TokenLineScroller::submit_image_job(std::shared_ptr<ImageLoadJob> job, TaskPriority priority)
+{
+    job->priority = priority;
+
+    task_queue.submit_background(
+        [job]() {
+            if (job->claimed.exchange(true))
+            {
+                return;
+            }
+
+            if (job->loader)
+            {
+                job->img_data = job->loader->load_resource(job->path);
+                if (job->img_data.empty())
+                {
+                    std::cerr << "Failed to read image data: " << job->path << std::endl;
+                }
+            }
+            if (!job->img_data.empty())
+            {
+                job->surface = decode_scaled_image(job->img_data, job->path);
+            }
+            job->img_data = {};
+            job->finished = true;
+        },
+        [this, job]() {
+            // Only the completion of the task that did the work delivers it
+            if (!job->finished || job->delivered)
+            {
+                return;
+            }
+            job->delivered = true;
+
+            std::string key = job->path.string();
+            loading_images.erase(key);
+            if (job->surface)
+            {
+                image_cache.put_image(key, std::move(job->surface));
+            }
+            else
+            {
+                failed_images.insert(key);
+            }
+
+            // Either way the placeholder is replaced
+            if (on_image_loaded)
+            {
+                on_image_loaded();
+            }
+        },
+        priority,
+        image_load_token
+    );
 }
@@ -5,17 +5,25 @@
 
 #include "doc_api/doc_addr.h"
 #include "doc_api/doc_reader.h"
+#include "util/image_probe.h"
 #include "util/indexed_dequeue.h"
 #include "util/sdl_image_cache.h"
 #include "util/sdl_pointer.h"
+#include "util/task_queue.h"
 
 #include <functional>
 #include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 // Lazy renders tokens into lines of text, and provides access to the lines
-// through an infinite-scroll type interface.
+// through an infinite-scroll type interface. Images are laid out from their
+// header dimensions, then read and decoded on a worker thread, ahead of time
+// at low priority and urgently once drawn.
 class TokenLineScroller
 {
+    struct ImageLoadJob;
+
     const std::shared_ptr<DocReader> reader;
     std::shared_ptr<TokenIter> forward_it;
     std::shared_ptr<TokenIter> backward_it;
@@ -28,7 +36,20 @@ class TokenLineScroller
     int current_line = 0;
 
     IndexedDequeue<std::unique_ptr<DisplayLine>> lines_buf;
+
+    TaskQueue &task_queue;
+    CancelToken image_load_token;  // cancelled on destruction
+    std::shared_ptr<ResourceLoader> resource_loader;  // for reading on workers, null if unsupported
     SDLImageCache image_cache;
+    std::unordered_map<std::string, ImageSize> image_sizes;  // scaled to fit the screen
+    std::unordered_map<std::string, std::shared_ptr<ImageLoadJob>> loading_images;
+    std::unordered_set<std::string> failed_images;
+    std::function<void()> on_image_loaded;
+
+    std::optional<ImageSize> get_scaled_image_size(const std::filesystem::path &path);
+    std::vector<char> read_image_data(const std::filesystem::path &path);
+    void start_image_load(const std::filesystem::path &path, TaskPriority priority);
+    void submit_image_job(std::shared_ptr<ImageLoadJob> job, TaskPriority priority);
 
     std::vector<std::unique_ptr<DisplayLine>> image_to_display_lines(const ImageDocToken &token);
     std::vector<std::unique_ptr<DisplayLine>> render_display_lines(const DocToken &token);
@@ -44,8 +65,12 @@ public:
         const std::shared_ptr<DocReader> reader,
         DocAddr address,
         std::function<bool(const char *, uint32_t)> line_fits,
-        uint32_t line_height_pixels
+        uint32_t line_height_pixels,
+        TaskQueue &task_queue
     );
+    TokenLineScroller(const TokenLineScroller &) = delete;
+    TokenLineScroller &operator=(const TokenLineScroller &) = delete;
+    ~TokenLineScroller();
 
     const DisplayLine *get_line_relative(int offset);
     int get_line_number() const;
@@ -57,7 +82,14 @@ public:
     std::optional<int> first_line_number() const;
     std::optional<int> end_line_number() const;
 
+    // Null until the image is decoded in the background, or if it can't be.
+    // Starts decoding, or hurries it along, e.g. after eviction from the cache.
     SDL_Surface *load_scaled_image(const std::filesystem::path &path);
+    // True once decoding the image has failed, rather than not finished
+    bool is_image_failed(const std::filesystem::path &path) const;
+
+    // Called on the main thread when a background decode completes or fails
+    void set_on_image_loaded(std::function<void()> callback);
 };
 
 #endif
@@ -4,13 +4,21 @@
 #include "./token_view_styling.h"
 
 #include "doc_api/doc_reader.h"
+#include "reader/config.h"
 #include "reader/system_styling.h"
 #include "reader/shoulder_keymap.h"
 #include "sys/keymap.h"
 #include "sys/screen.h"
+#include "util/alloc_stats.h"
+#include "util/frame_stats.h"
+#include "util/glyph_atlas.h"
+#include "util/sdl_pointer.h"
 #include "util/sdl_utils.h"
 #include "util/throttled.h"
+#include "util/timer.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <stdexcept>
 namespace {
 
@@ -54,6 +62,15 @@ struct TokenViewState
     Throttled line_scroll_throttle;
     Throttled page_scroll_throttle;
 
+    // Smooth scrolling. The page and SMOOTH_SCROLL_MARGIN_LINES either side are
+    // pre-rendered to a strip, and each frame blits a window of it that slides
+    // towards the current line.
+    surface_unique_ptr scroll_strip;
+    int scroll_strip_first_line = 0;  // line number at the top of the strip
+    bool scroll_strip_stale = true;
+    int scroll_offset_px = 0;         // lines are drawn this far below where they belong
+    Timer scroll_anim_timer;
+
     int num_display_lines() const
     {
         return SCREEN_HEIGHT / line_height;
@@ -80,7 +97,7 @@ struct TokenViewState
         return SCREEN_HEIGHT - line_height - excess_pxl_y() / 2;
     }
 
-    TokenViewState(std::shared_ptr<DocReader> reader, DocAddr address, SystemStyling &sys_styling, TokenViewStyling &token_view_styling)
+    TokenViewState(std::shared_ptr<DocReader> reader, DocAddr address, SystemStyling &sys_styling, TokenViewStyling &token_view_styling, TaskQueue &task_queue)
         : sys_styling(sys_styling),
           token_view_styling(token_view_styling),
           sys_styling_sub_id(sys_styling.subscribe_to_changes([this](SystemStyling::ChangeId change_id) {
@@ -90,10 +107,13 @@ struct TokenViewState
                   line_height = detect_line_height(current_font) + line_padding;
                   line_scroller.set_line_height_pixels(line_height);
                   line_scroller.reset_buffer();  // need to re-wrap lines if font-size changed
+                  scroll_offset_px = 0;
               }
+              scroll_strip_stale = true;
               needs_render = true;
           })),
           token_view_styling_sub_id(token_view_styling.subscribe_to_changes([this]() {
+              scroll_strip_stale = true;
               needs_render = true;
           })),
           current_font(sys_styling.get_loaded_font()),
@@ -109,11 +129,16 @@ struct TokenViewState
                       len
                   );
               },
-              line_height
+              line_height,
+              task_queue
           ),
           line_scroll_throttle(250, 50),
           page_scroll_throttle(750, 150)
     {
+        line_scroller.set_on_image_loaded([this]() {
+            scroll_strip_stale = true;
+            needs_render = true;
+        });
     }
 
     ~TokenViewState()
@@ -121,66 +146,33 @@ struct TokenViewState
         sys_styling.unsubscribe_from_changes(sys_styling_sub_id);
         token_view_styling.unsubscribe_from_changes(token_view_styling_sub_id);
     }
-};
-
-TokenView::TokenView(std::shared_ptr<DocReader> reader, DocAddr address, SystemStyling &sys_styling, TokenViewStyling &token_view_styling)
-    : state(std::make_unique<TokenViewState>(reader, address, sys_styling, token_view_styling))
-{
-}
 
-TokenView::~TokenView()
-{
-}
+    void render_lines(SDL_Surface *dest_surface, int first_line, int num_lines, Sint16 line_y, int y_limit);
+    void render_broken_image(SDL_Surface *dest_surface, const SDL_Rect &visible_rect, const ImageLine &image_line, int image_y);
+    void render_scroll_window(SDL_Surface *dest_surface, Sint16 dest_y);
+    void render_title_bar(SDL_Surface *dest_surface, Sint16 line_y);
+};
 
-bool TokenView::render(SDL_Surface *dest_surface, bool force_render)
+// Draw num_lines lines starting from first_line, relative to the current line,
+// with the first at line_y. Images are cropped to the surface top and y_limit.
+void TokenViewState::render_lines(SDL_Surface *dest_surface, int first_line, int num_lines, Sint16 line_y, int y_limit)
 {
-    if (!state->needs_render && !force_render)
-    {
-        return false;
-    }
-    state->needs_render = false;
-
-    scroll(0);  // Will adjust scroll position if necessary for end of book
-
-    TTF_Font *font = state->current_font;
-    const auto &theme = state->sys_styling.get_loaded_color_theme();
-    const int line_height = state->line_height;
-    const int line_padding = state->line_padding;
-
-    // Clear screen
-    {
-        SDL_Rect rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
-        const auto &bgcolor = theme.background;
-
-        SDL_FillRect(
-            dest_surface,
-            &rect,
-            SDL_MapRGB(dest_surface->format, bgcolor.r, bgcolor.g, bgcolor.b)
-        );
-    }
-
-    int num_text_display_lines = state->num_text_display_lines();
-    const Uint16 padding_y = state->excess_pxl_y() / 2;
-    Sint16 line_y = padding_y;
+    const auto &theme = sys_styling.get_loaded_color_theme();
+    GlyphAtlas &text_atlas = cached_glyph_atlas(current_font, theme.main_text, theme.background);
 
-    for (int i = 0; i < num_text_display_lines; ++i)
+    for (int i = first_line; i < first_line + num_lines; ++i)
     {
-        const DisplayLine *line = state->line_scroller.get_line_relative(i);
+        const DisplayLine *line = line_scroller.get_line_relative(i);
         if (line)
         {
             if (line->type == DisplayLine::Type::Text)
             {
                 const auto *text_line = static_cast<const TextLine *>(line);
                 const char *s = text_line->text.c_str();
-                auto surface = surface_unique_ptr { TTF_RenderUTF8_Shaded(font, s, theme.main_text, theme.background) };
-                SDL_Rect dest_rect = {
-                    static_cast<Sint16>(line_padding + (text_line->centered ? (SCREEN_WIDTH - 2 * line_padding - surface->w) /2 : 0)),
-                    static_cast<Sint16>(line_y + line_padding / 2),
-                    0, 0
-                };
-                SDL_BlitSurface(surface.get(), nullptr, dest_surface, &dest_rect);
+                int x = line_padding + (text_line->centered ? (SCREEN_WIDTH - 2 * line_padding - text_atlas.get_text_width(s)) / 2 : 0);
+                text_atlas.render(s, dest_surface, x, line_y + line_padding / 2);
             }
-            else if (line->type == DisplayLine::Type::Image || (line->type == DisplayLine::Type::ImageRef && i == 0))
+            else if (line->type == DisplayLine::Type::Image || (line->type == DisplayLine::Type::ImageRef && i == first_line))
             {
                 const ImageLine *image_line = nullptr;
                 uint32_t line_offset = 0;
@@ -188,7 +180,7 @@ bool TokenView::render(SDL_Surface *dest_surface, bool force_render)
                 if (line->type == DisplayLine::Type::ImageRef)
                 {
                     line_offset = static_cast<const ImageRefLine *>(line)->offset;
-                    const DisplayLine *ref_line = state->line_scroller.get_line_relative(i - line_offset);
+                    const DisplayLine *ref_line = line_scroller.get_line_relative(i - line_offset);
                     if (ref_line)
                     {
                         if (ref_line->type != DisplayLine::Type::Image)
@@ -205,7 +197,7 @@ bool TokenView::render(SDL_Surface *dest_surface, bool force_render)
 
                 if (image_line)
                 {
-                    auto *surface = state->line_scroller.load_scaled_image(image_line->image_path);
+                    auto *surface = line_scroller.load_scaled_image(image_line->image_path);
 
                     // Amount of line height not used by image
                     uint32_t img_excess_y = image_line->num_lines * line_height - image_line->height;
@@ -216,14 +208,13 @@ bool TokenView::render(SDL_Surface *dest_surface, bool force_render)
                     Sint16 src_y = std::max(-screen_start_y, 0);
                     Sint16 dst_y = std::max(screen_start_y, 0);
 
-                    if (surface && src_y < (Sint16)image_line->height)
+                    if (src_y < (Sint16)image_line->height)
                     {
                         Uint16 width = image_line->width;
                         Uint16 height = image_line->height - src_y;
 
                         // Crop bottom
                         auto dst_y_bottom = dst_y + height;
-                        Uint16 y_limit = state->line_pxl_limit_y();
                         if (dst_y_bottom > y_limit)
                         {
                             height -= dst_y_bottom - y_limit;
@@ -233,58 +224,210 @@ bool TokenView::render(SDL_Surface *dest_surface, bool force_render)
                         SDL_Rect dest_rect = {
                             static_cast<Sint16>((SCREEN_WIDTH - width) / 2),
                             dst_y,
-                            0,
-                            0
+                            width,
+                            height
                         };
-                        SDL_BlitSurface(surface, &src_rect, dest_surface, &dest_rect);
+                        if (surface)
+                        {
+                            SDL_BlitSurface(surface, &src_rect, dest_surface, &dest_rect);
+                        }
+                        else if (line_scroller.is_image_failed(image_line->image_path))
+                        {
+                            render_broken_image(dest_surface, dest_rect, *image_line, screen_start_y);
+                        }
+                        else
+                        {
+                            // Placeholder until decoded
+                            const auto &color = theme.highlight_background;
+                            SDL_FillRect(dest_surface, &dest_rect, SDL_MapRGB(dest_surface->format, color.r, color.g, color.b));
+                        }
                     }
                 }
             }
         }
-        else
+        else if (i >= 0)
         {
             break;
         }
+        // else before the start of the book, leave blank
 
         line_y += line_height;
     }
+}
 
-    if (state->token_view_styling.get_show_title_bar())
+// Step the smooth scroll animation and blit the text area from the strip,
+// re-rendering the strip first if the window no longer falls inside it
+void TokenViewState::render_scroll_window(SDL_Surface *dest_surface, Sint16 dest_y)
+{
+    if (scroll_offset_px != 0)
     {
-        // Recompute for short book case
-        line_y = padding_y + num_text_display_lines * line_height;
-        SDL_Rect title_crop_rect = {0, 0, 0, (Uint16)line_height};
-
-        // Progress
-        {
-            char percent_str[32];
-            snprintf(percent_str, sizeof(percent_str), " %d%%", state->title_progress_percent);
+        // A line takes SMOOTH_SCROLL_LINE_MS, longer distances ease out
+        int distance = std::abs(scroll_offset_px);
+        int step = std::max(distance, line_height) * static_cast<int>(scroll_anim_timer.elapsed_ms()) / SMOOTH_SCROLL_LINE_MS;
+        step = std::clamp(step, 1, distance);
+        scroll_offset_px += (scroll_offset_px > 0) ? -step : step;
+    }
+    scroll_anim_timer.reset();
 
-            SDL_Surface *page_surface = TTF_RenderUTF8_Shaded(font, percent_str, theme.secondary_text, theme.background);
+    const int margin_lines = SMOOTH_SCROLL_MARGIN_LINES;
+    const int text_height = num_text_display_lines() * line_height;
+    const int cur_line = line_scroller.get_line_number();
 
-            SDL_Rect dest_rect = {
-                static_cast<Sint16>(SCREEN_WIDTH - page_surface->w - line_padding),
-                static_cast<Sint16>(line_y + line_padding / 2),
-                0, 0
-            };
-            title_crop_rect.w = SCREEN_WIDTH - line_padding * 2 - page_surface->w;
+    int window_y = (cur_line - scroll_strip_first_line) * line_height + scroll_offset_px;
+    if (scroll_strip_stale || !scroll_strip || window_y < 0 || window_y + text_height > scroll_strip->h ||
+        scroll_strip->format->BitsPerPixel != dest_surface->format->BitsPerPixel)
+    {
+        const SDL_PixelFormat *format = dest_surface->format;
+        int strip_height = text_height + margin_lines * 2 * line_height;
 
-            SDL_BlitSurface(page_surface, nullptr, dest_surface, &dest_rect);
-            SDL_FreeSurface(page_surface);
+        if (!scroll_strip || scroll_strip->h != strip_height || scroll_strip->format->BitsPerPixel != format->BitsPerPixel)
+        {
+            scroll_strip = surface_unique_ptr { SDL_CreateRGBSurface(
+                SDL_SWSURFACE,
+                SCREEN_WIDTH,
+                strip_height,
+                format->BitsPerPixel,
+                format->Rmask, format->Gmask, format->Bmask, 0
+            ) };
         }
-
-        // Toc item
-        if (state->title.size() > 0)
+        if (!scroll_strip)
         {
-            SDL_Rect dest_rect = {
-                static_cast<Sint16>(line_padding),
-                static_cast<Sint16>(line_y + line_padding / 2),
-                0, 0
-            };
-            SDL_Surface *surface = TTF_RenderUTF8_Shaded(font, state->title.c_str(), theme.secondary_text, theme.background);
-            SDL_BlitSurface(surface, &title_crop_rect, dest_surface, &dest_rect);
-            SDL_FreeSurface(surface);
+            // Fall back to drawing the page in place
+            scroll_offset_px = 0;
+            render_lines(dest_surface, 0, num_text_display_lines(), dest_y, line_pxl_limit_y());
+            return;
         }
+
+        const auto &bgcolor = sys_styling.get_loaded_color_theme().background;
+        SDL_FillRect(scroll_strip.get(), nullptr, SDL_MapRGB(scroll_strip->format, bgcolor.r, bgcolor.g, bgcolor.b));
+        render_lines(scroll_strip.get(), -margin_lines, num_text_display_lines() + margin_lines * 2, 0, strip_height);
+
+        scroll_strip_first_line = cur_line - margin_lines;
+        scroll_strip_stale = false;
+        window_y = margin_lines * line_height + scroll_offset_px;
+    }
+
+    SDL_Rect src_rect = {0, static_cast<Sint16>(window_y), SCREEN_WIDTH, static_cast<Uint16>(text_height)};
+    SDL_Rect dest_rect = {0, dest_y, 0, 0};
+    SDL_BlitSurface(scroll_strip.get(), &src_rect, dest_surface, &dest_rect);
+}
+
+// Mark an image that was laid out from its header but couldn't be decoded,
+// naming it as the text fallback for unreadable images does. Only the visible
+// part of the image's box at image_y is drawn.
+void TokenViewState::render_broken_image(SDL_Surface *dest_surface, const SDL_Rect &visible_rect, const ImageLine &image_line, int image_y)
+{
+    const auto &theme = sys_styling.get_loaded_color_theme();
+
+    SDL_Rect prev_clip;
+    SDL_GetClipRect(dest_surface, &prev_clip);
+    SDL_Rect clip = visible_rect;
+    SDL_SetClipRect(dest_surface, &clip);
+
+    Sint16 left = visible_rect.x;
+    Sint16 top = image_y;
+    Uint16 width = image_line.width;
+    Uint16 height = image_line.height;
+    Uint32 border_color = SDL_MapRGB(dest_surface->format, theme.secondary_text.r, theme.secondary_text.g, theme.secondary_text.b);
+    SDL_Rect edges[] = {
+        {left, top, width, 1},
+        {left, static_cast<Sint16>(top + height - 1), width, 1},
+        {left, top, 1, height},
+        {static_cast<Sint16>(left + width - 1), top, 1, height},
+    };
+    for (SDL_Rect &edge : edges)
+    {
+        SDL_FillRect(dest_surface, &edge, border_color);
+    }
+
+    GlyphAtlas &label_atlas = cached_glyph_atlas(current_font, theme.secondary_text, theme.background);
+    std::string label = "[Image " + image_line.image_path.string() + "]";
+    int label_width = label_atlas.get_text_width(label.c_str());
+    label_atlas.render(
+        label.c_str(),
+        dest_surface,
+        left + std::max((width - label_width) / 2, 1),
+        top + (static_cast<int>(height) - label_atlas.get_height()) / 2,
+        std::max(width - 2, 0)
+    );
+
+    SDL_SetClipRect(dest_surface, &prev_clip);
+}
+
+void TokenViewState::render_title_bar(SDL_Surface *dest_surface, Sint16 line_y)
+{
+    const auto &theme = sys_styling.get_loaded_color_theme();
+    GlyphAtlas &title_atlas = cached_glyph_atlas(current_font, theme.secondary_text, theme.background);
+    int title_max_width = 0;
+
+    // Progress
+    {
+        char percent_str[32];
+        snprintf(percent_str, sizeof(percent_str), " %d%%", title_progress_percent);
+
+        int percent_width = title_atlas.get_text_width(percent_str);
+        title_atlas.render(percent_str, dest_surface, SCREEN_WIDTH - percent_width - line_padding, line_y + line_padding / 2);
+        title_max_width = std::max(SCREEN_WIDTH - line_padding * 2 - percent_width, 0);
+    }
+
+    // Toc item
+    if (title.size() > 0)
+    {
+        title_atlas.render(title.c_str(), dest_surface, line_padding, line_y + line_padding / 2, title_max_width);
+    }
+}
+
+TokenView::TokenView(std::shared_ptr<DocReader> reader, DocAddr address, SystemStyling &sys_styling, TokenViewStyling &token_view_styling, TaskQueue &task_queue)
+    : state(std::make_unique<TokenViewState>(reader, address, sys_styling, token_view_styling, task_queue))
+{
+}
+
+TokenView::~TokenView()
+{
+}
+
+bool TokenView::render(SDL_Surface *dest_surface, bool force_render)
+{
+    // Animation frames only move the text, the rest of the page is unchanged
+    bool full_render = state->needs_render || force_render;
+    if (!full_render && !is_animating())
+    {
+        return false;
+    }
+    state->needs_render = false;
+
+    ScopedFrameTimer render_timer(FramePhase::Render);
+    ScopedAllocCounter alloc_counter(AllocSite::Render);
+
+    scroll(0, false);  // Will adjust scroll position if necessary for end of book
+
+    const Uint16 padding_y = state->excess_pxl_y() / 2;
+
+    // Clear screen
+    if (full_render)
+    {
+        SDL_Rect rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        const auto &bgcolor = state->sys_styling.get_loaded_color_theme().background;
+
+        SDL_FillRect(
+            dest_surface,
+            &rect,
+            SDL_MapRGB(dest_surface->format, bgcolor.r, bgcolor.g, bgcolor.b)
+        );
+    }
+
+    if (state->token_view_styling.get_smooth_scroll())
+    {
+        state->render_scroll_window(dest_surface, padding_y);
+    }
+    else
+    {
+        state->render_lines(dest_surface, 0, state->num_text_display_lines(), padding_y, state->line_pxl_limit_y());
+    }
+
+    if (full_render && state->token_view_styling.get_show_title_bar())
+    {
+        state->render_title_bar(dest_surface, padding_y + state->num_text_display_lines() * state->line_height);
     }
 
     return true;
@@ -323,7 +466,7 @@ static int get_bounded_scroll_amount(TokenLineScroller &line_scroller, int num_d
     return new_line - cur_line;
 }
 
-void TokenView::scroll(int num_lines)
+void TokenView::scroll(int num_lines, bool animate)
 {
     num_lines = get_bounded_scroll_amount(
         state->line_scroller,
@@ -333,6 +476,27 @@ void TokenView::scroll(int num_lines)
     if (num_lines != 0)
     {
         state->needs_render = true;
+
+        if (animate && state->token_view_styling.get_smooth_scroll())
+        {
+            // Start drawn where the lines were, then slide into place. Bounded
+            // so the text stays within the margins of the strip.
+            if (state->scroll_offset_px == 0)
+            {
+                state->scroll_anim_timer.reset();
+            }
+            const int max_offset_px = SMOOTH_SCROLL_MARGIN_LINES * state->line_height;
+            state->scroll_offset_px = std::clamp(
+                state->scroll_offset_px - num_lines * state->line_height,
+                -max_offset_px,
+                max_offset_px
+            );
+        }
+        else
+        {
+            state->scroll_offset_px = 0;
+        }
+
         state->line_scroller.seek_lines_relative(num_lines);
         if (state->on_scroll)
         {
@@ -345,10 +509,10 @@ void TokenView::on_keypress(SDLKey key)
 {
     switch (key) {
         case SW_BTN_UP:
-            scroll(-1);
+            scroll(-1, true);
             break;
         case SW_BTN_DOWN:
-            scroll(1);
+            scroll(1, true);
             break;
         case SW_BTN_L1:
         case SW_BTN_R1:
@@ -373,11 +537,11 @@ void TokenView::on_keypress(SDLKey key)
         case SW_BTN_RIGHT:
             if (key == SW_BTN_LEFT)
             {
-                scroll(-state->num_text_display_lines());
+                scroll(-state->num_text_display_lines(), false);
             }
             else if (key == SW_BTN_RIGHT)
             {
-                scroll(state->num_text_display_lines());
+                scroll(state->num_text_display_lines(), false);
             }
             break;
         default:
@@ -416,6 +580,11 @@ bool TokenView::is_done()
     return false;
 }
 
+bool TokenView::is_animating()
+{
+    return state->scroll_offset_px != 0;
+}
+
 DocAddr TokenView::get_address() const
 {
     const DisplayLine *line = state->line_scroller.get_line_relative(0);
@@ -429,6 +598,8 @@ DocAddr TokenView::get_address() const
 void TokenView::seek_to_address(DocAddr address)
 {
     state->line_scroller.seek_to_address(address);
+    state->scroll_offset_px = 0;
+    state->scroll_strip_stale = true;
     state->needs_render = true;
 }
 
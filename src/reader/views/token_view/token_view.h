@@ -11,6 +11,7 @@
 
 struct DocReader;
 struct SystemStyling;
+struct TaskQueue;
 struct TokenViewState;
 struct TokenViewStyling;
 
@@ -18,19 +19,21 @@ class TokenView: public View
 {
     std::unique_ptr<TokenViewState> state;
 
-    void scroll(int num_lines);
+    void scroll(int num_lines, bool animate);
 
 public:
     TokenView(
         std::shared_ptr<DocReader> reader,
         DocAddr address,
         SystemStyling &sys_styling,
-        TokenViewStyling &token_view_styling
+        TokenViewStyling &token_view_styling,
+        TaskQueue &task_queue
     );
     virtual ~TokenView();
 
     bool render(SDL_Surface *dest_surface, bool force_render) override;
     bool is_done() override;
+    bool is_animating() override;
     void on_keypress(SDLKey key) override;
     void on_keyheld(SDLKey key, uint32_t held_time_ms) override;
 
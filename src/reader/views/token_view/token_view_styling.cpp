@@ -6,17 +6,18 @@ struct TokenViewStylingState
 {
     bool show_title_bar;
     ProgressReporting progress_reporting;
+    bool smooth_scroll;
 
     uint32_t next_subscriber_id = 1;
     std::unordered_map<uint32_t, std::function<void()>> subscribers;
 
-    TokenViewStylingState(bool show_title_bar, ProgressReporting progress_reporting)
-        : show_title_bar(show_title_bar), progress_reporting(progress_reporting)
+    TokenViewStylingState(bool show_title_bar, ProgressReporting progress_reporting, bool smooth_scroll)
+        : show_title_bar(show_title_bar), progress_reporting(progress_reporting), smooth_scroll(smooth_scroll)
     {}
 };
 
-TokenViewStyling::TokenViewStyling(bool show_title_bar, ProgressReporting progress_reporting)
-    : state(std::make_unique<TokenViewStylingState>(show_title_bar, progress_reporting))
+TokenViewStyling::TokenViewStyling(bool show_title_bar, ProgressReporting progress_reporting, bool smooth_scroll)
+    : state(std::make_unique<TokenViewStylingState>(show_title_bar, progress_reporting, smooth_scroll))
 {
 }
 
@@ -60,6 +61,11 @@ void TokenViewStyling::set_progress_reporting(ProgressReporting progress_reporti
     }
 }
 
+bool TokenViewStyling::get_smooth_scroll() const
+{
+    return state->smooth_scroll;
+}
+
 uint32_t TokenViewStyling::subscribe_to_changes(std::function<void()> callback)
 {
     uint32_t sub_id = state->next_subscriber_id++;
@@ -15,7 +15,7 @@ class TokenViewStyling
     void notify_subscribers() const;
 
 public:
-    TokenViewStyling(bool show_title_bar, ProgressReporting progress_reporting);
+    TokenViewStyling(bool show_title_bar, ProgressReporting progress_reporting, bool smooth_scroll);
     virtual ~TokenViewStyling();
 
     // Title bar
@@ -26,6 +26,9 @@ public:
     ProgressReporting get_progress_reporting() const;
     void set_progress_reporting(ProgressReporting progress_reporting);
 
+    // Animate line scrolling, rather than jumping a line at a time
+    bool get_smooth_scroll() const;
+
     // Subscribe to any changes
     uint32_t subscribe_to_changes(std::function<void()> callback);
     void unsubscribe_from_changes(uint32_t sub_id);
@@ -0,0 +1,121 @@
+#include "filetypes/epub/xhtml_string_util.h"
+#include "util/timer.h"
+
+#include <libxml/parser.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr uint32_t NUM_ROUNDS = 20;
+
+bool is_xhtml_file(const std::filesystem::path &path)
+{
+    auto ext = path.extension();
+    return ext == ".xhtml" || ext == ".html" || ext == ".htm";
+}
+
+void collect_text_nodes(xmlNodePtr node, std::vector<std::string> &text_out)
+{
+    for (; node; node = node->next)
+    {
+        if (node->type == XML_TEXT_NODE && node->content)
+        {
+            text_out.push_back((const char *)node->content);
+        }
+        collect_text_nodes(node->children, text_out);
+    }
+}
+
+} // namespace
+
+// Time whitespace compaction over the text nodes of every xhtml file under
+// dir_path, e.g. a directory of unzipped epubs.
+void bench_compact(std::string dir_path)
+{
+    if (!std::filesystem::is_directory(dir_path))
+    {
+        std::cerr << "Invalid directory" << std::endl;
+        return;
+    }
+
+    std::vector<std::vector<std::string>> chapters;
+    uint64_t num_bytes = 0;
+
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(dir_path))
+    {
+        if (!entry.is_regular_file() || !is_xhtml_file(entry.path()))
+        {
+            continue;
+        }
+
+        std::ifstream fp(entry.path());
+        std::stringstream buffer;
+        buffer << fp.rdbuf();
+        std::string xml = buffer.str();
+
+        xmlDocPtr doc = xmlReadMemory(xml.c_str(), xml.size(), nullptr, nullptr, XML_PARSE_RECOVER | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+        if (!doc)
+        {
+            continue;
+        }
+
+        std::vector<std::string> text_nodes;
+        collect_text_nodes(xmlDocGetRootElement(doc), text_nodes);
+        xmlFreeDoc(doc);
+
+        for (const auto &text : text_nodes)
+        {
+            num_bytes += text.size();
+        }
+        chapters.push_back(std::move(text_nodes));
+    }
+
+    // Each text node compacted on its own, as inline text groups usually hold a single node
+    uint64_t checksum = 0;
+    Timer node_timer;
+    for (uint32_t round = 0; round < NUM_ROUNDS; ++round)
+    {
+        for (const auto &chapter : chapters)
+        {
+            for (const auto &text : chapter)
+            {
+                std::string compacted = text;
+                compact_strings_in_place(compacted);
+                checksum += compacted.size();
+            }
+        }
+    }
+    uint32_t node_ms = node_timer.elapsed_ms();
+
+    // Whole chapters joined, exercising long runs of text
+    Timer chapter_timer;
+    for (uint32_t round = 0; round < NUM_ROUNDS; ++round)
+    {
+        for (const auto &chapter : chapters)
+        {
+            std::vector<const char *> strings;
+            strings.reserve(chapter.size());
+            for (const auto &text : chapter)
+            {
+                strings.push_back(text.c_str());
+            }
+            checksum += compact_strings(strings).size();
+        }
+    }
+    uint32_t chapter_ms = chapter_timer.elapsed_ms();
+
+    double total_mb = static_cast<double>(num_bytes) * NUM_ROUNDS / (1024 * 1024);
+
+    std::cerr << "Chapters: " << chapters.size() << std::endl;
+    std::cerr << "Text bytes: " << num_bytes << " x " << NUM_ROUNDS << " rounds" << std::endl;
+    std::cerr << "Per node: " << node_ms << " ms (" << (node_ms ? total_mb * 1000 / node_ms : 0) << " MB/s)" << std::endl;
+    std::cerr << "Per chapter: " << chapter_ms << " ms (" << (chapter_ms ? total_mb * 1000 / chapter_ms : 0) << " MB/s)" << std::endl;
+    std::cerr << "Checksum: " << checksum << std::endl;
+}
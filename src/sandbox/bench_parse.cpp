@@ -0,0 +1,114 @@
+#include "filetypes/epub/xhtml_parser.h"
+#include "util/alloc_stats.h"
+#include "util/timer.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr uint32_t NUM_ROUNDS = 5;
+
+bool is_xhtml_file(const std::filesystem::path &path)
+{
+    auto ext = path.extension();
+    return ext == ".xhtml" || ext == ".html" || ext == ".htm";
+}
+
+} // namespace
+
+// Time parse_xhtml_tokens and scan_xhtml_address_width over every xhtml file
+// under dir_path, e.g. a directory of unzipped epubs.
+void bench_parse(std::string dir_path)
+{
+    if (!std::filesystem::is_directory(dir_path))
+    {
+        std::cerr << "Invalid directory" << std::endl;
+        return;
+    }
+
+    std::vector<std::pair<std::filesystem::path, std::string>> files;
+    uint64_t num_bytes = 0;
+
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(dir_path))
+    {
+        if (!entry.is_regular_file() || !is_xhtml_file(entry.path()))
+        {
+            continue;
+        }
+
+        std::ifstream fp(entry.path());
+        std::stringstream buffer;
+        buffer << fp.rdbuf();
+        files.emplace_back(entry.path(), buffer.str());
+        num_bytes += files.back().second.size();
+    }
+
+    // Fresh parser state per document vs one parser kept across all of them.
+    // Rounds alternate so heap state affects both the same.
+    XhtmlParser parser;
+    uint64_t num_tokens = 0;
+    uint64_t total_width = 0;
+    uint32_t parse_ms = 0;
+    uint32_t reused_parse_ms = 0;
+    uint32_t scan_ms = 0;
+    uint32_t reused_scan_ms = 0;
+    reset_alloc_site_counts();
+
+    for (uint32_t round = 0; round < NUM_ROUNDS; ++round)
+    {
+        for (bool reuse : {false, true})
+        {
+            Timer parse_timer;
+            for (const auto &[path, xml] : files)
+            {
+                std::vector<std::unique_ptr<DocToken>> tokens;
+                std::unordered_map<std::string, DocAddr> ids;
+                if (reuse)
+                {
+                    parser.parse_tokens(xml.c_str(), path, 0, tokens, ids);
+                }
+                else
+                {
+                    parse_xhtml_tokens(xml.c_str(), path, 0, tokens, ids);
+                }
+                num_tokens += tokens.size();
+            }
+            (reuse ? reused_parse_ms : parse_ms) += parse_timer.elapsed_ms();
+
+            Timer scan_timer;
+            for (const auto &[path, xml] : files)
+            {
+                auto width = reuse ? parser.scan_address_width(xml.c_str()) : scan_xhtml_address_width(xml.c_str());
+                total_width += width.value_or(0);
+            }
+            (reuse ? reused_scan_ms : scan_ms) += scan_timer.elapsed_ms();
+        }
+    }
+
+    double total_mb = static_cast<double>(num_bytes) * NUM_ROUNDS / (1024 * 1024);
+
+    auto print_rate = [total_mb](const char *label, uint32_t ms) {
+        std::cerr << label << ": " << ms << " ms (" << (ms ? total_mb * 1000 / ms : 0) << " MB/s)" << std::endl;
+    };
+
+    std::cerr << "Files: " << files.size() << std::endl;
+    std::cerr << "Bytes: " << num_bytes << " x " << NUM_ROUNDS << " rounds" << std::endl;
+    print_rate("Parse", parse_ms);
+    print_rate("Parse (reused parser)", reused_parse_ms);
+    print_rate("Scan", scan_ms);
+    print_rate("Scan (reused parser)", reused_scan_ms);
+    if (alloc_tracking_enabled())
+    {
+        AllocSiteCounts counts = get_alloc_site_counts(AllocSite::XhtmlParse);
+        std::cerr << "Parse allocations: " << counts.allocations << " (" << (num_tokens ? counts.allocations / num_tokens : 0)
+                  << " per token, " << counts.bytes / std::max<uint64_t>(counts.calls, 1) << " bytes per document)" << std::endl;
+    }
+    std::cerr << "Checksum: " << num_tokens << " " << total_width << std::endl;
+}
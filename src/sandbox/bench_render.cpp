@@ -0,0 +1,350 @@
+#include "doc_api/doc_reader.h"
+#include "filetypes/open_doc.h"
+#include "reader/config.h"
+#include "reader/system_styling.h"
+#include "reader/views/token_view/token_line_scroller.h"
+#include "reader/views/token_view/token_view.h"
+#include "reader/views/token_view/token_view_styling.h"
+#include "sys/keymap.h"
+#include "sys/screen.h"
+#include "util/alloc_stats.h"
+#include "util/frame_stats.h"
+#include "util/sdl_font_cache.h"
+#include "util/sdl_utils.h"
+#include "util/task_queue.h"
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr int LINE_PADDING = 4;  // same as TokenView
+
+// Latency samples of each phase of the scripted session, in the order first
+// seen, with the heap allocations made by each phase
+class PhaseSamples
+{
+    struct Phase
+    {
+        std::string name;
+        std::vector<uint32_t> samples;
+        uint64_t allocations = 0;
+    };
+
+    std::vector<Phase> phases;
+
+public:
+    void add(const std::string &phase, uint32_t micros, uint64_t allocations)
+    {
+        for (auto &p : phases)
+        {
+            if (p.name == phase)
+            {
+                p.samples.push_back(micros);
+                p.allocations += allocations;
+                return;
+            }
+        }
+        phases.push_back({phase, {micros}, allocations});
+    }
+
+    void write_json(std::ostream &os) const
+    {
+        os << "{";
+        bool first = true;
+        for (auto [name, samples, allocations] : phases)  // copied, percentile reorders
+        {
+            uint64_t total = 0;
+            for (uint32_t s : samples)
+            {
+                total += s;
+            }
+            uint32_t count = samples.size();
+
+            os << (first ? "" : ",") << "\n    \"" << name << "\": {"
+               << "\"count\": " << count
+               << ", \"total_us\": " << total
+               << ", \"p50_us\": " << percentile(samples.data(), count, 50)
+               << ", \"p90_us\": " << percentile(samples.data(), count, 90)
+               << ", \"p99_us\": " << percentile(samples.data(), count, 99)
+               << ", \"max_us\": " << percentile(samples.data(), count, 100);
+            if (alloc_tracking_enabled())
+            {
+                os << ", \"allocations\": " << allocations;
+            }
+            os << "}";
+            first = false;
+        }
+        os << "\n  }";
+    }
+};
+
+// Time a step of the session and record it under phase
+template <typename F>
+void timed(PhaseSamples &samples, const std::string &phase, F step)
+{
+    uint64_t start_allocations = thread_allocation_count();
+    auto start = std::chrono::steady_clock::now();
+    step();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    samples.add(
+        phase,
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(),
+        thread_allocation_count() - start_allocations
+    );
+}
+
+// Allocation counts of the instrumented hot paths over the whole run
+void write_alloc_sites_json(std::ostream &os)
+{
+    os << "{";
+    for (uint32_t i = 0; i < NUM_ALLOC_SITES; ++i)
+    {
+        AllocSite site = static_cast<AllocSite>(i);
+        AllocSiteCounts counts = get_alloc_site_counts(site);
+        os << (i ? "," : "") << "\n    \"" << alloc_site_name(site) << "\": {"
+           << "\"calls\": " << counts.calls
+           << ", \"allocations\": " << counts.allocations
+           << ", \"bytes\": " << counts.bytes
+           << "}";
+    }
+    os << "\n  }";
+}
+
+uint64_t peak_rss_kb()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    return usage.ru_maxrss;  // kilobytes on linux
+}
+
+// Wrap lines with TokenLineScroller alone, a page at a time, without rendering
+void run_layout_session(
+    std::shared_ptr<DocReader> reader,
+    SystemStyling &sys_styling,
+    TaskQueue &task_queue,
+    uint32_t num_pages,
+    PhaseSamples &samples
+)
+{
+    TTF_Font *font = sys_styling.get_loaded_font();
+    int line_height = detect_line_height(font) + LINE_PADDING;
+    int lines_per_page = SCREEN_HEIGHT / line_height;
+
+    std::unique_ptr<TokenLineScroller> scroller;
+    timed(samples, "layout_first_page", [&]() {
+        scroller = std::make_unique<TokenLineScroller>(
+            reader,
+            0,
+            [font](const char *s, uint32_t len) {
+                // Terminate in place, as TokenView does
+                char *mut_s = const_cast<char *>(s);
+                char replaced = mut_s[len];
+                mut_s[len] = 0;
+
+                int w = 0, h = 0;
+                TTF_SizeUTF8(font, mut_s, &w, &h);
+                mut_s[len] = replaced;
+
+                return w <= static_cast<int>(SCREEN_WIDTH) - LINE_PADDING * 2;
+            },
+            line_height,
+            task_queue
+        );
+        scroller->get_line_relative(lines_per_page);
+    });
+
+    for (uint32_t i = 0; i < num_pages; ++i)
+    {
+        auto end = scroller->end_line_number();
+        if (end && scroller->get_line_number() + lines_per_page >= *end)
+        {
+            break;
+        }
+
+        timed(samples, "layout_page", [&]() {
+            task_queue.drain();
+            scroller->seek_lines_relative(lines_per_page);
+            scroller->get_line_relative(lines_per_page);
+        });
+    }
+}
+
+// Drive a TokenView the way a reader would: open, page forward, jump to each
+// toc item, then change font size and back. Completed image decodes are taken
+// up at the start of each step, as the main loop does.
+void run_render_session(
+    std::shared_ptr<DocReader> reader,
+    SystemStyling &sys_styling,
+    TokenViewStyling &token_view_styling,
+    TaskQueue &task_queue,
+    SDL_Surface *screen,
+    uint32_t num_pages,
+    PhaseSamples &samples
+)
+{
+    std::unique_ptr<TokenView> view;
+    timed(samples, "first_render", [&]() {
+        view = std::make_unique<TokenView>(reader, 0, sys_styling, token_view_styling, task_queue);
+        view->render(screen, true);
+    });
+
+    for (uint32_t i = 0; i < num_pages; ++i)
+    {
+        bool rendered = false;
+        timed(samples, "page_forward", [&]() {
+            task_queue.drain();
+            view->on_keypress(SW_BTN_RIGHT);
+            rendered = view->render(screen, false);
+        });
+        if (!rendered)
+        {
+            break;  // end of book
+        }
+    }
+
+    uint32_t num_toc_items = reader->get_table_of_contents().size();
+    for (uint32_t i = 0; i < num_toc_items; ++i)
+    {
+        timed(samples, "toc_seek", [&]() {
+            task_queue.drain();
+            view->seek_to_address(reader->get_toc_item_address(i));
+            view->render(screen, false);
+        });
+    }
+
+    uint32_t font_size = sys_styling.get_font_size();
+    for (uint32_t new_size : {sys_styling.get_next_font_size(), font_size})
+    {
+        timed(samples, "font_change", [&]() {
+            task_queue.drain();
+            sys_styling.set_font_size(new_size);
+            view->render(screen, false);
+        });
+    }
+}
+
+} // namespace
+
+// Time layout and rendering over every book in dir_path through a scripted
+// session per book, without a display. Latency percentiles per phase and peak
+// RSS are written to stdout as JSON, with allocation counts in ALLOC_TRACKING
+// builds. Books are opened without a cache, so each
+// run measures the same work.
+void bench_render(std::string dir_path, uint32_t num_pages, uint32_t color_depth)
+{
+    if (!std::filesystem::is_directory(dir_path))
+    {
+        std::cerr << "Invalid directory" << std::endl;
+        return;
+    }
+
+    // Offscreen, unless a driver is set explicitly
+    setenv("SDL_VIDEODRIVER", "dummy", 0);
+    if (SDL_Init(SDL_INIT_VIDEO) != 0 || TTF_Init() != 0)
+    {
+        std::cerr << "Unable to init SDL" << std::endl;
+        return;
+    }
+
+    SDL_Surface *video = SDL_SetVideoMode(SCREEN_WIDTH, SCREEN_HEIGHT, color_depth, SDL_SWSURFACE);
+    SDL_Surface *screen = video ? SDL_CreateRGBSurface(
+        SDL_SWSURFACE,
+        SCREEN_WIDTH,
+        SCREEN_HEIGHT,
+        video->format->BitsPerPixel,
+        video->format->Rmask, video->format->Gmask, video->format->Bmask, 0
+    ) : nullptr;
+    if (!video || !screen)
+    {
+        std::cerr << "Unable to create surfaces" << std::endl;
+        SDL_Quit();
+        return;
+    }
+    set_render_surface_format(screen->format);
+
+    if (!cached_load_font(DEFAULT_FONT_NAME, DEFAULT_FONT_SIZE, FontLoadErrorOpt::NoThrow))
+    {
+        std::cerr << "Unable to load " << DEFAULT_FONT_NAME << std::endl;
+        SDL_FreeSurface(screen);
+        SDL_Quit();
+        return;
+    }
+
+    SystemStyling sys_styling(DEFAULT_FONT_NAME, DEFAULT_FONT_SIZE, DEFAULT_COLOR_THEME, DEFAULT_SHOULDER_KEYMAP);
+    TokenViewStyling token_view_styling(DEFAULT_SHOW_PROGRESS, DEFAULT_PROGRESS_REPORTING, DEFAULT_SMOOTH_SCROLL);
+    TaskQueue task_queue;
+
+    PhaseSamples samples;
+    reset_alloc_site_counts();
+    uint32_t num_books = 0;
+    uint32_t num_failed = 0;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(dir_path))
+    {
+        if (entry.is_regular_file() && file_type_is_supported(entry.path()))
+        {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    for (const auto &path : paths)
+    {
+        std::cerr << path.filename().string() << std::endl;
+
+        std::shared_ptr<DocReader> reader;
+        bool opened = false;
+        // Measure documents during open, so no background measuring competes
+        // with the timed sessions and runs are repeatable
+        timed(samples, "open", [&]() {
+            reader = create_doc_reader(path, DocWidthsMode::Eager);
+            opened = reader && reader->open();
+        });
+        if (!opened)
+        {
+            std::cerr << "Unable to open " << path.filename() << std::endl;
+            ++num_failed;
+            continue;
+        }
+
+        run_layout_session(reader, sys_styling, task_queue, num_pages, samples);
+        run_render_session(reader, sys_styling, token_view_styling, task_queue, screen, num_pages, samples);
+        ++num_books;
+    }
+
+    std::cout << "{\n"
+              << "  \"screen\": [" << SCREEN_WIDTH << ", " << SCREEN_HEIGHT << "],\n"
+              << "  \"font_size\": " << DEFAULT_FONT_SIZE << ",\n"
+              << "  \"color_depth\": " << static_cast<uint32_t>(screen->format->BitsPerPixel) << ",\n"
+              << "  \"pages_per_book\": " << num_pages << ",\n"
+              << "  \"books\": " << num_books << ",\n"
+              << "  \"failed_books\": " << num_failed << ",\n"
+              << "  \"peak_rss_kb\": " << peak_rss_kb() << ",\n"
+              << "  \"phases\": ";
+    samples.write_json(std::cout);
+    if (alloc_tracking_enabled())
+    {
+        std::cout << ",\n  \"alloc_sites\": ";
+        write_alloc_sites_json(std::cout);
+    }
+    std::cout << "\n}" << std::endl;
+
+    SDL_FreeSurface(screen);
+    SDL_Quit();
+}
@@ -1,75 +1,255 @@
-#include "doc_api/token_addressing.h"
+#include "filetypes/epub/epub_reader.h"
 #include "filetypes/open_doc.h"
-#include "reader/config.h"
-#include "reader/ss_doc_reader_cache.h"
-#include "reader/state_store.h"
-#include "util/timer.h"
+#include "util/alloc_stats.h"
+#include "util/str_utils.h"
 
+#include <libxml/parser.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
-#include <list>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace
 {
 
-struct Stats
+constexpr uint32_t NUM_SLOWEST_SHOWN = 10;
+
+struct BookResult
 {
-    std::list<std::pair<std::string, uint32_t>> load_times;
+    std::filesystem::path path;
+    uint64_t file_size = 0;
+    std::string failure;  // empty on success
+
+    uint32_t open_us = 0;
+    EpubOpenTimings epub_timings;  // zero for other formats
+    uint32_t tokens_us = 0;        // reading every token after open
+
+    uint32_t num_toc_items = 0;
+    uint64_t num_tokens = 0;
+    uint64_t num_allocations = 0;
+
+    uint32_t total_us() const
+    {
+        return open_us + tokens_us;
+    }
 };
 
-void load_file(std::filesystem::path path, Stats &stats, DocReaderCache &cache)
+uint32_t elapsed_us(std::chrono::steady_clock::time_point start)
 {
-    Timer t;
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+}
 
-    auto reader = create_doc_reader(path);
-    if (!reader || !reader->open(cache))
+std::shared_ptr<DocReader> create_measured_reader(const std::filesystem::path &path)
+{
+    // Measure documents during open, rather than on a thread of its own. Books
+    // already load in parallel, so each measures on its loading thread alone.
+    if (to_lower(path.extension()) == ".epub")
     {
-        std::cerr << "Unable to open " << path.filename() << std::endl;
-        return;
+        auto reader = std::make_shared<EPubReader>(path, DocWidthsMode::Eager);
+        reader->set_max_measure_threads(1);
+        return reader;
     }
-
-    stats.load_times.emplace_back(
-        path.filename(), t.elapsed_ms()
-    );
+    return create_doc_reader(path);
 }
 
-} // namespace
+// Open the book with no cache and read it through. Each book gets a reader of
+// its own, so books can be loaded on any thread.
+void load_book(BookResult &result)
+{
+    uint64_t start_allocations = thread_allocation_count();
+
+    std::error_code ec;
+    result.file_size = std::filesystem::file_size(result.path, ec);
 
-void bulk_load_test(std::string dir_path)
+    try
+    {
+        auto open_start = std::chrono::steady_clock::now();
+        auto reader = create_measured_reader(result.path);
+        bool opened = reader && reader->open();
+        result.open_us = elapsed_us(open_start);
+
+        if (!opened)
+        {
+            result.failure = "open";
+        }
+        else
+        {
+            if (auto *epub_reader = dynamic_cast<EPubReader *>(reader.get()))
+            {
+                result.epub_timings = epub_reader->get_open_timings();
+            }
+            result.num_toc_items = reader->get_table_of_contents().size();
+
+            reader->set_sequential_access();
+
+            auto tokens_start = std::chrono::steady_clock::now();
+            auto iter = reader->get_iter();
+            while (iter->read(1))
+            {
+                ++result.num_tokens;
+            }
+            result.tokens_us = elapsed_us(tokens_start);
+
+            if (result.num_tokens == 0)
+            {
+                result.failure = "no tokens";
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        result.failure = std::string("exception: ") + e.what();
+    }
+
+    result.num_allocations = thread_allocation_count() - start_allocations;
+}
+
+std::string csv_field(const std::string &field)
 {
-    if (std::filesystem::exists(dir_path) && std::filesystem::is_directory(dir_path))
+    if (field.find_first_of(",\"\n") == std::string::npos)
+    {
+        return field;
+    }
+
+    std::string quoted = "\"";
+    for (char c : field)
     {
-        StateStore store("store");
-        SSDocReaderCache cache(store);
+        quoted += (c == '"') ? "\"\"" : std::string(1, c);
+    }
+    return quoted + "\"";
+}
 
-        Stats stats;
+void write_csv_report(std::ostream &os, const std::vector<BookResult> &results)
+{
+    os << "file,size_bytes,status,total_us,open_us,zip_open_us,package_us,toc_parse_us,doc_widths_us,index_us,"
+       << "tokens_us,toc_items,tokens,allocations\n";
 
-        for (const auto& entry: std::filesystem::directory_iterator(dir_path))
+    for (const auto &r : results)
+    {
+        os << csv_field(r.path.string()) << ","
+           << r.file_size << ","
+           << csv_field(r.failure.empty() ? "ok" : r.failure) << ","
+           << r.total_us() << ","
+           << r.open_us << ","
+           << r.epub_timings.zip_open_us << ","
+           << r.epub_timings.package_us << ","
+           << r.epub_timings.toc_parse_us << ","
+           << r.epub_timings.doc_widths_us << ","
+           << r.epub_timings.index_us << ","
+           << r.tokens_us << ","
+           << r.num_toc_items << ","
+           << r.num_tokens << ",";
+        if (alloc_tracking_enabled())
         {
-            load_file(entry.path(), stats, cache);
+            os << r.num_allocations;
         }
+        os << "\n";
+    }
+}
 
-        uint32_t total_load_time = 0;
-        for (const auto &[path, load_time]: stats.load_times)
-        {
-            std::cerr << path << ", " << load_time << std::endl;
+} // namespace
+
+// Open and read every supported book under dir_path, num_threads at a time,
+// as a check over a corpus. Writes a csv row per book to stdout, slowest
+// first, and a summary to stderr.
+void bulk_load_test(std::string dir_path, uint32_t num_threads)
+{
+    if (!std::filesystem::is_directory(dir_path))
+    {
+        std::cerr << "Invalid directory" << std::endl;
+        return;
+    }
 
-            total_load_time += load_time;
+    std::vector<BookResult> results;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(dir_path))
+    {
+        if (entry.is_regular_file() && file_type_is_supported(entry.path()))
+        {
+            results.emplace_back();
+            results.back().path = entry.path();
         }
+    }
 
-        std::cerr << std::endl;
-        std::cerr << "Total files: " << stats.load_times.size() << std::endl;
-        std::cerr << "Total time: " << total_load_time << std::endl;
+    if (num_threads == 0)
+    {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    num_threads = std::min<uint32_t>(num_threads, std::max<size_t>(results.size(), 1));
 
+    // Must be initialized before parsing on worker threads
+    xmlInitParser();
+
+    auto wall_start = std::chrono::steady_clock::now();
+    {
+        std::atomic<uint32_t> next_book {0};
+        std::vector<std::thread> workers;
+        for (uint32_t i = 0; i < num_threads; ++i)
         {
-            Timer t;
-            store.flush();
-            std::cerr << "Flush time: " << t.elapsed_ms() << std::endl;
+            workers.emplace_back([&results, &next_book]() {
+                for (uint32_t book = next_book++; book < results.size(); book = next_book++)
+                {
+                    load_book(results[book]);
+                }
+            });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
         }
     }
-    else
+    uint32_t wall_ms = elapsed_us(wall_start) / 1000;
+
+    std::sort(results.begin(), results.end(), [](const BookResult &a, const BookResult &b) {
+        return a.total_us() > b.total_us();
+    });
+
+    write_csv_report(std::cout, results);
+
+    uint64_t total_us = 0;
+    uint64_t total_tokens = 0;
+    uint32_t num_failed = 0;
+    for (const auto &r : results)
     {
-        std::cerr << "Invalid directory" << std::endl;
+        total_us += r.total_us();
+        total_tokens += r.num_tokens;
+        num_failed += r.failure.empty() ? 0 : 1;
+    }
+
+    std::cerr << "Total files: " << results.size() << std::endl;
+    std::cerr << "Failed: " << num_failed << std::endl;
+    std::cerr << "Threads: " << num_threads << std::endl;
+    std::cerr << "Wall time: " << wall_ms << " ms" << std::endl;
+    std::cerr << "Total book time: " << total_us / 1000 << " ms" << std::endl;
+    std::cerr << "Total tokens: " << total_tokens << std::endl;
+    if (!alloc_tracking_enabled())
+    {
+        std::cerr << "Allocations: not counted, build with ALLOC_TRACKING=1" << std::endl;
+    }
+
+    std::cerr << std::endl << "Slowest:" << std::endl;
+    for (uint32_t i = 0; i < std::min<size_t>(NUM_SLOWEST_SHOWN, results.size()); ++i)
+    {
+        std::cerr << "  " << std::fixed << std::setprecision(1) << results[i].total_us() / 1000.0 << " ms  "
+                  << results[i].path.filename().string() << std::endl;
+    }
+
+    if (num_failed)
+    {
+        std::cerr << std::endl << "Failures:" << std::endl;
+        for (const auto &r : results)
+        {
+            if (!r.failure.empty())
+            {
+                std::cerr << "  " << r.failure << "  " << r.path.filename().string() << std::endl;
+            }
+        }
     }
 }
@@ -11,7 +11,7 @@ void display_epub(std::string path)
     std::cout << "================================" << std::endl;
     std::cout << path << std::endl;
 
-    EPubReader epub(path);
+    EPubReader epub(path, DocWidthsMode::Eager);
     if (!epub.open())
     {
         std::cerr << "Unable to open epub" << std::endl;
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <libxml/parser.h>
 #include <unistd.h>
@@ -14,7 +15,11 @@ void ls(std::string path)
 
 void display_epub(std::string path);
 void display_xhtml(std::string path);
-void bulk_load_test(std::string path);
+void bulk_load_test(std::string path, uint32_t num_threads);
+void verify_widths(std::string path);
+void bench_compact(std::string path);
+void bench_parse(std::string path);
+void bench_render(std::string path, uint32_t num_pages, uint32_t color_depth);
 
 int main(int argc, char** argv)
 {
@@ -35,7 +40,28 @@ int main(int argc, char** argv)
         }
         else if (mode == "bulk" && argc > 2)
         {
-            bulk_load_test(argv[2]);
+            // Optional number of threads, defaults to one per core
+            uint32_t num_threads = argc > 3 ? std::max(atoi(argv[3]), 0) : 0;
+            bulk_load_test(argv[2], num_threads);
+        }
+        else if (mode == "widths" && argc > 2)
+        {
+            verify_widths(argv[2]);
+        }
+        else if (mode == "compact" && argc > 2)
+        {
+            bench_compact(argv[2]);
+        }
+        else if (mode == "parse" && argc > 2)
+        {
+            bench_parse(argv[2]);
+        }
+        else if (mode == "render" && argc > 2)
+        {
+            // Optional number of pages to turn per book, and 16 or 32 bit color
+            uint32_t num_pages = argc > 3 ? std::max(atoi(argv[3]), 0) : 50;
+            uint32_t color_depth = (argc > 4 && atoi(argv[4]) == 16) ? 16 : 32;
+            bench_render(argv[2], num_pages, color_depth);
         }
         else
         {
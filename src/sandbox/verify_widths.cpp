@@ -0,0 +1,88 @@
+#include "doc_api/token_addressing.h"
+#include "filetypes/epub/xhtml_parser.h"
+#include "util/timer.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+bool is_xhtml_file(const std::filesystem::path &path)
+{
+    auto ext = path.extension();
+    return ext == ".xhtml" || ext == ".html" || ext == ".htm";
+}
+
+uint32_t parsed_address_width(const std::string &xml, const std::filesystem::path &path)
+{
+    std::vector<std::unique_ptr<DocToken>> tokens;
+    std::unordered_map<std::string, DocAddr> ids;
+    parse_xhtml_tokens(xml.c_str(), path, 0, tokens, ids);
+
+    if (tokens.empty())
+    {
+        return 0;
+    }
+    return tokens.back()->address + get_address_width(*tokens.back());
+}
+
+} // namespace
+
+// Compare scan_xhtml_address_width against a full parse for every xhtml file
+// under dir_path, e.g. a directory of unzipped epubs.
+void verify_widths(std::string dir_path)
+{
+    if (!std::filesystem::is_directory(dir_path))
+    {
+        std::cerr << "Invalid directory" << std::endl;
+        return;
+    }
+
+    uint32_t num_files = 0;
+    uint32_t num_mismatched = 0;
+    uint32_t num_unsupported = 0;
+    uint32_t parse_ms = 0;
+    uint32_t scan_ms = 0;
+
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(dir_path))
+    {
+        if (!entry.is_regular_file() || !is_xhtml_file(entry.path()))
+        {
+            continue;
+        }
+
+        std::ifstream fp(entry.path());
+        std::stringstream buffer;
+        buffer << fp.rdbuf();
+        std::string xml = buffer.str();
+
+        Timer parse_timer;
+        uint32_t parsed = parsed_address_width(xml, entry.path());
+        parse_ms += parse_timer.elapsed_ms();
+
+        Timer scan_timer;
+        auto scanned = scan_xhtml_address_width(xml.c_str());
+        scan_ms += scan_timer.elapsed_ms();
+
+        ++num_files;
+        if (!scanned)
+        {
+            ++num_unsupported;
+        }
+        else if (*scanned != parsed)
+        {
+            ++num_mismatched;
+            std::cerr << "Mismatch " << entry.path() << " parsed: " << parsed << " scanned: " << *scanned << std::endl;
+        }
+    }
+
+    std::cerr << "Total files: " << num_files << std::endl;
+    std::cerr << "Mismatched: " << num_mismatched << std::endl;
+    std::cerr << "Unsupported: " << num_unsupported << std::endl;
+    std::cerr << "Parse time: " << parse_ms << std::endl;
+    std::cerr << "Scan time: " << scan_ms << std::endl;
+}
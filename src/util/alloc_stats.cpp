@@ -0,0 +1,142 @@
+#include "./alloc_stats.h"
+
+#include <array>
+#include <cstdlib>
+#include <new>
+
+const char *alloc_site_name(AllocSite site)
+{
+    switch (site)
+    {
+        case AllocSite::XhtmlParse:
+            return "xhtml_parse";
+        case AllocSite::WrapLines:
+            return "wrap_lines";
+        case AllocSite::LayoutLines:
+            return "layout_lines";
+        case AllocSite::Render:
+            return "render";
+    }
+    return "unknown";
+}
+
+#if ALLOC_TRACKING
+
+namespace
+{
+
+thread_local uint64_t num_allocations = 0;
+thread_local uint64_t num_bytes = 0;
+thread_local std::array<AllocSiteCounts, NUM_ALLOC_SITES> site_counts = {};
+
+void *counted_alloc(std::size_t size)
+{
+    ++num_allocations;
+    num_bytes += size;
+    return std::malloc(size ? size : 1);
+}
+
+} // namespace
+
+uint64_t thread_allocation_count()
+{
+    return num_allocations;
+}
+
+uint64_t thread_allocated_bytes()
+{
+    return num_bytes;
+}
+
+AllocSiteCounts get_alloc_site_counts(AllocSite site)
+{
+    return site_counts[static_cast<uint32_t>(site)];
+}
+
+void reset_alloc_site_counts()
+{
+    site_counts = {};
+}
+
+ScopedAllocCounter::ScopedAllocCounter(AllocSite site)
+    : site(site),
+      start_allocations(num_allocations),
+      start_bytes(num_bytes)
+{
+}
+
+ScopedAllocCounter::~ScopedAllocCounter()
+{
+    AllocSiteCounts &counts = site_counts[static_cast<uint32_t>(site)];
+    ++counts.calls;
+    counts.allocations += num_allocations - start_allocations;
+    counts.bytes += num_bytes - start_bytes;
+}
+
+void *operator new(std::size_t size)
+{
+    void *p = counted_alloc(size);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_alloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_alloc(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#else
+
+uint64_t thread_allocation_count()
+{
+    return 0;
+}
+
+uint64_t thread_allocated_bytes()
+{
+    return 0;
+}
+
+AllocSiteCounts get_alloc_site_counts(AllocSite)
+{
+    return {};
+}
+
+void reset_alloc_site_counts()
+{
+}
+
+#endif
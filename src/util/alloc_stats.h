@@ -0,0 +1,66 @@
+#ifndef ALLOC_STATS_H_
+#define ALLOC_STATS_H_
+
+#include <cstdint>
+
+// Heap allocation counts for hot paths. Counting replaces the global operator
+// new, so it is only built in with ALLOC_TRACKING=1 (make ALLOC_TRACKING=1).
+// Otherwise the scoped counters compile to nothing and every count reads 0.
+// Only operator new is counted, not malloc calls made inside libxml2 or SDL.
+#ifndef ALLOC_TRACKING
+#define ALLOC_TRACKING 0
+#endif
+
+enum class AllocSite
+{
+    XhtmlParse,   // parse_xhtml_tokens
+    WrapLines,    // wrap_lines
+    LayoutLines,  // TokenLineScroller::get_more_lines_forward/backward
+    Render,       // TokenView::render
+};
+
+constexpr uint32_t NUM_ALLOC_SITES = static_cast<uint32_t>(AllocSite::Render) + 1;
+
+const char *alloc_site_name(AllocSite site);
+
+constexpr bool alloc_tracking_enabled()
+{
+    return ALLOC_TRACKING;
+}
+
+// Allocations made by the calling thread so far
+uint64_t thread_allocation_count();
+uint64_t thread_allocated_bytes();
+
+struct AllocSiteCounts
+{
+    uint64_t calls = 0;
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+// Totals of each site on the calling thread. Counts are inclusive, so a site
+// called from within another is counted in both.
+AllocSiteCounts get_alloc_site_counts(AllocSite site);
+void reset_alloc_site_counts();
+
+// Adds the allocations made during its lifetime to a site's counts
+class ScopedAllocCounter
+{
+#if ALLOC_TRACKING
+    AllocSite site;
+    uint64_t start_allocations;
+    uint64_t start_bytes;
+
+public:
+    explicit ScopedAllocCounter(AllocSite site);
+    ~ScopedAllocCounter();
+#else
+public:
+    explicit ScopedAllocCounter(AllocSite) {}
+#endif
+    ScopedAllocCounter(const ScopedAllocCounter &) = delete;
+    ScopedAllocCounter &operator=(const ScopedAllocCounter &) = delete;
+};
+
+#endif
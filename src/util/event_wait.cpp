@@ -0,0 +1,37 @@
+#include "./event_wait.h"
+
+#include <SDL/SDL.h>
+
+#include <algorithm>
+
+bool wait_event_timeout(SDL_Event &event, uint32_t timeout_ms, uint32_t pump_interval_ms)
+{
+    uint32_t start_ms = SDL_GetTicks();
+
+    while (true)
+    {
+        SDL_PumpEvents();
+        if (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_ALLEVENTS) > 0)
+        {
+            return true;
+        }
+
+        uint32_t elapsed_ms = SDL_GetTicks() - start_ms;
+        if (elapsed_ms >= timeout_ms)
+        {
+            return false;
+        }
+
+        SDL_Delay(std::min(timeout_ms - elapsed_ms, pump_interval_ms));
+    }
+}
+
+void push_wakeup_event()
+{
+    SDL_Event event;
+    event.type = SDL_USEREVENT;
+    event.user.code = 0;
+    event.user.data1 = nullptr;
+    event.user.data2 = nullptr;
+    SDL_PushEvent(&event);
+}
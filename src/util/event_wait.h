@@ -0,0 +1,16 @@
+#ifndef EVENT_WAIT_H_
+#define EVENT_WAIT_H_
+
+#include <SDL/SDL_events.h>
+
+#include <cstdint>
+
+// Block until an SDL event arrives, or timeout_ms passes. Return true if event was received.
+// SDL 1.2 has no blocking wait with timeout (SDL_WaitEvent itself polls every
+// 10ms), so events are pumped every pump_interval_ms while sleeping.
+bool wait_event_timeout(SDL_Event &event, uint32_t timeout_ms, uint32_t pump_interval_ms);
+
+// Wake a thread blocked in wait_event_timeout. Safe to call from any thread.
+void push_wakeup_event();
+
+#endif
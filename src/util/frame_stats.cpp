@@ -0,0 +1,180 @@
+#include "./frame_stats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+
+namespace
+{
+
+FrameStats *active_stats = nullptr;
+ScopedFrameTimer *innermost_timer = nullptr;
+
+} // namespace
+
+const char *frame_phase_name(FramePhase phase)
+{
+    switch (phase)
+    {
+        case FramePhase::Events:
+            return "events";
+        case FramePhase::Tasks:
+            return "tasks";
+        case FramePhase::Layout:
+            return "layout";
+        case FramePhase::Render:
+            return "render";
+        case FramePhase::Present:
+            return "present";
+        case FramePhase::Total:
+            return "total";
+    }
+    return "unknown";
+}
+
+void FrameStats::add(FramePhase phase, uint32_t micros)
+{
+    current[static_cast<uint32_t>(phase)] += micros;
+}
+
+const FrameTimes &FrameStats::end_frame()
+{
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < NUM_FRAME_PHASES - 1; ++i)
+    {
+        total += current[i];
+    }
+    current[static_cast<uint32_t>(FramePhase::Total)] = total;
+
+    FrameTimes &slot = history[history_pos];
+    slot = current;
+    history_pos = (history_pos + 1) % HISTORY_SIZE;
+    ++frames_recorded;
+
+    current = {};
+    return slot;
+}
+
+void FrameStats::discard_frame()
+{
+    current = {};
+}
+
+uint64_t FrameStats::num_frames() const
+{
+    return frames_recorded;
+}
+
+PhaseSummary FrameStats::summarize(FramePhase phase) const
+{
+    uint32_t count = std::min<uint64_t>(frames_recorded, HISTORY_SIZE);
+    if (count == 0)
+    {
+        return {};
+    }
+
+    std::vector<uint32_t> values;
+    values.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        values.push_back(history[i][static_cast<uint32_t>(phase)]);
+    }
+
+    PhaseSummary summary;
+    summary.p50_us = percentile(values.data(), count, 50);
+    summary.p90_us = percentile(values.data(), count, 90);
+    summary.p99_us = percentile(values.data(), count, 99);
+    summary.max_us = *std::max_element(values.begin(), values.end());
+    return summary;
+}
+
+void FrameStats::write_log_header(std::ostream &os) const
+{
+    os << "frame";
+    for (uint32_t i = 0; i < NUM_FRAME_PHASES; ++i)
+    {
+        os << "," << frame_phase_name(static_cast<FramePhase>(i)) << "_us";
+    }
+    os << "\n";
+}
+
+void FrameStats::write_log_row(std::ostream &os, const FrameTimes &times) const
+{
+    os << frames_recorded;
+    for (uint32_t t : times)
+    {
+        os << "," << t;
+    }
+    os << "\n";
+}
+
+void FrameStats::write_summary(std::ostream &os) const
+{
+    os << "# last " << std::min<uint64_t>(frames_recorded, HISTORY_SIZE) << " of " << frames_recorded << " frames (us)\n";
+    os << "# phase       p50      p90      p99      max\n";
+    for (uint32_t i = 0; i < NUM_FRAME_PHASES; ++i)
+    {
+        FramePhase phase = static_cast<FramePhase>(i);
+        PhaseSummary summary = summarize(phase);
+        os << "# " << std::left << std::setw(8) << frame_phase_name(phase) << std::right
+           << " " << std::setw(8) << summary.p50_us
+           << " " << std::setw(8) << summary.p90_us
+           << " " << std::setw(8) << summary.p99_us
+           << " " << std::setw(8) << summary.max_us
+           << "\n";
+    }
+}
+
+uint32_t percentile(uint32_t *values, uint32_t count, uint32_t pct)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // Nearest rank: smallest value with at least pct% of values <= it
+    uint32_t rank = (std::min<uint32_t>(pct, 100) * count + 99) / 100;
+    uint32_t index = rank > 0 ? rank - 1 : 0;
+
+    std::nth_element(values, values + index, values + count);
+    return values[index];
+}
+
+void set_active_frame_stats(FrameStats *stats)
+{
+    active_stats = stats;
+}
+
+ScopedFrameTimer::ScopedFrameTimer(FramePhase phase)
+    : stats(active_stats),
+      phase(phase)
+{
+    if (!stats)
+    {
+        return;
+    }
+
+    parent = innermost_timer;
+    innermost_timer = this;
+    start = std::chrono::steady_clock::now();
+}
+
+ScopedFrameTimer::~ScopedFrameTimer()
+{
+    if (!stats)
+    {
+        return;
+    }
+
+    uint32_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+
+    stats->add(phase, elapsed_us - std::min(nested_us, elapsed_us));
+    if (parent)
+    {
+        parent->nested_us += elapsed_us;
+    }
+    innermost_timer = parent;
+}
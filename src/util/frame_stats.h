@@ -0,0 +1,88 @@
+#ifndef FRAME_STATS_H_
+#define FRAME_STATS_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+enum class FramePhase
+{
+    Events,
+    Tasks,
+    Layout,
+    Render,
+    Present,
+    Total,  // sum of the other phases, filled in by end_frame()
+};
+
+constexpr uint32_t NUM_FRAME_PHASES = static_cast<uint32_t>(FramePhase::Total) + 1;
+
+const char *frame_phase_name(FramePhase phase);
+
+using FrameTimes = std::array<uint32_t, NUM_FRAME_PHASES>;  // microseconds
+
+struct PhaseSummary
+{
+    uint32_t p50_us = 0;
+    uint32_t p90_us = 0;
+    uint32_t p99_us = 0;
+    uint32_t max_us = 0;
+};
+
+// Per frame timings of each main loop phase, with a rolling history for
+// percentile summaries.
+class FrameStats
+{
+public:
+    static constexpr uint32_t HISTORY_SIZE = 512;
+
+private:
+    FrameTimes current = {};
+
+    std::array<FrameTimes, HISTORY_SIZE> history = {};
+    uint32_t history_pos = 0;
+    uint64_t frames_recorded = 0;
+
+public:
+    void add(FramePhase phase, uint32_t micros);
+
+    // Commit the times accumulated since the last end_frame/discard_frame.
+    const FrameTimes &end_frame();
+    // Drop accumulated times, e.g. for a loop iteration that did nothing.
+    void discard_frame();
+
+    uint64_t num_frames() const;
+    PhaseSummary summarize(FramePhase phase) const;
+
+    void write_log_header(std::ostream &os) const;
+    void write_log_row(std::ostream &os, const FrameTimes &times) const;
+    void write_summary(std::ostream &os) const;
+};
+
+// Nearest-rank percentile (0-100). Reorders values.
+uint32_t percentile(uint32_t *values, uint32_t count, uint32_t pct);
+
+// Stats that ScopedFrameTimer records to, or nullptr to disable timing.
+void set_active_frame_stats(FrameStats *stats);
+
+// Adds the time spent in scope to a phase of the active FrameStats. Time
+// spent in nested timers is only counted towards the innermost phase.
+// Main thread only.
+class ScopedFrameTimer
+{
+    FrameStats *stats;
+    FramePhase phase;
+    ScopedFrameTimer *parent = nullptr;
+    std::chrono::steady_clock::time_point start;
+    uint32_t nested_us = 0;
+
+public:
+    ScopedFrameTimer(FramePhase phase);
+    ~ScopedFrameTimer();
+
+    ScopedFrameTimer(const ScopedFrameTimer &) = delete;
+    ScopedFrameTimer &operator=(const ScopedFrameTimer &) = delete;
+};
+
+#endif
@@ -0,0 +1,240 @@
+#include "./glyph_atlas.h"
+
+#include "./lru_cache.h"
+#include "./utf8.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace
+{
+
+// SDL_ttf glyphs are addressed by UCS-2 character
+constexpr uint16_t REPLACEMENT_CHAR = 0xFFFD;
+
+uint16_t next_char(const char *&s, const char *end)
+{
+    uint32_t num_bytes;
+    uint32_t cp = utf8_decode(s, end, num_bytes);
+    s += num_bytes;
+    return (cp == 0 || cp > 0xFFFF) ? REPLACEMENT_CHAR : cp;
+}
+
+SDL_Rect intersect(const SDL_Rect &a, const SDL_Rect &b)
+{
+    int x0 = std::max<int>(a.x, b.x);
+    int y0 = std::max<int>(a.y, b.y);
+    int x1 = std::min<int>(a.x + a.w, b.x + b.w);
+    int y1 = std::min<int>(a.y + a.h, b.y + b.h);
+    return {
+        static_cast<Sint16>(x0),
+        static_cast<Sint16>(y0),
+        static_cast<Uint16>(std::max(x1 - x0, 0)),
+        static_cast<Uint16>(std::max(y1 - y0, 0))
+    };
+}
+
+} // namespace
+
+GlyphAtlas::GlyphAtlas(TTF_Font *font, SDL_Color fg, SDL_Color bg)
+    : font(font),
+      fg(fg),
+      bg(bg),
+      ascent(TTF_FontAscent(font)),
+      height(TTF_FontHeight(font)),
+      use_kerning(TTF_GetFontKerning(font))
+{
+}
+
+int GlyphAtlas::get_height() const
+{
+    return height;
+}
+
+const GlyphAtlas::Glyph &GlyphAtlas::get_glyph(uint16_t ch)
+{
+    auto it = glyphs.find(ch);
+    if (it != glyphs.end())
+    {
+        return it->second;
+    }
+
+    if (glyphs.size() >= GLYPH_ATLAS_MAX_GLYPHS)
+    {
+        glyphs.clear();
+    }
+
+    Glyph glyph;
+    int miny;
+    if (TTF_GlyphMetrics(font, ch, &glyph.minx, &glyph.maxx, &miny, &glyph.maxy, &glyph.advance) == 0)
+    {
+        // Palettized, with the background at index 0
+        glyph.surface = surface_unique_ptr { TTF_RenderGlyph_Shaded(font, ch, fg, bg) };
+        if (glyph.surface)
+        {
+            SDL_SetColorKey(glyph.surface.get(), SDL_SRCCOLORKEY | SDL_RLEACCEL, 0);
+        }
+    }
+
+    return glyphs.emplace(ch, std::move(glyph)).first->second;
+}
+
+int GlyphAtlas::get_kerning(uint16_t prev, uint16_t ch)
+{
+    if (!use_kerning)
+    {
+        return 0;
+    }
+
+    uint32_t key = (static_cast<uint32_t>(prev) << 16) | ch;
+    auto it = kerning.find(key);
+    if (it != kerning.end())
+    {
+        return it->second;
+    }
+
+    if (kerning.size() >= GLYPH_ATLAS_MAX_GLYPHS * 8)
+    {
+        kerning.clear();
+    }
+
+    // SDL_ttf 2.0 has no kerning query, so take the difference between the
+    // pair as measured by SDL_ttf and the pair laid out without kerning
+    char pair[8];
+    uint16_t chars[2] = {prev, ch};
+    char *p = pair;
+    for (uint16_t c : chars)
+    {
+        if (c < 0x80)
+        {
+            *p++ = c;
+        }
+        else if (c < 0x800)
+        {
+            *p++ = 0xC0 | (c >> 6);
+            *p++ = 0x80 | (c & 0x3F);
+        }
+        else
+        {
+            *p++ = 0xE0 | (c >> 12);
+            *p++ = 0x80 | ((c >> 6) & 0x3F);
+            *p++ = 0x80 | (c & 0x3F);
+        }
+    }
+    *p = 0;
+
+    int kerned_w = 0, h = 0;
+    TTF_SizeUTF8(font, pair, &kerned_w, &h);
+
+    // Extents as in layout(), so the first glyph's overhangs cancel out
+    // (copied, as fetching the second glyph can evict the first)
+    const Glyph &first_glyph = get_glyph(prev);
+    int first_minx = first_glyph.minx;
+    int first_maxx = first_glyph.maxx;
+    int first_advance = first_glyph.advance;
+    const Glyph &second = get_glyph(ch);
+    int min_x = std::min({0, first_minx, first_advance + second.minx});
+    int max_x = std::max({first_advance, first_maxx, first_advance + std::max(second.advance, second.maxx)});
+    int unkerned_w = max_x - min_x;
+
+    int value = kerned_w - unkerned_w;
+    kerning.emplace(key, value);
+    return value;
+}
+
+template <typename F>
+int GlyphAtlas::layout(const char *str, F on_glyph)
+{
+    // Same extents as TTF_SizeUTF8: glyphs may reach left of the pen or past
+    // their advance
+    const char *end = str + strlen(str);
+    int x = 0;
+    int min_x = 0;
+    int max_x = 0;
+    uint16_t prev = 0;
+
+    while (str < end)
+    {
+        uint16_t ch = next_char(str, end);
+        if (prev)
+        {
+            x += get_kerning(prev, ch);
+        }
+
+        const Glyph &glyph = get_glyph(ch);
+        min_x = std::min(min_x, x + glyph.minx);
+        max_x = std::max(max_x, x + std::max(glyph.advance, glyph.maxx));
+        on_glyph(glyph, x);
+
+        x += glyph.advance;
+        prev = ch;
+    }
+
+    return max_x - min_x;
+}
+
+int GlyphAtlas::get_text_width(const char *str)
+{
+    return layout(str, [](const Glyph &, int) {});
+}
+
+int GlyphAtlas::render(const char *str, SDL_Surface *dest, Sint16 x, Sint16 y, int max_width)
+{
+    // Glyphs left of the pen start shift the line right, as in SDL_ttf
+    int left_overhang = 0;
+    int width = layout(str, [&left_overhang](const Glyph &glyph, int pen_x) {
+        left_overhang = std::max(left_overhang, -(pen_x + glyph.minx));
+    });
+    if (max_width >= 0)
+    {
+        width = std::min(width, max_width);
+    }
+
+    SDL_Rect box = {x, y, static_cast<Uint16>(width), static_cast<Uint16>(height)};
+    SDL_FillRect(dest, &box, SDL_MapRGB(dest->format, bg.r, bg.g, bg.b));
+
+    SDL_Rect prev_clip;
+    SDL_GetClipRect(dest, &prev_clip);
+    SDL_Rect clip = intersect(prev_clip, box);
+    SDL_SetClipRect(dest, &clip);
+
+    layout(str, [&](const Glyph &glyph, int pen_x) {
+        if (glyph.surface)
+        {
+            SDL_Rect dest_rect = {
+                static_cast<Sint16>(x + left_overhang + pen_x + glyph.minx),
+                static_cast<Sint16>(y + ascent - glyph.maxy),
+                0, 0
+            };
+            SDL_BlitSurface(glyph.surface.get(), nullptr, dest, &dest_rect);
+        }
+    });
+
+    SDL_SetClipRect(dest, &prev_clip);
+
+    return width;
+}
+
+GlyphAtlas &cached_glyph_atlas(TTF_Font *font, SDL_Color fg, SDL_Color bg)
+{
+    static LRUCache<std::string, std::unique_ptr<GlyphAtlas>> atlases;
+
+    // Short enough to stay in the string's inline buffer
+    std::string key(reinterpret_cast<const char *>(&font), sizeof(font));
+    key.append({static_cast<char>(fg.r), static_cast<char>(fg.g), static_cast<char>(fg.b)});
+    key.append({static_cast<char>(bg.r), static_cast<char>(bg.g), static_cast<char>(bg.b)});
+
+    if (atlases.has(key))
+    {
+        return *atlases[key];
+    }
+
+    while (atlases.size() >= GLYPH_ATLAS_CACHE_SIZE)
+    {
+        atlases.pop();
+    }
+    atlases.put(key, std::make_unique<GlyphAtlas>(font, fg, bg));
+    return *atlases[key];
+}
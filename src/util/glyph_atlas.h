@@ -0,0 +1,67 @@
+#ifndef GLYPH_ATLAS_H_
+#define GLYPH_ATLAS_H_
+
+#include "./sdl_pointer.h"
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+#define GLYPH_ATLAS_MAX_GLYPHS 1024
+#define GLYPH_ATLAS_CACHE_SIZE 16
+
+// Glyphs of one font and color pair, rasterized once and blitted to compose
+// text, rather than rendering every string to a new surface with
+// TTF_RenderUTF8_Shaded.
+class GlyphAtlas
+{
+    struct Glyph
+    {
+        surface_unique_ptr surface;  // null for glyphs with no pixels
+        int minx = 0;
+        int maxx = 0;
+        int maxy = 0;
+        int advance = 0;
+    };
+
+    TTF_Font *font;
+    SDL_Color fg;
+    SDL_Color bg;
+    int ascent;
+    int height;
+    bool use_kerning;
+
+    std::unordered_map<uint16_t, Glyph> glyphs;
+    std::unordered_map<uint32_t, int> kerning;  // keyed by pair of characters
+
+    const Glyph &get_glyph(uint16_t ch);
+    int get_kerning(uint16_t prev, uint16_t ch);
+
+    // Call on_glyph with each glyph of str and its pen position, returning the
+    // width of the box the text is drawn in
+    template <typename F>
+    int layout(const char *str, F on_glyph);
+
+public:
+    GlyphAtlas(TTF_Font *font, SDL_Color fg, SDL_Color bg);
+    GlyphAtlas(const GlyphAtlas &) = delete;
+    GlyphAtlas &operator=(const GlyphAtlas &) = delete;
+
+    int get_height() const;
+
+    // Width of str, matching TTF_SizeUTF8
+    int get_text_width(const char *str);
+
+    // Draw str with its box's top left at (x, y), as a TTF_RenderUTF8_Shaded
+    // surface blitted there would look. The box is filled with the background
+    // color and cut off after max_width, if given. Returns the box width.
+    int render(const char *str, SDL_Surface *dest, Sint16 x, Sint16 y, int max_width = -1);
+};
+
+// Shared atlas for the font and colors. Only valid until the next call, as
+// the least recently used atlases are dropped.
+GlyphAtlas &cached_glyph_atlas(TTF_Font *font, SDL_Color fg, SDL_Color bg);
+
+#endif
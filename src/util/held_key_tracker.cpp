@@ -34,6 +34,18 @@ void HeldKeyTracker::accumulate(uint32_t ms)
     }
 }
 
+bool HeldKeyTracker::any_held() const
+{
+    for (uint32_t time : held_times)
+    {
+        if (time)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool HeldKeyTracker::for_longest_held(const std::function<void(SDLKey, uint32_t)> &callback)
 {
     uint32_t longest_time = 0;
@@ -16,6 +16,8 @@ public:
     virtual ~HeldKeyTracker();
 
     void accumulate(uint32_t ms);
+    // True if any tracked key was held at last accumulate
+    bool any_held() const;
     bool for_longest_held(const std::function<void(SDLKey, uint32_t)> &callback);
 };
 
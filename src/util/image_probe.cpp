@@ -0,0 +1,119 @@
+#include "./image_probe.h"
+
+#include <cstring>
+
+namespace
+{
+
+uint32_t read_u16_be(const unsigned char *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+uint32_t read_u16_le(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t read_u32_be(const unsigned char *p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+std::optional<ImageSize> probe_png_size(const unsigned char *data, uint32_t size)
+{
+    // Signature, then IHDR must be the first chunk
+    static const unsigned char signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    if (size < 24 || memcmp(data, signature, sizeof(signature)) != 0 || memcmp(data + 12, "IHDR", 4) != 0)
+    {
+        return std::nullopt;
+    }
+    return ImageSize{read_u32_be(data + 16), read_u32_be(data + 20)};
+}
+
+std::optional<ImageSize> probe_gif_size(const unsigned char *data, uint32_t size)
+{
+    if (size < 10 || (memcmp(data, "GIF87a", 6) != 0 && memcmp(data, "GIF89a", 6) != 0))
+    {
+        return std::nullopt;
+    }
+    return ImageSize{read_u16_le(data + 6), read_u16_le(data + 8)};
+}
+
+bool is_jpeg_frame_marker(unsigned char marker)
+{
+    // SOF0-SOF15, except DHT, JPG and DAC which share the range
+    return marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc;
+}
+
+std::optional<ImageSize> probe_jpeg_size(const unsigned char *data, uint32_t size)
+{
+    if (size < 4 || data[0] != 0xff || data[1] != 0xd8)
+    {
+        return std::nullopt;
+    }
+
+    // Walk the segments up to the frame header. Metadata segments such as
+    // exif may come first, so the header isn't at a fixed offset.
+    uint32_t pos = 2;
+    while (pos + 4 <= size)
+    {
+        if (data[pos] != 0xff)
+        {
+            return std::nullopt;
+        }
+
+        unsigned char marker = data[pos + 1];
+        if (marker == 0xff)
+        {
+            ++pos;  // fill byte
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7))
+        {
+            pos += 2;  // no length
+            continue;
+        }
+        if (marker == 0xd9 || marker == 0xda)
+        {
+            return std::nullopt;  // end of image or start of scan data, without a frame
+        }
+
+        uint32_t segment_len = read_u16_be(data + pos + 2);
+        if (is_jpeg_frame_marker(marker))
+        {
+            // Length, precision, then height before width
+            if (segment_len < 7 || pos + 9 > size)
+            {
+                return std::nullopt;
+            }
+            return ImageSize{read_u16_be(data + pos + 7), read_u16_be(data + pos + 5)};
+        }
+
+        pos += 2 + segment_len;
+    }
+
+    return std::nullopt;
+}
+
+} // namespace
+
+std::optional<ImageSize> probe_image_size(const char *data, uint32_t size)
+{
+    const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+
+    std::optional<ImageSize> image_size = probe_png_size(bytes, size);
+    if (!image_size)
+    {
+        image_size = probe_jpeg_size(bytes, size);
+    }
+    if (!image_size)
+    {
+        image_size = probe_gif_size(bytes, size);
+    }
+    if (image_size && image_size->width && image_size->height)
+    {
+        return image_size;
+    }
+    return std::nullopt;
+}
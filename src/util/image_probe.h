@@ -0,0 +1,17 @@
+#ifndef IMAGE_PROBE_H_
+#define IMAGE_PROBE_H_
+
+#include <cstdint>
+#include <optional>
+
+struct ImageSize
+{
+    uint32_t width;
+    uint32_t height;
+};
+
+// Read image dimensions from the file header, without decoding. Only the
+// leading bytes are needed. Nullopt if the format isn't recognized.
+std::optional<ImageSize> probe_image_size(const char *data, uint32_t size);
+
+#endif
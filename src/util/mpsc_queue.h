@@ -0,0 +1,84 @@
+#ifndef MPSC_QUEUE_H_
+#define MPSC_QUEUE_H_
+
+#include <atomic>
+#include <utility>
+
+// Lock-free multi-producer, single-consumer queue.
+// Producers push onto an atomic stack, and the consumer takes the whole stack
+// at once and reverses it to recover FIFO order.
+template <typename T>
+class MPSCQueue
+{
+    struct Node
+    {
+        T value;
+        Node *next;
+    };
+
+    std::atomic<Node *> head {nullptr};
+
+    static void free_nodes(Node *node)
+    {
+        while (node)
+        {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+public:
+    MPSCQueue() = default;
+    MPSCQueue(const MPSCQueue &) = delete;
+    MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+    ~MPSCQueue()
+    {
+        free_nodes(head.exchange(nullptr));
+    }
+
+    // Safe to call from any thread.
+    void push(T value)
+    {
+        Node *node = new Node {std::move(value), head.load(std::memory_order_relaxed)};
+        while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == nullptr;
+    }
+
+    // Consumer thread only. Pop all available items in push order.
+    // Return true if any items were consumed.
+    template <typename F>
+    bool consume_all(F &&callback)
+    {
+        Node *node = head.exchange(nullptr, std::memory_order_acquire);
+        if (!node)
+        {
+            return false;
+        }
+
+        // Reverse to get FIFO order
+        Node *reversed = nullptr;
+        while (node)
+        {
+            Node *next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+
+        for (Node *it = reversed; it; it = it->next)
+        {
+            callback(it->value);
+        }
+        free_nodes(reversed);
+
+        return true;
+    }
+};
+
+#endif
@@ -1,8 +1,28 @@
 #include "./string_serialization.h"
 
+#include <array>
 #include <sstream>
 #include <stdexcept>
 
+namespace
+{
+
+constexpr const char *BASE64_CHARS = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr uint8_t BASE64_INVALID = 0xFF;
+
+std::array<uint8_t, 256> make_base64_lookup()
+{
+    std::array<uint8_t, 256> lookup;
+    lookup.fill(BASE64_INVALID);
+    for (uint8_t i = 0; i < 64; ++i)
+    {
+        lookup[static_cast<uint8_t>(BASE64_CHARS[i])] = i;
+    }
+    return lookup;
+}
+
+} // namespace
+
 std::optional<uint32_t> try_decode_uint(const std::string &str)
 {
     try
@@ -47,3 +67,135 @@ std::string encode_uint_vector(const std::vector<uint32_t> &numbers)
 
     return ss.str();
 }
+
+std::string encode_base64(const std::string &data)
+{
+    std::string result;
+    result.reserve((data.size() + 2) / 3 * 4);
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data.data());
+    uint32_t n = data.size();
+    uint32_t i = 0;
+    for (; i + 2 < n; i += 3)
+    {
+        uint32_t triple = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+        result.push_back(BASE64_CHARS[(triple >> 18) & 0x3F]);
+        result.push_back(BASE64_CHARS[(triple >> 12) & 0x3F]);
+        result.push_back(BASE64_CHARS[(triple >> 6) & 0x3F]);
+        result.push_back(BASE64_CHARS[triple & 0x3F]);
+    }
+
+    uint32_t remaining = n - i;
+    if (remaining)
+    {
+        uint32_t triple = (bytes[i] << 16) | (remaining == 2 ? bytes[i + 1] << 8 : 0);
+        result.push_back(BASE64_CHARS[(triple >> 18) & 0x3F]);
+        result.push_back(BASE64_CHARS[(triple >> 12) & 0x3F]);
+        result.push_back(remaining == 2 ? BASE64_CHARS[(triple >> 6) & 0x3F] : '=');
+        result.push_back('=');
+    }
+
+    return result;
+}
+
+bool try_decode_base64(const std::string &encoded, std::string &out)
+{
+    static const std::array<uint8_t, 256> lookup = make_base64_lookup();
+
+    uint32_t n = encoded.size();
+    if (n % 4 != 0)
+    {
+        return false;
+    }
+
+    uint32_t padding = 0;
+    if (n && encoded[n - 1] == '=') ++padding;
+    if (n > 1 && encoded[n - 2] == '=') ++padding;
+
+    out.reserve(out.size() + n / 4 * 3);
+
+    const uint8_t *chars = reinterpret_cast<const uint8_t *>(encoded.data());
+    for (uint32_t i = 0; i < n; i += 4)
+    {
+        bool is_last = i + 4 == n;
+        uint32_t num_chars = is_last ? 4 - padding : 4;
+
+        uint32_t triple = 0;
+        for (uint32_t j = 0; j < 4; ++j)
+        {
+            uint8_t value = 0;
+            if (j < num_chars)
+            {
+                value = lookup[chars[i + j]];
+                if (value == BASE64_INVALID)
+                {
+                    return false;
+                }
+            }
+            triple = (triple << 6) | value;
+        }
+
+        out.push_back(static_cast<char>((triple >> 16) & 0xFF));
+        if (num_chars > 2) out.push_back(static_cast<char>((triple >> 8) & 0xFF));
+        if (num_chars > 3) out.push_back(static_cast<char>(triple & 0xFF));
+    }
+
+    return true;
+}
+
+bool try_decode_uint_vector_base64(const std::string &encoded, std::vector<uint32_t> &out)
+{
+    std::string bytes;
+    if (!try_decode_base64(encoded, bytes))
+    {
+        return false;
+    }
+
+    uint32_t value = 0;
+    uint32_t shift = 0;
+    for (char c : bytes)
+    {
+        uint8_t byte = static_cast<uint8_t>(c);
+        if (shift >= 32)
+        {
+            return false;  // too many continuation bytes for a uint32_t
+        }
+        if (shift == 28 && (byte & 0x70))
+        {
+            return false;  // last byte holds only the top 4 bits
+        }
+
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80)
+        {
+            shift += 7;
+        }
+        else
+        {
+            out.emplace_back(value);
+            value = 0;
+            shift = 0;
+        }
+    }
+
+    // Must not end in the middle of a number
+    return shift == 0;
+}
+
+std::string encode_uint_vector_base64(const std::vector<uint32_t> &numbers)
+{
+    std::string bytes;
+    bytes.reserve(numbers.size() * 3);
+
+    for (uint32_t value : numbers)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<char>(value));
+    }
+
+    return encode_base64(bytes);
+}
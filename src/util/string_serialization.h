@@ -10,4 +10,12 @@ std::optional<uint32_t> try_decode_uint(const std::string &str);
 bool try_decode_uint_vector(std::string encoded, std::vector<uint32_t> &out);
 std::string encode_uint_vector(const std::vector<uint32_t> &numbers);
 
+// Standard base64 (with padding), safe for storing binary data in key-value files
+std::string encode_base64(const std::string &data);
+bool try_decode_base64(const std::string &encoded, std::string &out);
+
+// Compact encoding: LEB128 varints, wrapped in base64
+bool try_decode_uint_vector_base64(const std::string &encoded, std::vector<uint32_t> &out);
+std::string encode_uint_vector_base64(const std::vector<uint32_t> &numbers);
+
 #endif
@@ -1,22 +1,170 @@
 #include "./task_queue.h"
 
-TaskQueue::TaskQueue()
+CancelToken::CancelToken()
+    : cancelled(std::make_shared<std::atomic<bool>>(false))
 {
 }
 
+void CancelToken::cancel()
+{
+    cancelled->store(true);
+}
+
+bool CancelToken::is_cancelled() const
+{
+    return cancelled->load();
+}
+
+bool TaskQueue::BackgroundTask::operator<(const BackgroundTask &other) const
+{
+    // priority_queue pops the largest element: highest priority, then oldest
+    if (priority != other.priority)
+    {
+        return priority < other.priority;
+    }
+    return sequence > other.sequence;
+}
+
+TaskQueue::TaskQueue(uint32_t num_workers)
+{
+    for (uint32_t i = 0; i < num_workers; ++i)
+    {
+        workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
 TaskQueue::~TaskQueue()
 {
+    shutdown();
     drain();
 }
 
+uint32_t TaskQueue::default_num_workers()
+{
+    uint32_t num_cores = std::thread::hardware_concurrency();
+    return num_cores > 2 ? num_cores - 1 : 1;
+}
+
+void TaskQueue::worker_loop()
+{
+    while (true)
+    {
+        BackgroundTask task;
+        {
+            std::unique_lock<std::mutex> lock(background_mutex);
+            background_cv.wait(lock, [this]() { return stopping || !background_queue.empty(); });
+            if (stopping)
+            {
+                return;
+            }
+
+            task = background_queue.top();
+            background_queue.pop();
+        }
+
+        if (!task.token.is_cancelled())
+        {
+            task.work();
+        }
+
+        if (task.on_complete && !task.token.is_cancelled())
+        {
+            completions.push(Completion {std::move(task.on_complete), task.token});
+            --num_in_flight;
+            notify_completion_ready();
+        }
+        else
+        {
+            --num_in_flight;
+        }
+    }
+}
+
 void TaskQueue::submit(task_func task)
 {
     queue.push(task);
 }
 
+void TaskQueue::submit_background(task_func work, task_func on_complete, TaskPriority priority, CancelToken token)
+{
+    {
+        std::lock_guard<std::mutex> lock(background_mutex);
+        if (stopping)
+        {
+            return;
+        }
+        ++num_in_flight;
+        background_queue.push(BackgroundTask {
+            priority,
+            next_sequence++,
+            std::move(work),
+            std::move(on_complete),
+            std::move(token)
+        });
+    }
+    background_cv.notify_one();
+}
+
+void TaskQueue::post(task_func task)
+{
+    completions.push(Completion {std::move(task), CancelToken()});
+    notify_completion_ready();
+}
+
+void TaskQueue::notify_completion_ready()
+{
+    // Copied under the lock, as the main thread may replace it at any time
+    std::function<void()> callback;
+    {
+        std::lock_guard<std::mutex> lock(background_mutex);
+        callback = on_completion_ready;
+    }
+    if (callback)
+    {
+        callback();
+    }
+}
+
+void TaskQueue::set_on_completion_ready(std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> lock(background_mutex);
+    on_completion_ready = std::move(callback);
+}
+
+void TaskQueue::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(background_mutex);
+        stopping = true;
+    }
+    background_cv.notify_all();
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+
+    // Tasks no worker got to are dropped, so they no longer count as pending
+    num_in_flight -= background_queue.size();
+    background_queue = {};
+    completions.consume_all([](Completion &) {});
+}
+
+uint32_t TaskQueue::background_tasks_pending() const
+{
+    return num_in_flight.load();
+}
+
 bool TaskQueue::drain()
 {
-    bool ran_task = false;
+    bool ran_task = completions.consume_all([](Completion &completion) {
+        if (!completion.token.is_cancelled())
+        {
+            completion.on_complete();
+        }
+    });
+
     while (!queue.empty())
     {
         queue.front()();
@@ -1,24 +1,120 @@
 #ifndef TASK_QUEUE_H_
 #define TASK_QUEUE_H_
 
+#include "./mpsc_queue.h"
+
+#include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <thread>
+#include <vector>
 
 using task_func = typename std::function<void()>;
 
+enum class TaskPriority
+{
+    Low,
+    Normal,
+    High,
+};
+
+// Shared flag to abandon submitted background work. Copies refer to the same flag.
+class CancelToken
+{
+    std::shared_ptr<std::atomic<bool>> cancelled;
+
+public:
+    CancelToken();
+
+    void cancel();
+    bool is_cancelled() const;
+};
+
+// Runs tasks on the main thread (submit), or on a pool of worker threads with
+// a completion callback delivered back to the main thread (submit_background).
+// Completions and main thread tasks run during drain(). On shutdown or
+// destruction, tasks already running finish, but queued background tasks are
+// dropped unrun.
 class TaskQueue
 {
+    struct BackgroundTask
+    {
+        TaskPriority priority;
+        uint64_t sequence;
+        task_func work;
+        task_func on_complete;
+        CancelToken token;
+
+        bool operator<(const BackgroundTask &other) const;
+    };
+
+    struct Completion
+    {
+        task_func on_complete;
+        CancelToken token;
+    };
+
     std::queue<task_func> queue;
 
+    std::mutex background_mutex;
+    std::condition_variable background_cv;
+    std::priority_queue<BackgroundTask> background_queue;
+    uint64_t next_sequence = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    MPSCQueue<Completion> completions;
+    std::atomic<uint32_t> num_in_flight {0};
+    std::function<void()> on_completion_ready;  // guarded by background_mutex
+
+    void worker_loop();
+    void notify_completion_ready();
+
 public:
 
-    TaskQueue();
+    TaskQueue(uint32_t num_workers = default_num_workers());
+    TaskQueue(const TaskQueue &) = delete;
+    TaskQueue &operator=(const TaskQueue &) = delete;
     virtual ~TaskQueue();
 
+    // Leave one core for the UI thread (e.g. 1 worker on a dual-core device).
+    static uint32_t default_num_workers();
+
+    // Run task on the main thread during the next drain.
     void submit(task_func task);
-    
+
+    // Run work on a worker thread, then on_complete on the main thread during drain.
+    // Neither runs if the token is cancelled first, or if the queue is destroyed
+    // before a worker picks it up, so work that must happen (e.g. saving) needs
+    // a fallback of its own.
+    void submit_background(
+        task_func work,
+        task_func on_complete = nullptr,
+        TaskPriority priority = TaskPriority::Normal,
+        CancelToken token = CancelToken()
+    );
+
+    // Run task on the main thread during drain. Safe to call from any thread.
+    void post(task_func task);
+
+    // Called from a worker thread whenever a completion is queued. Used to wake the main loop.
+    // May be replaced at any time, but a call already started on a worker may
+    // still finish with the previous callback.
+    void set_on_completion_ready(std::function<void()> callback);
+
+    // Number of background tasks queued or running
+    uint32_t background_tasks_pending() const;
+
     // Return true if ran tasks
     bool drain();
+
+    // Wait for running background tasks, dropping queued ones and undelivered
+    // completions, which release what they hold. For use before tearing down
+    // libraries the workers use. Nothing more runs in the background after.
+    void shutdown();
 };
 
 #endif
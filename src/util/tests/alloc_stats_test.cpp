@@ -0,0 +1,67 @@
+#include "../alloc_stats.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+TEST(ALLOC_STATS, counts_thread_allocations)
+{
+    if (!alloc_tracking_enabled())
+    {
+        GTEST_SKIP() << "Built without ALLOC_TRACKING";
+    }
+
+    uint64_t start_count = thread_allocation_count();
+    uint64_t start_bytes = thread_allocated_bytes();
+    auto value = std::make_unique<uint64_t>(1);
+    ASSERT_EQ(thread_allocation_count() - start_count, 1);
+    ASSERT_EQ(thread_allocated_bytes() - start_bytes, sizeof(uint64_t));
+}
+
+TEST(ALLOC_STATS, scoped_counters_are_inclusive)
+{
+    if (!alloc_tracking_enabled())
+    {
+        GTEST_SKIP() << "Built without ALLOC_TRACKING";
+    }
+
+    reset_alloc_site_counts();
+    {
+        ScopedAllocCounter outer(AllocSite::LayoutLines);
+        std::vector<int> a(4);
+        {
+            ScopedAllocCounter inner(AllocSite::WrapLines);
+            std::vector<int> b(8);
+            std::vector<int> c(8);
+        }
+    }
+
+    AllocSiteCounts outer = get_alloc_site_counts(AllocSite::LayoutLines);
+    AllocSiteCounts inner = get_alloc_site_counts(AllocSite::WrapLines);
+    ASSERT_EQ(outer.calls, 1);
+    ASSERT_EQ(outer.allocations, 3);
+    ASSERT_EQ(outer.bytes, 20 * sizeof(int));
+    ASSERT_EQ(inner.calls, 1);
+    ASSERT_EQ(inner.allocations, 2);
+    ASSERT_EQ(inner.bytes, 16 * sizeof(int));
+    ASSERT_EQ(get_alloc_site_counts(AllocSite::Render).calls, 0);
+
+    reset_alloc_site_counts();
+    ASSERT_EQ(get_alloc_site_counts(AllocSite::LayoutLines).calls, 0);
+}
+
+TEST(ALLOC_STATS, disabled_counts_nothing)
+{
+    if (alloc_tracking_enabled())
+    {
+        GTEST_SKIP() << "Built with ALLOC_TRACKING";
+    }
+
+    {
+        ScopedAllocCounter counter(AllocSite::Render);
+        std::vector<int> a(4);
+    }
+    ASSERT_EQ(thread_allocation_count(), 0);
+    ASSERT_EQ(get_alloc_site_counts(AllocSite::Render).calls, 0);
+}
@@ -0,0 +1,123 @@
+#include "../frame_stats.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <sstream>
+#include <vector>
+
+TEST(FRAME_STATS, percentile_nearest_rank)
+{
+    std::vector<uint32_t> values(100);
+    std::iota(values.rbegin(), values.rend(), 1);  // 100..1
+
+    ASSERT_EQ(percentile(values.data(), values.size(), 50), 50);
+    ASSERT_EQ(percentile(values.data(), values.size(), 90), 90);
+    ASSERT_EQ(percentile(values.data(), values.size(), 99), 99);
+    ASSERT_EQ(percentile(values.data(), values.size(), 100), 100);
+    ASSERT_EQ(percentile(values.data(), values.size(), 0), 1);
+}
+
+TEST(FRAME_STATS, percentile_small_sets)
+{
+    std::vector<uint32_t> one = {7};
+    ASSERT_EQ(percentile(one.data(), one.size(), 50), 7);
+    ASSERT_EQ(percentile(one.data(), one.size(), 99), 7);
+
+    std::vector<uint32_t> three = {30, 10, 20};
+    ASSERT_EQ(percentile(three.data(), three.size(), 50), 20);
+    ASSERT_EQ(percentile(three.data(), three.size(), 90), 30);
+
+    ASSERT_EQ(percentile(nullptr, 0, 50), 0);
+}
+
+TEST(FRAME_STATS, end_frame_totals_phases)
+{
+    FrameStats stats;
+    stats.add(FramePhase::Events, 10);
+    stats.add(FramePhase::Layout, 20);
+    stats.add(FramePhase::Layout, 5);
+    stats.add(FramePhase::Present, 100);
+
+    const FrameTimes &times = stats.end_frame();
+    ASSERT_EQ(times[static_cast<uint32_t>(FramePhase::Layout)], 25);
+    ASSERT_EQ(times[static_cast<uint32_t>(FramePhase::Total)], 135);
+    ASSERT_EQ(stats.num_frames(), 1);
+
+    // Discarded frames don't leak into the next one
+    stats.add(FramePhase::Render, 1000);
+    stats.discard_frame();
+    stats.add(FramePhase::Render, 1);
+    ASSERT_EQ(stats.end_frame()[static_cast<uint32_t>(FramePhase::Total)], 1);
+    ASSERT_EQ(stats.num_frames(), 2);
+}
+
+TEST(FRAME_STATS, summary_uses_recent_history)
+{
+    FrameStats stats;
+    ASSERT_EQ(stats.summarize(FramePhase::Total).max_us, 0);
+
+    // Old slow frames fall out of the history window
+    for (uint32_t i = 0; i < FrameStats::HISTORY_SIZE; ++i)
+    {
+        stats.add(FramePhase::Render, 5000);
+        stats.end_frame();
+    }
+    for (uint32_t i = 0; i < FrameStats::HISTORY_SIZE; ++i)
+    {
+        stats.add(FramePhase::Render, i + 1);
+        stats.end_frame();
+    }
+
+    PhaseSummary summary = stats.summarize(FramePhase::Render);
+    ASSERT_EQ(summary.p50_us, FrameStats::HISTORY_SIZE / 2);
+    ASSERT_EQ(summary.max_us, FrameStats::HISTORY_SIZE);
+    ASSERT_EQ(stats.summarize(FramePhase::Events).p99_us, 0);
+}
+
+TEST(FRAME_STATS, scoped_timer_inactive_without_stats)
+{
+    FrameStats stats;
+    set_active_frame_stats(nullptr);
+    {
+        ScopedFrameTimer timer(FramePhase::Render);
+    }
+    ASSERT_EQ(stats.end_frame()[static_cast<uint32_t>(FramePhase::Total)], 0);
+}
+
+TEST(FRAME_STATS, scoped_timer_excludes_nested_time)
+{
+    FrameStats stats;
+    set_active_frame_stats(&stats);
+    {
+        ScopedFrameTimer outer(FramePhase::Render);
+        {
+            ScopedFrameTimer inner(FramePhase::Layout);
+            volatile uint32_t sink = 0;
+            for (uint32_t i = 0; i < 1000000; ++i)
+            {
+                sink = sink + i;
+            }
+        }
+    }
+    set_active_frame_stats(nullptr);
+
+    const FrameTimes &times = stats.end_frame();
+    uint32_t layout_us = times[static_cast<uint32_t>(FramePhase::Layout)];
+    uint32_t render_us = times[static_cast<uint32_t>(FramePhase::Render)];
+
+    ASSERT_GT(layout_us, 0);
+    ASSERT_EQ(times[static_cast<uint32_t>(FramePhase::Total)], layout_us + render_us);
+}
+
+TEST(FRAME_STATS, log_rows_match_header)
+{
+    FrameStats stats;
+    stats.add(FramePhase::Tasks, 3);
+
+    std::ostringstream os;
+    stats.write_log_header(os);
+    stats.write_log_row(os, stats.end_frame());
+
+    ASSERT_EQ(os.str(), "frame,events_us,tasks_us,layout_us,render_us,present_us,total_us\n1,0,3,0,0,0,3\n");
+}
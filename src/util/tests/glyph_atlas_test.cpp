@@ -0,0 +1,78 @@
+#include "../glyph_atlas.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace
+{
+
+// Relative to the repo root, where the tests are run from
+constexpr const char *TEST_FONT = "resources/fonts/DejaVuSerif.ttf";
+
+struct FontCloser
+{
+    void operator()(TTF_Font *font) const
+    {
+        TTF_CloseFont(font);
+    }
+};
+
+std::unique_ptr<TTF_Font, FontCloser> open_test_font(int size)
+{
+    if (!TTF_WasInit() && TTF_Init() != 0)
+    {
+        return nullptr;
+    }
+    return std::unique_ptr<TTF_Font, FontCloser>(TTF_OpenFont(TEST_FONT, size));
+}
+
+// Glyphs reaching left of the pen (j) or past their advance (f), kerned pairs
+// and non-ascii
+const char *SAMPLE_TEXT[] = {
+    "j", "f", "jj", "ff", "fj", "jf", "(j", "f)", "Lj", "AV", "AVAVA", "T.", "Yo",
+    "fjord", "jejune", "the fjord's jaunty falls", "ƒjäf", "Ŧj",
+};
+
+} // namespace
+
+TEST(GLYPH_ATLAS, text_width_matches_sdl_ttf)
+{
+    auto font = open_test_font(24);
+    if (!font)
+    {
+        GTEST_SKIP() << "Can't load " << TEST_FONT;
+    }
+
+    for (int kerning : {1, 0})
+    {
+        TTF_SetFontKerning(font.get(), kerning);
+        GlyphAtlas atlas(font.get(), {0, 0, 0, 0}, {255, 255, 255, 0});
+
+        for (const char *text : SAMPLE_TEXT)
+        {
+            int w = 0, h = 0;
+            ASSERT_EQ(TTF_SizeUTF8(font.get(), text, &w, &h), 0);
+            EXPECT_EQ(atlas.get_text_width(text), w) << "\"" << text << "\", kerning " << kerning;
+        }
+    }
+}
+
+TEST(GLYPH_ATLAS, pairs_are_measured_in_any_order)
+{
+    // Kerning is cached per pair, so measure the pairs before the strings
+    // containing them and check nothing accumulates from the first glyph
+    auto font = open_test_font(31);
+    if (!font)
+    {
+        GTEST_SKIP() << "Can't load " << TEST_FONT;
+    }
+
+    GlyphAtlas atlas(font.get(), {0, 0, 0, 0}, {255, 255, 255, 0});
+    for (const char *text : {"fj", "jf", "jfjfjfjf", "fjfjfjfj", "jjjjjjjj", "ffffffff"})
+    {
+        int w = 0, h = 0;
+        ASSERT_EQ(TTF_SizeUTF8(font.get(), text, &w, &h), 0);
+        EXPECT_EQ(atlas.get_text_width(text), w) << "\"" << text << "\"";
+    }
+}
@@ -0,0 +1,72 @@
+#include "../image_probe.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace
+{
+
+// Signature and IHDR of a 300x20 png
+const std::string PNG_HEADER(
+    "\x89PNG\r\n\x1a\n"
+    "\x00\x00\x00\x0dIHDR"
+    "\x00\x00\x01\x2c\x00\x00\x00\x14"
+    "\x08\x06\x00\x00\x00",
+    29
+);
+
+// SOI, a jfif APP0 segment, then a baseline frame header of a 640x480 jpeg
+const std::string JPEG_HEADER(
+    "\xff\xd8"
+    "\xff\xe0\x00\x10JFIF\x00\x01\x01\x00\x00\x01\x00\x01\x00\x00"
+    "\xff\xc0\x00\x11\x08\x01\xe0\x02\x80\x03\x01\x22\x00\x02\x11\x01\x03\x11\x01",
+    39
+);
+
+// Logical screen descriptor of a 16x513 gif
+const std::string GIF_HEADER("GIF89a\x10\x00\x01\x02\xf7\x00\x00", 13);
+
+} // namespace
+
+TEST(IMAGE_PROBE, png)
+{
+    auto image_size = probe_image_size(PNG_HEADER.data(), PNG_HEADER.size());
+    ASSERT_TRUE(image_size);
+    EXPECT_EQ(image_size->width, 300);
+    EXPECT_EQ(image_size->height, 20);
+}
+
+TEST(IMAGE_PROBE, jpeg)
+{
+    auto image_size = probe_image_size(JPEG_HEADER.data(), JPEG_HEADER.size());
+    ASSERT_TRUE(image_size);
+    EXPECT_EQ(image_size->width, 640);
+    EXPECT_EQ(image_size->height, 480);
+
+    // Progressive, after fill bytes
+    std::string progressive = JPEG_HEADER;
+    progressive.insert(20, "\xff\xff");
+    progressive[23] = '\xc2';
+    image_size = probe_image_size(progressive.data(), progressive.size());
+    ASSERT_TRUE(image_size);
+    EXPECT_EQ(image_size->width, 640);
+    EXPECT_EQ(image_size->height, 480);
+}
+
+TEST(IMAGE_PROBE, gif)
+{
+    auto image_size = probe_image_size(GIF_HEADER.data(), GIF_HEADER.size());
+    ASSERT_TRUE(image_size);
+    EXPECT_EQ(image_size->width, 16);
+    EXPECT_EQ(image_size->height, 513);
+}
+
+TEST(IMAGE_PROBE, truncated_or_unknown)
+{
+    EXPECT_FALSE(probe_image_size(PNG_HEADER.data(), 20));
+    EXPECT_FALSE(probe_image_size(JPEG_HEADER.data(), 25));
+    EXPECT_FALSE(probe_image_size(GIF_HEADER.data(), 8));
+    EXPECT_FALSE(probe_image_size("", 0));
+    EXPECT_FALSE(probe_image_size("not an image at all, honest", 27));
+}
@@ -0,0 +1,63 @@
+#include "../mpsc_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(MPSC_QUEUE, fifo_order)
+{
+    MPSCQueue<int> queue;
+    ASSERT_TRUE(queue.empty());
+
+    queue.push(1);
+    queue.push(2);
+    queue.push(3);
+    ASSERT_FALSE(queue.empty());
+
+    std::vector<int> values;
+    ASSERT_TRUE(queue.consume_all([&values](int v) { values.push_back(v); }));
+    ASSERT_EQ(values, (std::vector<int>{1, 2, 3}));
+
+    ASSERT_TRUE(queue.empty());
+    ASSERT_FALSE(queue.consume_all([](int) {}));
+}
+
+TEST(MPSC_QUEUE, multiple_producers)
+{
+    const int num_threads = 4;
+    const int num_per_thread = 10000;
+
+    MPSCQueue<int> queue;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&queue, t]() {
+            for (int i = 0; i < num_per_thread; ++i)
+            {
+                queue.push(t * num_per_thread + i);
+            }
+        });
+    }
+
+    std::vector<int> last_seen(num_threads, -1);
+    int total = 0;
+    auto consume = [&](int v) {
+        int t = v / num_per_thread;
+        // Per-producer order is preserved
+        ASSERT_GT(v, last_seen[t]);
+        last_seen[t] = v;
+        ++total;
+    };
+
+    while (total < num_threads * num_per_thread)
+    {
+        queue.consume_all(consume);
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    ASSERT_TRUE(queue.empty());
+}
@@ -57,3 +57,78 @@ TEST(ENCODE_UINT_VECTOR, encoding)
     ASSERT_EQ(encode_uint_vector(std::vector<uint32_t>{0}), "0");
     ASSERT_EQ(encode_uint_vector(std::vector<uint32_t>{0, 100, 200}), "0,100,200");
 }
+
+TEST(BASE64, encoding)
+{
+    EXPECT_EQ(encode_base64(""), "");
+    EXPECT_EQ(encode_base64("f"), "Zg==");
+    EXPECT_EQ(encode_base64("fo"), "Zm8=");
+    EXPECT_EQ(encode_base64("foo"), "Zm9v");
+    EXPECT_EQ(encode_base64("foobar"), "Zm9vYmFy");
+    EXPECT_EQ(encode_base64(std::string("\x00\xff", 2)), "AP8=");
+}
+
+TEST(BASE64, decoding)
+{
+    std::string out;
+    ASSERT_TRUE(try_decode_base64("Zm9vYg==", out));
+    EXPECT_EQ(out, "foob");
+
+    out.clear();
+    ASSERT_TRUE(try_decode_base64("AP8=", out));
+    EXPECT_EQ(out, std::string("\x00\xff", 2));
+}
+
+TEST(BASE64, invalid)
+{
+    std::string out;
+    EXPECT_FALSE(try_decode_base64("Zm9", out));
+    EXPECT_FALSE(try_decode_base64("Zm9*", out));
+}
+
+TEST(UINT_VECTOR_BASE64, round_trip)
+{
+    std::vector<std::vector<uint32_t>> cases = {
+        {},
+        {0},
+        {127, 128},
+        {100, 200, 5000, 16384, 2097152},
+        {0xFFFFFFFF, 0, 0xFFFFFFFF},
+    };
+
+    for (const auto &numbers : cases)
+    {
+        std::vector<uint32_t> decoded;
+        ASSERT_TRUE(try_decode_uint_vector_base64(encode_uint_vector_base64(numbers), decoded));
+        EXPECT_EQ(decoded, numbers);
+    }
+}
+
+TEST(UINT_VECTOR_BASE64, compact)
+{
+    std::vector<uint32_t> numbers(1000, 5000);
+    EXPECT_LT(encode_uint_vector_base64(numbers).size(), encode_uint_vector(numbers).size());
+}
+
+TEST(UINT_VECTOR_BASE64, invalid)
+{
+    std::vector<uint32_t> array;
+    EXPECT_FALSE(try_decode_uint_vector_base64("100,200", array));
+
+    // truncated varint
+    array.clear();
+    EXPECT_FALSE(try_decode_uint_vector_base64(encode_base64("\x80"), array));
+
+    // varint too long for uint32_t
+    array.clear();
+    EXPECT_FALSE(try_decode_uint_vector_base64(encode_base64("\x80\x80\x80\x80\x80\x01"), array));
+
+    // value over 32 bits in the last byte
+    array.clear();
+    EXPECT_TRUE(try_decode_uint_vector_base64(encode_base64("\xFF\xFF\xFF\xFF\x0F"), array));
+    EXPECT_EQ(array, std::vector<uint32_t>{0xFFFFFFFF});
+    array.clear();
+    EXPECT_FALSE(try_decode_uint_vector_base64(encode_base64("\xFF\xFF\xFF\xFF\x1F"), array));
+    array.clear();
+    EXPECT_FALSE(try_decode_uint_vector_base64(encode_base64("\x80\x80\x80\x80\x70"), array));
+}
@@ -0,0 +1,154 @@
+#include "../task_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+void drain_until_idle(TaskQueue &queue)
+{
+    while (queue.background_tasks_pending())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    queue.drain();
+}
+
+} // namespace
+
+TEST(TASK_QUEUE, main_thread_tasks_run_on_drain)
+{
+    TaskQueue queue(1);
+    int count = 0;
+    queue.submit([&count]() { ++count; });
+    queue.submit([&count]() { ++count; });
+
+    ASSERT_EQ(count, 0);
+    ASSERT_TRUE(queue.drain());
+    ASSERT_EQ(count, 2);
+    ASSERT_FALSE(queue.drain());
+}
+
+TEST(TASK_QUEUE, background_completion_runs_on_main_thread)
+{
+    TaskQueue queue(2);
+
+    auto main_thread = std::this_thread::get_id();
+    std::thread::id work_thread, complete_thread;
+    int result = 0;
+
+    queue.submit_background(
+        [&]() { work_thread = std::this_thread::get_id(); result = 42; },
+        [&]() { complete_thread = std::this_thread::get_id(); }
+    );
+    drain_until_idle(queue);
+
+    ASSERT_EQ(result, 42);
+    ASSERT_NE(work_thread, main_thread);
+    ASSERT_EQ(complete_thread, main_thread);
+}
+
+TEST(TASK_QUEUE, cancelled_tasks_do_not_run)
+{
+    TaskQueue queue(1);
+
+    // Block the worker so the next task stays queued
+    std::atomic<bool> release {false};
+    queue.submit_background([&release]() {
+        while (!release) std::this_thread::yield();
+    });
+
+    CancelToken token;
+    bool ran_work = false, ran_complete = false;
+    queue.submit_background(
+        [&]() { ran_work = true; },
+        [&]() { ran_complete = true; },
+        TaskPriority::Normal,
+        token
+    );
+    token.cancel();
+    release = true;
+
+    drain_until_idle(queue);
+    ASSERT_FALSE(ran_work);
+    ASSERT_FALSE(ran_complete);
+}
+
+TEST(TASK_QUEUE, cancel_after_work_skips_completion)
+{
+    TaskQueue queue(1);
+
+    CancelToken token;
+    bool ran_complete = false;
+    queue.submit_background(
+        []() {},
+        [&]() { ran_complete = true; },
+        TaskPriority::Normal,
+        token
+    );
+
+    while (queue.background_tasks_pending())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    token.cancel();
+    queue.drain();
+
+    ASSERT_FALSE(ran_complete);
+}
+
+TEST(TASK_QUEUE, priority_order)
+{
+    TaskQueue queue(1);
+
+    std::atomic<bool> release {false};
+    queue.submit_background([&release]() {
+        while (!release) std::this_thread::yield();
+    });
+
+    std::vector<int> order;
+    queue.submit_background([&order]() { order.push_back(0); }, nullptr, TaskPriority::Low);
+    queue.submit_background([&order]() { order.push_back(1); }, nullptr, TaskPriority::Normal);
+    queue.submit_background([&order]() { order.push_back(2); }, nullptr, TaskPriority::High);
+    queue.submit_background([&order]() { order.push_back(3); }, nullptr, TaskPriority::High);
+    release = true;
+
+    drain_until_idle(queue);
+    ASSERT_EQ(order, (std::vector<int>{2, 3, 1, 0}));
+}
+
+TEST(TASK_QUEUE, shutdown_waits_for_running_and_drops_queued)
+{
+    TaskQueue queue(1);
+
+    std::atomic<bool> started {false};
+    std::atomic<bool> finished {false};
+    queue.submit_background([&started, &finished]() {
+        started = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        finished = true;
+    });
+    bool ran_queued = false;
+    bool ran_complete = false;
+    queue.submit_background([&ran_queued]() { ran_queued = true; }, [&ran_complete]() { ran_complete = true; });
+
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+    queue.shutdown();
+    ASSERT_TRUE(finished);
+    ASSERT_EQ(queue.background_tasks_pending(), 0);
+
+    // Nothing runs once shut down
+    queue.submit_background([&ran_queued]() { ran_queued = true; });
+    ASSERT_EQ(queue.background_tasks_pending(), 0);
+    queue.drain();
+    ASSERT_FALSE(ran_queued);
+    ASSERT_FALSE(ran_complete);
+}
@@ -2,6 +2,8 @@
 
 #include <gtest/gtest.h>
 
+#include <cstring>
+
 static uint32_t step_amount(const char *str)
 {
     const char *next = utf8_step(str);
@@ -17,3 +19,23 @@ TEST(UTF8, handles_non_ascii)
 {
     EXPECT_GT(step_amount("λ"), 1);
 }
+
+static std::pair<uint32_t, uint32_t> decode(const char *str)
+{
+    uint32_t num_bytes = 0;
+    uint32_t cp = utf8_decode(str, str + strlen(str), num_bytes);
+    return {cp, num_bytes};
+}
+
+TEST(UTF8, decode)
+{
+    EXPECT_EQ(decode("a"), std::make_pair(0x61u, 1u));
+    EXPECT_EQ(decode("λ"), std::make_pair(0x3BBu, 2u));
+    EXPECT_EQ(decode("—"), std::make_pair(0x2014u, 3u));
+    EXPECT_EQ(decode("😀"), std::make_pair(0x1F600u, 4u));
+
+    // Invalid sequences
+    EXPECT_EQ(decode("\x80" "a"), std::make_pair(0u, 1u));
+    EXPECT_EQ(decode("\xE2\x80" "a"), std::make_pair(0u, 2u));
+    EXPECT_EQ(decode("\xE2\x80"), std::make_pair(0u, 2u));
+}
@@ -1,6 +1,8 @@
 #ifndef UTF_H_
 #define UTF_H_
 
+#include <cstdint>
+
 // Step to next character in utf-8 encoded string
 inline const char *utf8_step(const char *s)
 {
@@ -8,4 +10,48 @@ inline const char *utf8_step(const char *s)
     return s;
 }
 
+// Decode the code point at s, setting num_bytes to its encoded length.
+// Invalid sequences decode as 0, covering the bytes up to the next lead byte.
+inline uint32_t utf8_decode(const char *str, const char *end, uint32_t &num_bytes)
+{
+    const unsigned char *s = reinterpret_cast<const unsigned char *>(str);
+    uint32_t cp;
+    if (s[0] < 0x80)
+    {
+        num_bytes = 1;
+        return s[0];
+    }
+    else if ((s[0] & 0xE0) == 0xC0)
+    {
+        cp = s[0] & 0x1F;
+        num_bytes = 2;
+    }
+    else if ((s[0] & 0xF0) == 0xE0)
+    {
+        cp = s[0] & 0x0F;
+        num_bytes = 3;
+    }
+    else if ((s[0] & 0xF8) == 0xF0)
+    {
+        cp = s[0] & 0x07;
+        num_bytes = 4;
+    }
+    else
+    {
+        num_bytes = 1;
+        return 0;
+    }
+
+    for (uint32_t i = 1; i < num_bytes; ++i)
+    {
+        if (str + i >= end || (s[i] & 0xC0) != 0x80)
+        {
+            num_bytes = i;
+            return 0;
+        }
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+    return cp;
+}
+
 #endif
@@ -1,6 +1,8 @@
 #include "./zip_utils.h"
 
 #include <zip.h>
+
+#include <algorithm>
 #include <iostream>
 
 // Read zip file contents as a null-terminated string
@@ -41,3 +43,35 @@ std::vector<char> read_zip_file_str(zip_t *zip, const std::string &filepath)
 
     return buffer;
 }
+
+std::vector<char> read_zip_file_prefix(zip_t *zip, const std::string &filepath, uint32_t max_bytes)
+{
+    if (zip == nullptr)
+    {
+        throw std::runtime_error("Zip is not open");
+    }
+
+    zip_file_t *fp = zip_fopen(zip, filepath.c_str(), 0);
+    if (fp == nullptr)
+    {
+        std::cerr << "Unable to open " << filepath << " in epub" << std::endl;
+        return {};
+    }
+
+    std::vector<char> buffer(max_bytes);
+    auto read_size = zip_fread(fp, buffer.data(), max_bytes);
+    zip_fclose(fp);
+
+    buffer.resize(std::max<zip_int64_t>(read_size, 0));
+    return buffer;
+}
+
+uint64_t zip_file_size(zip_t *zip, const std::string &filepath)
+{
+    zip_stat_t stats;
+    if (zip == nullptr || zip_stat(zip, filepath.c_str(), 0, &stats) != 0 || !(stats.valid & ZIP_STAT_SIZE))
+    {
+        return 0;
+    }
+    return stats.size;
+}
@@ -1,10 +1,15 @@
 #ifndef ZIP_UTILS_H_
 #define ZIP_UTILS_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 typedef struct zip zip_t;
 std::vector<char> read_zip_file_str(zip_t *zip, const std::string &filepath);
+// Up to max_bytes from the start of file, without decompressing the rest
+std::vector<char> read_zip_file_prefix(zip_t *zip, const std::string &filepath, uint32_t max_bytes);
+// Uncompressed size of file in zip, 0 if not found
+uint64_t zip_file_size(zip_t *zip, const std::string &filepath);
 
 #endif